@@ -3,8 +3,10 @@
  */
 #include "config.h"
 #include "alu.h"
+#include "hostprof.h"
 
 int32_t alu_execute(int op_code, int32_t operand1, int32_t operand2) {
+    HP_COUNT(HP_CALL_ALU_EXECUTE);
     switch(op_code) {
         case ALU_ADD:
             return operand1 + operand2;
@@ -27,7 +29,48 @@ int32_t alu_execute(int op_code, int32_t operand1, int32_t operand2) {
             // logical right shift
             return (int32_t)((uint32_t)operand1 >> (operand2 & 0x1F));
         default:
-            // NOP or unsupported operation
+            // NOP: operand1 passes through unchanged
             return operand1;
     }
 }
+
+void alu_muldiv(int op_code, int32_t operand1, int32_t operand2, int32_t *hi, int32_t *lo) {
+    switch (op_code) {
+        case MD_MULT: {
+            int64_t product = (int64_t)operand1 * operand2;
+            *hi = (int32_t)((uint64_t)product >> 32);
+            *lo = (int32_t)product;
+            break;
+        }
+        case MD_MULTU: {
+            uint64_t product = (uint64_t)(uint32_t)operand1 * (uint32_t)operand2;
+            *hi = (int32_t)(product >> 32);
+            *lo = (int32_t)product;
+            break;
+        }
+        case MD_DIV:
+            if (operand2 == 0) {
+                *hi = operand1;
+                *lo = 0;
+            } else if (operand1 == INT32_MIN && operand2 == -1) {
+                // Overflows: the quotient wraps, as on hardware
+                *hi = 0;
+                *lo = INT32_MIN;
+            } else {
+                *hi = operand1 % operand2;
+                *lo = operand1 / operand2;
+            }
+            break;
+        case MD_DIVU:
+            if (operand2 == 0) {
+                *hi = operand1;
+                *lo = 0;
+            } else {
+                *hi = (int32_t)((uint32_t)operand1 % (uint32_t)operand2);
+                *lo = (int32_t)((uint32_t)operand1 / (uint32_t)operand2);
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -12,4 +12,8 @@
 // Returns the result of the operation.
 int32_t alu_execute(int op_code, int32_t operand1, int32_t operand2);
 
+// Execute a multiply/divide unit operation (one of MulDivOps) and set HI/LO.
+// Division by zero leaves a quotient of 0 and the dividend as remainder.
+void alu_muldiv(int op_code, int32_t operand1, int32_t operand2, int32_t *hi, int32_t *lo);
+
 #endif // ALU_H
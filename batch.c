@@ -0,0 +1,210 @@
+/**
+ * batch.c - Multi-threaded batch runner over independent simulator contexts.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "sim.h"
+#include "options.h"
+#include "dump.h"
+#include "batch.h"
+
+#define MAX_JOB_ARGS 64
+
+// One line of the job file and its result
+typedef struct {
+    char *line;             // original job text, for the report header
+    char *args;             // tokenized copy of line; program points into it
+    const char *program;
+    SimConfig_t config;
+    char *report;           // captured output of the run
+    size_t report_len;
+    int status;             // 0 on success
+} BatchJob_t;
+
+typedef struct {
+    BatchJob_t *jobs;
+    int count;
+    int next;               // next job to hand out, protected by lock
+    pthread_mutex_t lock;
+} BatchQueue_t;
+
+// Split a job line into whitespace-separated arguments (in place) and parse them
+static int parse_job(BatchJob_t *job, char *args) {
+    char *argv[MAX_JOB_ARGS];
+    int argc = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(args, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (argc == MAX_JOB_ARGS) {
+            fprintf(stderr, "Too many arguments in job: %s\n", job->line);
+            return -1;
+        }
+        argv[argc++] = tok;
+    }
+    sim_config_default(&job->config);
+    job->program = NULL;
+    for (int i = 0; i < argc; ++i) {
+        int r = options_parse_one(argc, argv, &i, &job->config);
+        if (r < 0) {
+            return -1;
+        }
+        if (r == 0) {
+            if (argv[i][0] == '-' || job->program) {
+                fprintf(stderr, "Invalid job argument '%s' in: %s\n", argv[i], job->line);
+                return -1;
+            }
+            job->program = argv[i];
+        }
+    }
+    if (!job->program == !job->config.restore_file) {
+        fprintf(stderr, "Job needs exactly one of a program or --restore: %s\n", job->line);
+        return -1;
+    }
+    return 0;
+}
+
+static void free_jobs(BatchJob_t *jobs, int count) {
+    for (int i = 0; i < count; ++i) {
+        free(jobs[i].line);
+        free(jobs[i].args);
+        free(jobs[i].report);
+    }
+    free(jobs);
+}
+
+static void run_job(BatchJob_t *job) {
+    FILE *out = open_memstream(&job->report, &job->report_len);
+    if (!out) {
+        job->status = -1;
+        return;
+    }
+    job->status = -1;
+    Sim_t *sim = sim_create(&job->config);
+    int loaded = -1;
+    if (sim) {
+        // Program output goes into the job's report
+        sim->console.out = out;
+        loaded = job->config.restore_file ? sim_restore(sim, job->config.restore_file)
+                                          : sim_load(sim, job->program);
+    }
+    if (loaded >= 0 && sim_run(sim) == 0) {
+        sim_report(sim, out);
+        // A verification mismatch fails the job
+        job->status = dump_final_state(sim, out) < 0 ? -1 : 0;
+    } else {
+        fprintf(out, "Job failed.\n");
+    }
+    sim_destroy(sim);
+    fclose(out);
+}
+
+static void *worker(void *arg) {
+    BatchQueue_t *q = arg;
+    while (1) {
+        pthread_mutex_lock(&q->lock);
+        int index = q->next < q->count ? q->next++ : -1;
+        pthread_mutex_unlock(&q->lock);
+        if (index < 0) {
+            break;
+        }
+        run_job(&q->jobs[index]);
+    }
+    return NULL;
+}
+
+// Read all jobs from the job file. Returns number of jobs, -1 on error.
+static int read_jobs(const char *jobfile, BatchJob_t **jobs_out) {
+    FILE *file = fopen(jobfile, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open job file: %s\n", jobfile);
+        return -1;
+    }
+    BatchJob_t *jobs = NULL;
+    int count = 0, capacity = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    int failed = 0;
+    while (getline(&line, &line_cap, file) != -1) {
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        if (strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            BatchJob_t *grown = realloc(jobs, capacity * sizeof(BatchJob_t));
+            if (!grown) {
+                failed = 1;
+                break;
+            }
+            jobs = grown;
+        }
+        BatchJob_t *job = &jobs[count++];
+        memset(job, 0, sizeof(*job));
+        line[strcspn(line, "\r\n")] = '\0';
+        job->line = strdup(line);
+        job->args = strdup(line);
+        if (!job->line || !job->args || parse_job(job, job->args) < 0) {
+            failed = 1;
+            break;
+        }
+    }
+    free(line);
+    fclose(file);
+    if (failed) {
+        free_jobs(jobs, count);
+        return -1;
+    }
+    *jobs_out = jobs;
+    return count;
+}
+
+int batch_run(const char *jobfile, int threads) {
+    BatchJob_t *jobs = NULL;
+    int count = read_jobs(jobfile, &jobs);
+    if (count < 0) {
+        return 1;
+    }
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+    }
+    if (threads > count) {
+        threads = count > 0 ? count : 1;
+    }
+    BatchQueue_t q = { jobs, count, 0, PTHREAD_MUTEX_INITIALIZER };
+    pthread_t *pool = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    if (pool) {
+        for (; started < threads; ++started) {
+            if (pthread_create(&pool[started], NULL, worker, &q) != 0) {
+                break;
+            }
+        }
+    }
+    if (started == 0) {
+        // No worker could be started: run everything on this thread
+        worker(&q);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(pool[i], NULL);
+    }
+    free(pool);
+    int status = 0;
+    for (int i = 0; i < count; ++i) {
+        printf("=== job %d: %s ===\n", i + 1, jobs[i].line);
+        if (jobs[i].report) {
+            fwrite(jobs[i].report, 1, jobs[i].report_len, stdout);
+        }
+        if (jobs[i].status != 0) {
+            status = 1;
+        }
+    }
+    free_jobs(jobs, count);
+    return status;
+}
@@ -0,0 +1,13 @@
+/**
+ * batch.h - Batch driver running many simulation jobs on a thread pool.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+// Run every job listed in jobfile on a pool of worker threads (0 = one per
+// online CPU). Each non-empty line is "<program.bin> [options]"; '#' starts a
+// comment. Reports are printed in job order once all jobs have finished.
+// Returns 0 if every job ran successfully, 1 otherwise.
+int batch_run(const char *jobfile, int threads);
+
+#endif // BATCH_H
@@ -0,0 +1,46 @@
+#################################################
+# branchy.asm - pseudo-random branch outcomes
+# Three data-dependent branches per iteration on
+# xorshift bits, 30000 iterations
+#################################################
+
+    .text
+main:
+    addi $s0, $zero, 12345      # xorshift state
+    addi $s1, $zero, 0          # i
+    addi $s2, $zero, 30000      # iterations
+    addi $s3, $zero, 0x1000     # counters
+    addi $s4, $zero, 1
+    addi $s5, $zero, 2
+    addi $s6, $zero, 12
+
+loop:
+    sll  $t0, $s0, 13
+    xor  $s0, $s0, $t0
+    srl  $t0, $s0, 17
+    xor  $s0, $s0, $t0
+    sll  $t0, $s0, 5
+    xor  $s0, $s0, $t0
+
+    and  $t1, $s0, $s4          # bit 0: random
+    beq  $t1, $zero, b0
+    addi $v0, $v0, 1
+b0:
+    and  $t1, $s0, $s5          # bit 1: random
+    bne  $t1, $zero, b1
+    addi $v1, $v1, 1
+    j    b2
+b1:
+    and  $t1, $s0, $s6          # bits 2-3 select a counter
+    add  $t1, $t1, $s3
+    lw   $t2, 0($t1)
+    addi $t2, $t2, 1
+    sw   $t2, 0($t1)
+b2:
+    and  $t1, $s1, $s4          # alternating: learnable with history
+    beq  $t1, $zero, b3
+    sub  $v0, $v0, $s4
+b3:
+    addi $s1, $s1, 1
+    bne  $s1, $s2, loop
+    nop
@@ -0,0 +1,47 @@
+#################################################
+# bsort.asm - bubble sort of 400 pseudo-random words
+# Data-dependent branches and load/use pairs
+#################################################
+
+    .text
+main:
+    addi $s0, $zero, 0x1000     # array base
+    addi $s1, $zero, 400        # n
+    addi $s2, $zero, 12345      # xorshift state
+    addi $s3, $zero, 0x7FFF     # value mask
+
+    # a[i] = xorshift() & 0x7fff
+    add  $t0, $zero, $zero
+fill:
+    sll  $t1, $s2, 13
+    xor  $s2, $s2, $t1
+    srl  $t1, $s2, 17
+    xor  $s2, $s2, $t1
+    sll  $t1, $s2, 5
+    xor  $s2, $s2, $t1
+    and  $t2, $s2, $s3
+    sll  $t3, $t0, 2
+    add  $t3, $t3, $s0
+    sw   $t2, 0($t3)
+    addi $t0, $t0, 1
+    bne  $t0, $s1, fill
+
+    # for (end = n - 1; end > 0; end--) for (j = 0; j < end; j++) swap if a[j] > a[j+1]
+    addi $s4, $s1, -1           # end
+outer:
+    add  $t0, $s0, $zero        # &a[j]
+    sll  $t9, $s4, 2
+    add  $t9, $t9, $s0          # &a[end]
+inner:
+    lw   $t1, 0($t0)
+    lw   $t2, 4($t0)
+    slt  $t3, $t2, $t1
+    beq  $t3, $zero, noswap
+    sw   $t2, 0($t0)
+    sw   $t1, 4($t0)
+noswap:
+    addi $t0, $t0, 4
+    bne  $t0, $t9, inner
+    addi $s4, $s4, -1
+    bne  $s4, $zero, outer
+    nop
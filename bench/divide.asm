@@ -0,0 +1,36 @@
+#################################################
+# divide.asm - divides in a hot loop
+# Signed and unsigned DIV on xorshift values with
+# a divisor that is 0 every 16th iteration,
+# 30000 iterations
+#################################################
+
+    .text
+main:
+    addi $s0, $zero, 12345      # xorshift state
+    addi $s1, $zero, 0          # i
+    addi $s2, $zero, 30000      # iterations
+    addi $s3, $zero, 7
+    addi $s4, $zero, 15
+
+loop:
+    sll  $t0, $s0, 13
+    xor  $s0, $s0, $t0
+    srl  $t0, $s0, 17
+    xor  $s0, $s0, $t0
+    sll  $t0, $s0, 5
+    xor  $s0, $s0, $t0
+
+    and  $t1, $s1, $s4          # divisor 0-15: division by zero included
+    div  $s0, $t1
+    mflo $t2
+    mfhi $t3
+    add  $v0, $v0, $t2
+    xor  $v1, $v1, $t3
+    divu $s0, $s3
+    mflo $t2
+    add  $v0, $v0, $t2
+
+    addi $s1, $s1, 1
+    bne  $s1, $s2, loop
+    nop
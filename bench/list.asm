@@ -0,0 +1,44 @@
+#################################################
+# list.asm - walk a 1024-node linked list 150 times
+# Nodes are linked in a scattered order, so every load
+# depends on the previous one (pointer chasing)
+#################################################
+
+    .text
+main:
+    addi $s0, $zero, 0x1000     # node array, 8 bytes per node: next, value
+    addi $s1, $zero, 1023       # index mask
+    addi $s2, $zero, 389        # odd stride: visits every node once
+    addi $s3, $zero, 150        # repetitions
+
+    # Link node p(i) to node p(i+1), where p(i) = i * 389 mod 1024
+    add  $t0, $zero, $zero      # p(i)
+    addi $t9, $zero, 1023       # links to make
+link:
+    add  $t1, $t0, $s2
+    and  $t1, $t1, $s1          # p(i+1)
+    sll  $t2, $t0, 3
+    add  $t2, $t2, $s0          # &node[p(i)]
+    sll  $t3, $t1, 3
+    add  $t3, $t3, $s0          # &node[p(i+1)]
+    sw   $t3, 0($t2)
+    sw   $t0, 4($t2)
+    add  $t0, $t1, $zero
+    addi $t9, $t9, -1
+    bne  $t9, $zero, link
+    sll  $t2, $t0, 3
+    add  $t2, $t2, $s0
+    sw   $zero, 0($t2)          # last node ends the list
+    sw   $t0, 4($t2)
+
+rep:
+    add  $t0, $s0, $zero        # head is node 0
+    add  $v0, $zero, $zero
+walk:
+    lw   $t1, 4($t0)
+    lw   $t0, 0($t0)
+    add  $v0, $v0, $t1
+    bne  $t0, $zero, walk
+    addi $s3, $s3, -1
+    bne  $s3, $zero, rep
+    nop
@@ -0,0 +1,74 @@
+#################################################
+# matmul.asm - 16x16 integer matrix multiply, 4 times
+# No multiplier: products use a shift-and-add loop
+#################################################
+
+    .text
+main:
+    addi $s0, $zero, 0x1000     # A
+    addi $s1, $zero, 0x1400     # B
+    addi $s2, $zero, 0x1800     # C
+    addi $s7, $zero, 4          # repetitions
+
+    # A[k] = k & 15, B[k] = (k >> 2) & 15 for k = 0..255
+    add  $t0, $zero, $zero
+    addi $t9, $zero, 256
+    addi $t8, $zero, 15
+fill:
+    sll  $t1, $t0, 2
+    and  $t2, $t0, $t8
+    add  $t3, $t1, $s0
+    sw   $t2, 0($t3)
+    srl  $t2, $t0, 2
+    and  $t2, $t2, $t8
+    add  $t3, $t1, $s1
+    sw   $t2, 0($t3)
+    addi $t0, $t0, 1
+    bne  $t0, $t9, fill
+
+rep:
+    add  $s3, $zero, $zero      # i
+    addi $s6, $zero, 16
+row:
+    add  $s4, $zero, $zero      # j
+col:
+    add  $v0, $zero, $zero      # sum
+    add  $s5, $zero, $zero      # k
+    sll  $t0, $s3, 6
+    add  $t0, $t0, $s0          # &A[i][0]
+    sll  $t1, $s4, 2
+    add  $t1, $t1, $s1          # &B[0][j]
+dot:
+    lw   $a0, 0($t0)
+    lw   $a1, 0($t1)
+    add  $t2, $zero, $zero      # product
+mul:
+    beq  $a1, $zero, muldone
+    addi $t3, $zero, 1
+    and  $t3, $a1, $t3
+    beq  $t3, $zero, mulskip
+    add  $t2, $t2, $a0
+mulskip:
+    sll  $a0, $a0, 1
+    srl  $a1, $a1, 1
+    j    mul
+muldone:
+    add  $v0, $v0, $t2
+    addi $t0, $t0, 4
+    addi $t1, $t1, 64
+    addi $s5, $s5, 1
+    bne  $s5, $s6, dot
+
+    sll  $t0, $s3, 6
+    sll  $t1, $s4, 2
+    add  $t0, $t0, $t1
+    add  $t0, $t0, $s2
+    sw   $v0, 0($t0)            # C[i][j]
+    addi $s4, $s4, 1
+    bne  $s4, $s6, col
+    addi $s3, $s3, 1
+    bne  $s3, $s6, row
+
+    addi $s7, $s7, -1
+    bne  $s7, $zero, rep
+    nop
@@ -0,0 +1,42 @@
+#################################################
+# memcpy.asm - copy a 2048-word buffer 150 times
+# Streaming loads/stores, four words per iteration
+#################################################
+
+    .text
+main:
+    addi $s0, $zero, 0x1000     # src
+    addi $s1, $zero, 0x4000     # dst
+    addi $s2, $zero, 8192       # length in bytes
+    addi $s3, $zero, 150        # repetitions
+
+    # src[i] = i * 3 + 1
+    add  $t0, $zero, $zero
+    addi $t1, $zero, 1
+fill:
+    add  $t2, $s0, $t0
+    sw   $t1, 0($t2)
+    addi $t1, $t1, 3
+    addi $t0, $t0, 4
+    bne  $t0, $s2, fill
+
+rep:
+    add  $t0, $s0, $zero        # read pointer
+    add  $t1, $s1, $zero        # write pointer
+    add  $t9, $s0, $s2          # end of src
+copy:
+    lw   $t2, 0($t0)
+    lw   $t3, 4($t0)
+    lw   $t4, 8($t0)
+    lw   $t5, 12($t0)
+    sw   $t2, 0($t1)
+    sw   $t3, 4($t1)
+    sw   $t4, 8($t1)
+    sw   $t5, 12($t1)
+    addi $t0, $t0, 16
+    addi $t1, $t1, 16
+    bne  $t0, $t9, copy
+
+    addi $s3, $s3, -1
+    bne  $s3, $zero, rep
+    nop
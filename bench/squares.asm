@@ -0,0 +1,32 @@
+#################################################
+# squares.asm - square table 0..200, rebuilt 500 times
+# Arithmetic-heavy loop with one store per iteration
+#################################################
+
+    .text
+main:
+    addi $s6, $zero, 500        # repetitions
+    addi $s4, $zero, 201        # limit
+    addi $s5, $zero, 0x1000     # array base
+
+rep:
+    add  $s0, $zero, $zero      # i = 0
+    add  $s1, $zero, $zero      # last_square = 0
+    sw   $s1, 0($s5)
+
+loop:
+    addi $s0, $s0, 1
+    beq  $s0, $s4, next
+    add  $t0, $s0, $s0          # 2*i
+    addi $t0, $t0, -1           # 2*i - 1
+    add  $s2, $s1, $t0          # new square
+    sll  $t1, $s0, 2
+    add  $t1, $t1, $s5
+    sw   $s2, 0($t1)
+    add  $s1, $s2, $zero
+    j    loop
+
+next:
+    addi $s6, $s6, -1
+    bne  $s6, $zero, rep
+    nop
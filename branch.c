@@ -0,0 +1,100 @@
+/**
+ * branch.c - Branch target buffer and direction predictors.
+ */
+#include <string.h>
+#include "branch.h"
+
+static const char *policy_names[] = { "not-taken", "1bit", "2bit", "gshare" };
+
+#define HISTORY_MASK ((1u << GSHARE_HISTORY_BITS) - 1)
+
+static uint32_t pht_index(const BranchPredictor_t *bp, uint32_t pc) {
+    uint32_t index = pc >> 2;
+    if (bp->policy == BP_GSHARE) {
+        index ^= bp->history;
+    }
+    return index & (PHT_SIZE - 1);
+}
+
+void bp_init(BranchPredictor_t *bp, int policy) {
+    memset(bp, 0, sizeof(*bp));
+    bp->policy = policy;
+    // Counters start weakly not-taken (1-bit tables use 0 = not-taken)
+    memset(bp->pht, policy == BP_ONE_BIT ? 0 : 1, sizeof(bp->pht));
+}
+
+int bp_predict(const BranchPredictor_t *bp, uint32_t pc, uint32_t *target) {
+    if (bp->policy == BP_NOT_TAKEN) {
+        return 0;
+    }
+    // Without a BTB hit there is no target to redirect to
+    const BTBEntry_t *e = &bp->btb[(pc >> 2) % BTB_SIZE];
+    if (!e->valid || e->pc != pc) {
+        return 0;
+    }
+    int taken;
+    if (e->is_jump) {
+        taken = 1;
+    } else if (bp->policy == BP_ONE_BIT) {
+        taken = bp->pht[pht_index(bp, pc)];
+    } else {
+        taken = bp->pht[pht_index(bp, pc)] >= 2;
+    }
+    if (taken) {
+        *target = e->target;
+    }
+    return taken;
+}
+
+void bp_update(BranchPredictor_t *bp, uint32_t pc, int is_jump, int taken, uint32_t target,
+               int mispredicted) {
+    if (is_jump) {
+        bp->jumps++;
+    } else {
+        bp->branches++;
+    }
+    if (mispredicted) {
+        bp->mispredicts++;
+        bp->flush_cycles += BRANCH_FLUSH_PENALTY;
+    }
+    if (bp->policy == BP_NOT_TAKEN) {
+        return;
+    }
+    if (!is_jump) {
+        uint8_t *ctr = &bp->pht[pht_index(bp, pc)];
+        if (bp->policy == BP_ONE_BIT) {
+            *ctr = (uint8_t)taken;
+        } else if (taken) {
+            if (*ctr < 3) (*ctr)++;
+        } else {
+            if (*ctr > 0) (*ctr)--;
+        }
+        // History is updated at resolution, not speculatively at fetch
+        bp->history = ((bp->history << 1) | (uint32_t)taken) & HISTORY_MASK;
+    }
+    // Only taken control transfers need a target; keep entries for branches
+    // that were taken at least once so the direction table can be consulted
+    if (taken) {
+        BTBEntry_t *e = &bp->btb[(pc >> 2) % BTB_SIZE];
+        e->valid = 1;
+        e->is_jump = (uint8_t)is_jump;
+        e->pc = pc;
+        e->target = target;
+    }
+}
+
+int bp_parse_policy(const char *name) {
+    for (int i = 0; i < (int)(sizeof(policy_names) / sizeof(policy_names[0])); ++i) {
+        if (strcmp(name, policy_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char *bp_policy_name(int policy) {
+    if (policy < 0 || policy >= (int)(sizeof(policy_names) / sizeof(policy_names[0]))) {
+        return "unknown";
+    }
+    return policy_names[policy];
+}
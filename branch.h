@@ -0,0 +1,54 @@
+/**
+ * branch.h - Branch prediction interface (BTB plus direction predictors).
+ */
+#ifndef BRANCH_H
+#define BRANCH_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Direction prediction policies
+enum BranchPolicy {
+    BP_NOT_TAKEN = 0,   /* static not-taken, BTB unused */
+    BP_ONE_BIT,         /* last outcome per branch */
+    BP_TWO_BIT,         /* 2-bit saturating counter per branch */
+    BP_GSHARE           /* 2-bit counters indexed by PC xor global history */
+};
+
+// Branch target buffer entry
+typedef struct {
+    uint8_t valid;
+    uint8_t is_jump;    // unconditional (J/JR): always predicted taken on a hit
+    uint32_t pc;        // full PC used as tag
+    uint32_t target;
+} BTBEntry_t;
+
+// Predictor state and statistics
+typedef struct {
+    int policy;
+    BTBEntry_t btb[BTB_SIZE];
+    uint8_t pht[PHT_SIZE];
+    uint32_t history;
+    long branches;      // conditional branches resolved
+    long jumps;         // unconditional jumps resolved
+    long mispredicts;   // wrong direction or target (branches and jumps)
+    long flush_cycles;  // fetch slots squashed by mispredictions
+} BranchPredictor_t;
+
+// Initialize predictor state for the given policy.
+void bp_init(BranchPredictor_t *bp, int policy);
+
+// Predict the instruction fetched at pc. Returns 1 and sets *target if it is
+// predicted taken, 0 if fetch should continue at pc + 4.
+int bp_predict(const BranchPredictor_t *bp, uint32_t pc, uint32_t *target);
+
+// Train the predictor with a resolved branch (is_jump = 0) or jump (is_jump = 1).
+// mispredicted tells whether the fetched path after it had to be flushed.
+void bp_update(BranchPredictor_t *bp, uint32_t pc, int is_jump, int taken, uint32_t target,
+               int mispredicted);
+
+// Parse a policy name ("not-taken", "1bit", "2bit", "gshare"). Returns -1 if unknown.
+int bp_parse_policy(const char *name);
+const char *bp_policy_name(int policy);
+
+#endif // BRANCH_H
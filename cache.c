@@ -0,0 +1,146 @@
+/**
+ * cache.c - Set-associative cache with LRU/random replacement and write policies.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+static int is_pow2(uint32_t v) {
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+static uint32_t log2u(uint32_t v) {
+    uint32_t bits = 0;
+    while (v > 1) {
+        v >>= 1;
+        bits++;
+    }
+    return bits;
+}
+
+int cache_init(Cache_t *c, const CacheConfig_t *cfg) {
+    memset(c, 0, sizeof(*c));
+    c->config = *cfg;
+    if (cfg->size == 0) {
+        return 0; // ideal memory, no lines
+    }
+    if (!is_pow2(cfg->size) || !is_pow2(cfg->line_size) || cfg->line_size < 4 ||
+        cfg->assoc == 0 || cfg->size % (cfg->line_size * cfg->assoc) != 0 ||
+        !is_pow2(cfg->size / (cfg->line_size * cfg->assoc))) {
+        fprintf(stderr, "Invalid cache geometry %u:%u:%u\n", cfg->size, cfg->assoc, cfg->line_size);
+        return -1;
+    }
+    c->sets = cfg->size / (cfg->line_size * cfg->assoc);
+    c->line_bits = log2u(cfg->line_size);
+    c->set_bits = log2u(c->sets);
+    c->lines = calloc((size_t)c->sets * cfg->assoc, sizeof(CacheLine_t));
+    if (!c->lines) {
+        fprintf(stderr, "Failed to allocate cache lines\n");
+        return -1;
+    }
+    c->rng = 2463534242u;
+    return 0;
+}
+
+void cache_free(Cache_t *c) {
+    free(c->lines);
+    c->lines = NULL;
+}
+
+static uint32_t next_random(Cache_t *c) {
+    uint32_t x = c->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    c->rng = x;
+    return x;
+}
+
+CacheLine_t *cache_victim(Cache_t *c, uint32_t address) {
+    uint32_t set = (address >> c->line_bits) & (c->sets - 1);
+    CacheLine_t *ways = &c->lines[(size_t)set * c->config.assoc];
+    // An invalid way if any, else by policy
+    for (uint32_t w = 0; w < c->config.assoc; ++w) {
+        if (!ways[w].valid) {
+            return &ways[w];
+        }
+    }
+    CacheLine_t *victim = &ways[0];
+    if (c->config.replacement == CACHE_RANDOM) {
+        victim = &ways[next_random(c) % c->config.assoc];
+    } else {
+        for (uint32_t w = 1; w < c->config.assoc; ++w) {
+            if (ways[w].last_use < victim->last_use) {
+                victim = &ways[w];
+            }
+        }
+    }
+    c->evictions++;
+    return victim;
+}
+
+int cache_access(Cache_t *c, uint32_t address, int is_write) {
+    if (!c->lines) {
+        return 0;
+    }
+    uint32_t block = address >> c->line_bits;
+    uint32_t set = block & (c->sets - 1);
+    uint32_t tag = block >> c->set_bits;
+    CacheLine_t *ways = &c->lines[(size_t)set * c->config.assoc];
+    c->clock++;
+    int write_back = c->config.write_back;
+    if (is_write && !write_back) {
+        c->write_throughs++;
+    }
+    for (uint32_t w = 0; w < c->config.assoc; ++w) {
+        if (ways[w].valid && ways[w].tag == tag) {
+            c->hits++;
+            ways[w].last_use = c->clock;
+            if (is_write && write_back) {
+                ways[w].dirty = 1;
+            }
+            return 0;
+        }
+    }
+    c->misses++;
+    if (is_write && !write_back) {
+        // No-write-allocate: the store goes to memory through the write buffer
+        return 0;
+    }
+    CacheLine_t *victim = cache_victim(c, address);
+    int penalty = c->config.miss_latency;
+    if (victim->valid && victim->dirty) {
+        c->writebacks++;
+        penalty += c->config.miss_latency;
+    }
+    victim->valid = 1;
+    victim->dirty = (uint8_t)(is_write && write_back);
+    victim->tag = tag;
+    victim->last_use = c->clock;
+    return penalty;
+}
+
+int cache_parse_geometry(const char *text, CacheConfig_t *cfg) {
+    char *end;
+    unsigned long size = strtoul(text, &end, 0);
+    if (*end == 'k' || *end == 'K') {
+        size *= 1024;
+        end++;
+    }
+    if (*end != ':') {
+        return -1;
+    }
+    unsigned long assoc = strtoul(end + 1, &end, 0);
+    if (*end != ':') {
+        return -1;
+    }
+    unsigned long line = strtoul(end + 1, &end, 0);
+    if (*end != '\0' || size == 0 || size > 0x80000000ul) {
+        return -1;
+    }
+    cfg->size = (uint32_t)size;
+    cfg->assoc = (uint32_t)assoc;
+    cfg->line_size = (uint32_t)line;
+    return 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * cache.h - Set-associative cache timing model (tags only, data lives in memory).
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+// Replacement policies
+enum CacheReplacement {
+    CACHE_LRU = 0,
+    CACHE_RANDOM
+};
+
+// Geometry and policy of one cache; size 0 models an ideal memory (always hits)
+typedef struct {
+    uint32_t size;          // total capacity in bytes
+    uint32_t assoc;         // ways per set
+    uint32_t line_size;     // bytes per line
+    int replacement;        // CacheReplacement
+    int write_back;         // 1: write-back + write-allocate, 0: write-through + no-write-allocate
+    int miss_latency;       // extra cycles for a miss (and for writing back a dirty victim)
+} CacheConfig_t;
+
+typedef struct {
+    uint32_t tag;
+    uint8_t valid;
+    uint8_t dirty;
+    uint8_t state;          // MesiState of a coherent L1 line (multicore), valid mirrors it
+    uint64_t last_use;      // LRU timestamp
+} CacheLine_t;
+
+typedef struct {
+    CacheConfig_t config;
+    CacheLine_t *lines;     // sets * assoc lines, set-major
+    uint32_t sets;
+    uint32_t line_bits;     // log2(line_size)
+    uint32_t set_bits;      // log2(sets)
+    uint64_t clock;         // access counter used for LRU stamps
+    uint32_t rng;           // xorshift state for random replacement
+    long hits;
+    long misses;
+    long evictions;         // valid lines replaced
+    long writebacks;        // dirty lines written back on eviction
+    long write_throughs;    // stores forwarded to memory (write-through)
+} Cache_t;
+
+// Set up a cache from its configuration. Returns 0 on success, -1 for an
+// invalid geometry (sizes must be powers of two and hold at least one set).
+int cache_init(Cache_t *c, const CacheConfig_t *cfg);
+void cache_free(Cache_t *c);
+
+// Model one access. Returns the stall cycles it adds (0 on a hit).
+int cache_access(Cache_t *c, uint32_t address, int is_write);
+
+// Line to fill with address: an invalid way of its set if any, else the one
+// the replacement policy evicts (counted in evictions). The cache must have lines.
+CacheLine_t *cache_victim(Cache_t *c, uint32_t address);
+
+// Parse "SIZE:ASSOC:LINE" (SIZE may end in K) into cfg. Returns 0 on success.
+int cache_parse_geometry(const char *text, CacheConfig_t *cfg);
+
+#endif // CACHE_H
@@ -0,0 +1,344 @@
+/**
+ * checkpoint.c - Snapshot files: writing state and mapping it back in copy-on-write.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "config.h"
+#include "util.h"
+#include "memory.h"
+#include "branch.h"
+#include "cache.h"
+#include "pipeline.h"
+#include "sim.h"
+#include "checkpoint.h"
+
+int checkpoint_parse_trigger(const char *text, int *trigger, uint64_t *value) {
+    const char *colon = strchr(text, ':');
+    if (!colon || colon[1] == '\0') {
+        return -1;
+    }
+    size_t kind_len = (size_t)(colon - text);
+    if (kind_len == 5 && strncmp(text, "cycle", 5) == 0) {
+        *trigger = CKPT_CYCLE;
+    } else if (kind_len == 4 && strncmp(text, "inst", 4) == 0) {
+        *trigger = CKPT_INSTR;
+    } else if (kind_len == 2 && strncmp(text, "pc", 2) == 0) {
+        *trigger = CKPT_PC;
+    } else {
+        return -1;
+    }
+    char *end;
+    unsigned long long v = strtoull(colon + 1, &end, 0);
+    if (*end != '\0' || (*trigger == CKPT_PC && v > 0xFFFFFFFFull)) {
+        return -1;
+    }
+    *value = v;
+    return 0;
+}
+
+int checkpoint_due(const Sim_t *sim, uint32_t prev_pc) {
+    switch (sim->config.checkpoint_trigger) {
+        case CKPT_CYCLE:
+            return (uint64_t)sim->cycle >= sim->config.checkpoint_at;
+        case CKPT_INSTR:
+            return (uint64_t)sim->instructions >= sim->config.checkpoint_at;
+        case CKPT_PC:
+            if (sim->config.functional) {
+                return prev_pc == (uint32_t)sim->config.checkpoint_at && sim->arch.pc != prev_pc;
+            }
+            // The instruction just moved into MEM/WB, i.e. it has completed
+            return sim->pipe.MEMWB.valid && sim->pipe.MEMWB.pc == (uint32_t)sim->config.checkpoint_at;
+        default:
+            return 0;
+    }
+}
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Bytes of a cache's line array (0 for ideal memory)
+static size_t cache_bytes(const Cache_t *c) {
+    return c->lines ? (size_t)c->sets * c->config.assoc * sizeof(CacheLine_t) : 0;
+}
+
+static int write_lines(FILE *file, const Cache_t *c) {
+    size_t bytes = cache_bytes(c);
+    return (bytes && fwrite(c->lines, 1, bytes, file) != bytes) ? -1 : 0;
+}
+
+// Rebuild c from its configuration, then reuse the saved lines and counters
+// if the snapshot was taken with the same geometry and policies
+static int restore_cache(Cache_t *c, const CacheConfig_t *cfg, const Cache_t *saved, const uint8_t *lines,
+                         size_t avail) {
+    cache_free(c);
+    if (cache_init(c, cfg) < 0) {
+        return -1;
+    }
+    if (c->lines && saved->sets == c->sets && memcmp(&saved->config, cfg, sizeof(*cfg)) == 0 &&
+        cache_bytes(c) <= avail) {
+        CacheLine_t *own = c->lines;
+        *c = *saved;
+        c->lines = own;
+        memcpy(own, lines, cache_bytes(c));
+    }
+    return 0;
+}
+
+// memory_for_each_page callbacks: collect addresses, then write page contents
+typedef struct {
+    FILE *file;
+    uint32_t *addresses;
+    uint32_t count;
+    int error;
+} PageWriter_t;
+
+static void count_page(void *ctx, uint32_t address, const uint8_t *data) {
+    PageWriter_t *w = ctx;
+    (void)data;
+    if (w->addresses) {
+        w->addresses[w->count] = address;
+    }
+    w->count++;
+}
+
+static void write_page(void *ctx, uint32_t address, const uint8_t *data) {
+    PageWriter_t *w = ctx;
+    (void)address;
+    if (fwrite(data, PAGE_SIZE, 1, w->file) != 1) {
+        w->error = 1;
+    }
+}
+
+// Pad the file with zeros up to offset
+static int pad_to(FILE *file, uint64_t offset) {
+    long pos = ftell(file);
+    if (pos < 0) {
+        return -1;
+    }
+    for (uint64_t i = (uint64_t)pos; i < offset; ++i) {
+        if (fputc(0, file) == EOF) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int checkpoint_save(const Sim_t *sim, const char *filename) {
+    const ArchState_t *st = &sim->arch;
+    PageWriter_t pages = { 0 };
+    memory_for_each_page(&st->mem, count_page, &pages);
+    pages.addresses = malloc((pages.count ? pages.count : 1) * sizeof(uint32_t));
+    if (!pages.addresses) {
+        fprintf(stderr, "Failed to allocate checkpoint page index\n");
+        return -1;
+    }
+    pages.count = 0;
+    memory_for_each_page(&st->mem, count_page, &pages);
+
+    CheckpointHeader_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+    h.version = CHECKPOINT_VERSION;
+    h.byte_order = CHECKPOINT_BYTE_ORDER;
+    h.header_size = sizeof(h);
+    h.pipeline_size = sizeof(Pipeline_t);
+    h.predictor_size = sizeof(BranchPredictor_t);
+    h.cache_line_size = sizeof(CacheLine_t);
+    h.page_size = PAGE_SIZE;
+    h.has_pipeline = !sim->config.functional;
+    h.cycle = (uint64_t)sim->cycle;
+    h.instructions = (uint64_t)sim->instructions;
+    h.text_base = st->text_base;
+    h.entry = st->entry;
+    h.pc = st->pc;
+    h.instr_count = (uint32_t)st->instr_count;
+    h.page_count = pages.count;
+    h.text_offset = align_up(sizeof(h), 8);
+    h.page_index_offset = align_up(h.text_offset + (uint64_t)h.instr_count * 4, 8);
+    h.icache_lines_offset = align_up(h.page_index_offset + (uint64_t)h.page_count * 4, 8);
+    h.dcache_lines_offset = h.icache_lines_offset + cache_bytes(&sim->icache);
+    h.page_data_offset = align_up(h.dcache_lines_offset + cache_bytes(&sim->dcache), PAGE_SIZE);
+    h.bp = sim->bp;
+    h.icache = sim->icache;
+    h.icache.lines = NULL;
+    h.dcache = sim->dcache;
+    h.dcache.lines = NULL;
+    h.icache_stall_cycles = sim->icache_stall_cycles;
+    h.dcache_stall_cycles = sim->dcache_stall_cycles;
+    memcpy(h.registers, st->registers, sizeof(h.registers));
+    h.hi = st->hi;
+    h.lo = st->lo;
+    if (!sim->config.functional) {
+        h.pipe = sim->pipe;
+    }
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create checkpoint file: %s\n", filename);
+        free(pages.addresses);
+        return -1;
+    }
+    pages.file = file;
+    int failed = fwrite(&h, sizeof(h), 1, file) != 1 ||
+                 pad_to(file, h.text_offset) < 0 ||
+                 fwrite(st->instr_mem, 4, h.instr_count, file) != h.instr_count ||
+                 pad_to(file, h.page_index_offset) < 0 ||
+                 fwrite(pages.addresses, 4, h.page_count, file) != h.page_count ||
+                 pad_to(file, h.icache_lines_offset) < 0 ||
+                 write_lines(file, &sim->icache) < 0 || write_lines(file, &sim->dcache) < 0 ||
+                 pad_to(file, h.page_data_offset) < 0;
+    if (!failed) {
+        memory_for_each_page(&st->mem, write_page, &pages);
+        failed = pages.error;
+    }
+    free(pages.addresses);
+    if (fclose(file) != 0 || failed) {
+        fprintf(stderr, "Failed to write checkpoint file: %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+static void release_mapping(void *base, size_t len) {
+    munmap(base, len);
+}
+#endif
+
+static void release_buffer(void *base, size_t len) {
+    (void)len;
+    free(base);
+}
+
+// Map the whole file private and writable (pages are copy-on-write), or read
+// it into a heap buffer where mapping is unavailable
+static uint8_t *open_snapshot(const char *filename, size_t *size, void (**release)(void *, size_t)) {
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+        void *p = mmap(NULL, (size_t)sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            close(fd);
+            *size = (size_t)sb.st_size;
+            *release = release_mapping;
+            return p;
+        }
+    }
+    close(fd);
+#endif
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        return NULL;
+    }
+    uint8_t *buf = NULL;
+    long len = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (len = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        buf = malloc((size_t)len);
+        if (buf && fread(buf, 1, (size_t)len, file) != (size_t)len) {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(file);
+    *size = (size_t)len;
+    *release = release_buffer;
+    return buf;
+}
+
+int checkpoint_restore(Sim_t *sim, const char *filename) {
+    size_t size = 0;
+    void (*release)(void *, size_t) = NULL;
+    uint8_t *base = open_snapshot(filename, &size, &release);
+    if (!base) {
+        fprintf(stderr, "Failed to open checkpoint file: %s\n", filename);
+        return -1;
+    }
+    CheckpointHeader_t h;
+    if (size < sizeof(h)) {
+        fprintf(stderr, "%s: not a checkpoint\n", filename);
+        release(base, size);
+        return -1;
+    }
+    memcpy(&h, base, sizeof(h));
+    if (memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 || h.version != CHECKPOINT_VERSION ||
+        h.byte_order != CHECKPOINT_BYTE_ORDER || h.header_size != sizeof(h) ||
+        h.pipeline_size != sizeof(Pipeline_t) || h.predictor_size != sizeof(BranchPredictor_t) ||
+        h.cache_line_size != sizeof(CacheLine_t) || h.page_size != PAGE_SIZE) {
+        fprintf(stderr, "%s: not a checkpoint from this simulator build\n", filename);
+        release(base, size);
+        return -1;
+    }
+    if (h.text_offset + (uint64_t)h.instr_count * 4 > size ||
+        h.page_index_offset + (uint64_t)h.page_count * 4 > size ||
+        h.page_data_offset + (uint64_t)h.page_count * PAGE_SIZE > size || h.instr_count > 0x40000000u ||
+        h.icache_lines_offset > h.dcache_lines_offset || h.dcache_lines_offset > h.page_data_offset) {
+        fprintf(stderr, "%s: truncated checkpoint\n", filename);
+        release(base, size);
+        return -1;
+    }
+    if (h.has_pipeline && sim->config.functional) {
+        fprintf(stderr, "%s: checkpoint holds in-flight pipeline state; restore it without --functional\n",
+                filename);
+        release(base, size);
+        return -1;
+    }
+    ArchState_t *st = &sim->arch;
+    reg_init(st);
+    mem_free(st);
+    st->instr_mem = malloc((h.instr_count ? h.instr_count : 1) * sizeof(uint32_t));
+    if (!st->instr_mem) {
+        fprintf(stderr, "Failed to allocate instruction memory\n");
+        release(base, size);
+        return -1;
+    }
+    memcpy(st->instr_mem, base + h.text_offset, (size_t)h.instr_count * 4);
+    st->instr_count = (int)h.instr_count;
+    st->text_base = h.text_base;
+    st->entry = h.entry;
+    st->pc = h.pc;
+    memcpy(st->registers, h.registers, sizeof(st->registers));
+    st->hi = h.hi;
+    st->lo = h.lo;
+    // Pages stay in the snapshot mapping; the first write to each copies it
+    const uint8_t *index = base + h.page_index_offset;
+    for (uint32_t i = 0; i < h.page_count; ++i) {
+        uint32_t address;
+        memcpy(&address, index + (size_t)i * 4, sizeof(address));
+        memory_map_page(&st->mem, address, base + h.page_data_offset + (size_t)i * PAGE_SIZE);
+    }
+    memory_adopt(&st->mem, base, size, release);
+    if (h.has_pipeline) {
+        sim->pipe = h.pipe;
+    } else {
+        pipeline_reset(&sim->pipe, h.pc);
+    }
+    sim->cycle = (long)h.cycle;
+    sim->instructions = (long)h.instructions;
+    // Warm microarchitectural state when the configuration matches
+    bp_init(&sim->bp, sim->config.bp_policy);
+    if (h.bp.policy == sim->config.bp_policy) {
+        sim->bp = h.bp;
+    }
+    if (restore_cache(&sim->icache, &sim->config.icache, &h.icache, base + h.icache_lines_offset,
+                      (size_t)(h.dcache_lines_offset - h.icache_lines_offset)) < 0 ||
+        restore_cache(&sim->dcache, &sim->config.dcache, &h.dcache, base + h.dcache_lines_offset,
+                      (size_t)(h.page_data_offset - h.dcache_lines_offset)) < 0) {
+        return -1;
+    }
+    sim->icache_stall_cycles = (long)h.icache_stall_cycles;
+    sim->dcache_stall_cycles = (long)h.dcache_stall_cycles;
+    return (int)h.instr_count;
+}
@@ -0,0 +1,80 @@
+/**
+ * checkpoint.h - Save and restore complete simulator state in a mappable snapshot file.
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "config.h"
+#include "branch.h"
+#include "cache.h"
+#include "pipeline.h"
+
+#define CHECKPOINT_MAGIC "MIPSCKP1"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_BYTE_ORDER 0x01020304u
+
+// When a run writes its checkpoint
+enum CheckpointTrigger {
+    CKPT_NONE = 0,
+    CKPT_CYCLE,     /* once the cycle count reaches the value */
+    CKPT_INSTR,     /* once the completed instruction count reaches the value */
+    CKPT_PC         /* once the instruction at the address completes */
+};
+
+// File layout (host byte order): this header, the text segment at
+// text_offset, the addresses of the saved pages at page_index_offset, the
+// cache line arrays, then the pages themselves, each PAGE_SIZE bytes at a
+// PAGE_SIZE-aligned offset from page_data_offset, so a restore maps them in
+// without copying. Predictor and cache state is only reused by a restore
+// configured with the same policy/geometry; otherwise they start cold.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;        // CHECKPOINT_BYTE_ORDER as written by the saving host
+    uint32_t header_size;
+    uint32_t pipeline_size;     // sizeof(Pipeline_t) of the saving build
+    uint32_t predictor_size;    // sizeof(BranchPredictor_t)
+    uint32_t cache_line_size;   // sizeof(CacheLine_t)
+    uint32_t page_size;
+    uint32_t has_pipeline;      // pipe holds in-flight state (saved by the pipeline model)
+    uint64_t cycle;
+    uint64_t instructions;
+    uint32_t text_base;
+    uint32_t entry;
+    uint32_t pc;                // architectural PC (functional model)
+    uint32_t instr_count;
+    uint32_t page_count;
+    uint64_t text_offset;
+    uint64_t page_index_offset;
+    uint64_t page_data_offset;
+    uint64_t icache_lines_offset;
+    uint64_t dcache_lines_offset;
+    int64_t icache_stall_cycles;
+    int64_t dcache_stall_cycles;
+    int32_t registers[NUM_REGS];
+    int32_t hi, lo;
+    Pipeline_t pipe;
+    BranchPredictor_t bp;
+    Cache_t icache;             // lines pointer is meaningless in the file
+    Cache_t dcache;
+} CheckpointHeader_t;
+
+struct Sim;
+
+// Parse a trigger "cycle:N", "inst:N" or "pc:ADDR". Returns 0 or -1 if invalid.
+int checkpoint_parse_trigger(const char *text, int *trigger, uint64_t *value);
+
+// Whether the configured trigger has fired. prev_pc is the architectural PC
+// before the last functional step.
+int checkpoint_due(const struct Sim *sim, uint32_t prev_pc);
+
+// Write the current state of sim. Returns 0 on success, -1 on error.
+int checkpoint_save(const struct Sim *sim, const char *filename);
+
+// Replace the architectural state, pipeline, predictor, caches and counts of
+// sim with a snapshot.
+// Returns number of instructions in the restored text segment, -1 on error.
+int checkpoint_restore(struct Sim *sim, const char *filename);
+
+#endif // CHECKPOINT_H
@@ -8,12 +8,46 @@
 
 // Constants for sizes
 #define NUM_REGS 32               /* number of registers (MIPS has 32 general purpose) */
-#define INST_MEM_SIZE 1024        /* instruction memory size in words */
-#define DATA_MEM_SIZE 4096        /* data memory size in bytes */
+#define PAGE_BITS 12              /* data memory page size: 4 KB */
+#define PAGE_TABLE_BITS 10        /* index bits per page-table level (2 levels) */
+#define MAX_DATA_IMAGES 8         /* --data segment images per run */
+#define MAX_DUMP_RANGES 16        /* --dump-mem ranges per run */
+
+// Branch prediction configuration
+#define BTB_SIZE 64               /* branch target buffer entries (direct-mapped) */
+#define PHT_SIZE 1024             /* pattern history table entries (power of two) */
+#define GSHARE_HISTORY_BITS 10    /* global history length used by gshare */
+#define BRANCH_FLUSH_PENALTY 2    /* IFID and IDEX slots squashed on a misprediction */
+
+// Multiply/divide unit defaults (cycles until HI/LO are ready, R3000-like)
+#define MULT_LATENCY 12
+#define DIV_LATENCY 35
+
+// Out-of-order core defaults (--ooo)
+#define OOO_ROB_SIZE 32           /* reorder buffer entries */
+#define OOO_WIDTH 2               /* fetch/dispatch/commit width and data bus results per cycle */
+#define OOO_ALU_UNITS 2
+#define OOO_MEM_UNITS 1           /* address units, one data cache port each */
+#define OOO_MULDIV_UNITS 1
+#define OOO_RS_SIZE 8             /* reservation station entries per unit class */
+#define OOO_LSQ_SIZE 16           /* loads and stores in flight */
+
+// Multicore system (--cores)
+#define MAX_CORES 64
+#define MC_QUANTUM 1000           /* cycles each core runs between synchronizations */
+#define BUS_TRANSFER_LATENCY 4    /* cycles for a cache-to-cache transfer or an upgrade */
+#define CORE_ID_REG 26            /* $k0 holds the core number at start ... */
+#define CORE_COUNT_REG 27         /* ... and $k1 the number of cores */
 
 // Debug/printing configuration
 #define DEBUG 0   /* Set to 1 for detailed pipeline debug output */
 
+// Host profiling of the simulator itself (--host-profile, see hostprof.h);
+// make -f makefile.sim PROFILE=1 sets it to 1
+#ifndef HOST_PROFILE
+#define HOST_PROFILE 0
+#endif
+
 // MIPS instruction field extraction macros
 #define OPCODE(instr)   (((instr) >> 26) & 0x3F)
 #define RS(instr)       (((instr) >> 21) & 0x1F)
@@ -23,6 +57,7 @@
 #define FUNCT(instr)    ((instr) & 0x3F)
 #define IMM16(instr)    ((uint16_t)((instr) & 0xFFFF))
 #define IMM_SE(instr)   ((int32_t)((int16_t)IMM16(instr)))  /* sign-extended immediate */
+#define IMM_ZE(instr)   ((int32_t)IMM16(instr))             /* zero-extended immediate */
 #define ADDR26(instr)   ((instr) & 0x03FFFFFF)             /* 26-bit address for jumps */
 
 // ALU operation codes (for internal use)
@@ -39,4 +74,21 @@ enum ALUOps {
     ALU_SRL
 };
 
+// Multiply/divide unit operations (results go to HI/LO)
+enum MulDivOps {
+    MD_NONE = 0,
+    MD_MULT,
+    MD_MULTU,
+    MD_DIV,
+    MD_DIVU
+};
+
+// Engine templates: each specialized copy (pipeline variants, lane loop
+// forms) gets its own inlined body
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
 #endif // CONFIG_H
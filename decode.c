@@ -0,0 +1,227 @@
+/**
+ * decode.c - Instruction decoder (opcode/funct to control signals).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "decode.h"
+
+void decode_instr(uint32_t instr, uint32_t pc, DecodedInst_t *d) {
+    uint8_t op = OPCODE(instr);
+    memset(d, 0, sizeof(*d));
+    d->instr = instr;
+    d->ALUop = ALU_NOP;
+    if (op == 0x00) {
+        // R-type instructions
+        uint8_t funct = FUNCT(instr);
+        d->regWrite = 1;
+        d->destReg = RD(instr);
+        d->srcA = RS(instr);
+        d->srcB = RT(instr);
+        switch (funct) {
+            case 0x20: case 0x21: // ADD/ADDU
+                d->ALUop = ALU_ADD;
+                break;
+            case 0x22: case 0x23: // SUB/SUBU
+                d->ALUop = ALU_SUB;
+                break;
+            case 0x24: // AND
+                d->ALUop = ALU_AND;
+                break;
+            case 0x25: // OR
+                d->ALUop = ALU_OR;
+                break;
+            case 0x26: // XOR
+                d->ALUop = ALU_XOR;
+                break;
+            case 0x27: // NOR
+                d->ALUop = ALU_NOR;
+                break;
+            case 0x2A: // SLT
+                d->ALUop = ALU_SLT;
+                break;
+            case 0x00: // SLL
+            case 0x02: // SRL
+                d->ALUop = (funct == 0x00) ? ALU_SLL : ALU_SRL;
+                // The value to shift comes from rt, the amount from shamt
+                d->srcA = RT(instr);
+                d->srcB = 0;
+                d->imm = SHAMT(instr);
+                d->useImm = 1;
+                break;
+            case 0x08: // JR
+                d->regWrite = 0;
+                d->jump = 2;
+                d->srcB = 0;
+                break;
+            case 0x18: case 0x19: case 0x1A: case 0x1B: // MULT/MULTU/DIV/DIVU
+                // Results go to HI/LO in the multiply/divide unit
+                d->regWrite = 0;
+                d->destReg = 0;
+                d->muldiv = MD_MULT + (funct - 0x18);
+                break;
+            case 0x0C: // SYSCALL
+                // Always "writes" $v0 (unchanged unless the service returns
+                // a value) so forwarding and hazards need no special case
+                d->syscall = 1;
+                d->srcA = 2;
+                d->srcB = 4;
+                d->destReg = 2;
+                break;
+            case 0x10: case 0x12: // MFHI/MFLO
+                // HI/LO is read in ID and passed through the ALU
+                d->hilo = (funct == 0x10) ? 1 : 2;
+                d->srcA = 0;
+                d->srcB = 0;
+                d->ALUop = ALU_ADD;
+                d->useImm = 1;
+                break;
+            default:
+                // Unsupported funct
+                d->invalid = 1;
+                d->regWrite = 0;
+                d->destReg = 0;
+                d->srcA = 0;
+                d->srcB = 0;
+                break;
+        }
+    } else {
+        // I-type or J-type
+        d->imm = IMM_SE(instr);
+        switch (op) {
+            case 0x08: case 0x09: // ADDI/ADDIU
+            case 0x0A: // SLTI
+            case 0x0C: case 0x0D: case 0x0E: // ANDI/ORI/XORI
+            case 0x0F: // LUI
+                d->regWrite = 1;
+                d->destReg = RT(instr);
+                d->srcA = RS(instr);
+                d->useImm = 1;
+                if (op == 0x0A) {
+                    d->ALUop = ALU_SLT;
+                } else if (op >= 0x0C && op <= 0x0E) {
+                    // Logical immediates are zero-extended
+                    static const uint8_t logic_ops[] = { ALU_AND, ALU_OR, ALU_XOR };
+                    d->ALUop = logic_ops[op - 0x0C];
+                    d->imm = IMM_ZE(instr);
+                } else {
+                    d->ALUop = ALU_ADD;
+                }
+                if (op == 0x0F) {
+                    // LUI: $zero + (imm << 16)
+                    d->srcA = 0;
+                    d->imm = (int32_t)((uint32_t)IMM16(instr) << 16);
+                }
+                break;
+            case 0x20: case 0x21: case 0x23: case 0x24: case 0x25: // LB/LH/LW/LBU/LHU
+            case 0x30: // LL
+                d->regWrite = 1;
+                d->memRead = 1;
+                d->destReg = RT(instr);
+                d->srcA = RS(instr);
+                d->ALUop = ALU_ADD;
+                d->useImm = 1;
+                d->memSize = (op == 0x23 || op == 0x30) ? 4 : (op & 1) ? 2 : 1;
+                d->memSigned = (op < 0x23);
+                d->llsc = (op == 0x30) ? LLSC_LL : LLSC_NONE;
+                break;
+            case 0x28: case 0x29: case 0x2B: // SB/SH/SW
+            case 0x38: // SC
+                d->memWrite = 1;
+                d->srcA = RS(instr);
+                d->srcB = RT(instr);
+                d->ALUop = ALU_ADD;
+                d->useImm = 1;
+                d->memSize = (op == 0x2B || op == 0x38) ? 4 : (op & 1) ? 2 : 1;
+                if (op == 0x38) {
+                    // The success flag goes to rt through the load result path
+                    d->llsc = LLSC_SC;
+                    d->memRead = 1;
+                    d->regWrite = 1;
+                    d->destReg = RT(instr);
+                }
+                break;
+            case 0x04: // BEQ
+            case 0x05: // BNE
+                d->branch = (op == 0x04) ? 1 : 2;
+                d->srcA = RS(instr);
+                d->srcB = RT(instr);
+                d->ALUop = ALU_SUB;
+                d->target = pc + 4 + ((uint32_t)d->imm << 2);
+                break;
+            case 0x02: case 0x03: // J/JAL
+                d->jump = 1;
+                d->imm = ADDR26(instr);
+                d->target = (pc & 0xF0000000) | ((uint32_t)d->imm << 2);
+                if (op == 0x03) {
+                    // Return address written through the normal result path
+                    d->regWrite = 1;
+                    d->destReg = 31;
+                }
+                break;
+            default:
+                // Unsupported opcode
+                d->invalid = 1;
+                break;
+        }
+    }
+    // Dispatch class for engines that execute decoded instructions directly
+    if (d->invalid) {
+        d->kind = KIND_INVALID;
+    } else if (d->jump) {
+        d->kind = (d->jump == 2) ? KIND_JR : d->regWrite ? KIND_JAL : KIND_J;
+    } else if (d->branch) {
+        d->kind = (d->branch == 1) ? KIND_BEQ : KIND_BNE;
+    } else if (d->llsc == LLSC_SC) {
+        d->kind = KIND_SC;
+    } else if (d->memWrite) {
+        d->kind = KIND_STORE;
+    } else if (d->muldiv) {
+        d->kind = KIND_MULDIV;
+    } else if (d->syscall) {
+        d->kind = KIND_SYSCALL;
+    } else if (d->regWrite && d->destReg != 0) {
+        d->kind = d->memRead ? KIND_LOAD : (d->hilo == 1) ? KIND_MFHI : (d->hilo == 2) ? KIND_MFLO : KIND_ALU;
+    } else {
+        d->kind = KIND_NOP;
+    }
+}
+
+const char *decode_name(uint32_t instr) {
+    static const char *const functs[64] = {
+        [0x00] = "sll", [0x02] = "srl", [0x03] = "sra", [0x04] = "sllv", [0x06] = "srlv",
+        [0x07] = "srav", [0x08] = "jr", [0x09] = "jalr", [0x0C] = "syscall", [0x0D] = "break",
+        [0x10] = "mfhi", [0x11] = "mthi", [0x12] = "mflo", [0x13] = "mtlo",
+        [0x18] = "mult", [0x19] = "multu", [0x1A] = "div", [0x1B] = "divu",
+        [0x20] = "add", [0x21] = "addu", [0x22] = "sub", [0x23] = "subu",
+        [0x24] = "and", [0x25] = "or", [0x26] = "xor", [0x27] = "nor",
+        [0x2A] = "slt", [0x2B] = "sltu"
+    };
+    static const char *const opcodes[64] = {
+        [0x01] = "regimm", [0x02] = "j", [0x03] = "jal", [0x04] = "beq", [0x05] = "bne",
+        [0x06] = "blez", [0x07] = "bgtz", [0x08] = "addi", [0x09] = "addiu", [0x0A] = "slti",
+        [0x0B] = "sltiu", [0x0C] = "andi", [0x0D] = "ori", [0x0E] = "xori", [0x0F] = "lui",
+        [0x1C] = "special2", [0x20] = "lb", [0x21] = "lh", [0x23] = "lw", [0x24] = "lbu",
+        [0x25] = "lhu", [0x28] = "sb", [0x29] = "sh", [0x2B] = "sw", [0x30] = "ll", [0x38] = "sc"
+    };
+    if (instr == 0) {
+        return "nop";
+    }
+    const char *name = (OPCODE(instr) == 0) ? functs[FUNCT(instr)] : opcodes[OPCODE(instr)];
+    return name ? name : "?";
+}
+
+DecodedInst_t *decode_program(const ArchState_t *st) {
+    int count = st->instr_count;
+    DecodedInst_t *table = malloc((count > 0 ? count : 1) * sizeof(DecodedInst_t));
+    if (!table) {
+        fprintf(stderr, "Failed to allocate decode table\n");
+        return NULL;
+    }
+    for (int i = 0; i < count; ++i) {
+        decode_instr(instr_read(st, i), st->text_base + (uint32_t)i * 4, &table[i]);
+    }
+    return table;
+}
@@ -0,0 +1,72 @@
+/**
+ * decode.h - Instruction decoder shared by the pipeline and the functional engine.
+ */
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <stdint.h>
+#include "util.h"
+
+// Dispatch classes for a decoded instruction
+enum DecodeKind {
+    KIND_NOP = 0,     /* no architectural effect (bubble, write to $zero) */
+    KIND_ALU,         /* ALU operation writing destReg */
+    KIND_LOAD,        /* memSize bytes, sign-extended if memSigned */
+    KIND_STORE,
+    KIND_BEQ,
+    KIND_BNE,
+    KIND_J,
+    KIND_JR,
+    KIND_JAL,         /* J that also writes the return address to $ra */
+    KIND_MULDIV,      /* multiply/divide unit operation writing HI/LO */
+    KIND_MFHI,
+    KIND_MFLO,
+    KIND_SYSCALL,     /* reads $v0/$a0, may write $v0, may end the program */
+    KIND_SC,          /* store-conditional: stores rt if the link holds, rt = 1 on success else 0 */
+    KIND_INVALID      /* opcode/funct the simulator does not implement: stops the run with an error */
+};
+
+// Load-linked/store-conditional flavour of a load or store
+enum LlscOp {
+    LLSC_NONE = 0,
+    LLSC_LL,          /* LL: a word load that also sets the link */
+    LLSC_SC           /* SC: a word store; also flagged memRead, since its result
+                         (the success flag) becomes known in MEM like a load's */
+};
+
+// Ready-to-dispatch form of one instruction
+typedef struct {
+    uint32_t instr;
+    uint32_t target;  // precomputed branch/jump target (unused for JR)
+    int32_t imm;      // sign-extended immediate or shift amount
+    uint8_t kind;     // one of DecodeKind
+    uint8_t ALUop;
+    uint8_t srcA;     // register feeding operand A (rs_val), 0 if none
+    uint8_t srcB;     // register feeding operand B / store value (rt_val), 0 if none
+    uint8_t destReg;
+    uint8_t regWrite;
+    uint8_t memRead;
+    uint8_t memWrite;
+    uint8_t branch;   // 1 for beq, 2 for bne
+    uint8_t jump;     // 1 for J/JAL, 2 for JR (JAL also sets regWrite)
+    uint8_t useImm;   // operand B comes from imm instead of rt_val
+    uint8_t memSize;  // bytes accessed by a load/store: 1, 2 or 4
+    uint8_t memSigned;  // sub-word load is sign-extended
+    uint8_t muldiv;   // MulDivOps of a multiply/divide, MD_NONE otherwise
+    uint8_t hilo;     // 1: reads HI (MFHI), 2: reads LO (MFLO)
+    uint8_t syscall;  // SYSCALL (service in $v0, argument in $a0, result in $v0)
+    uint8_t llsc;     // LlscOp of LL/SC, LLSC_NONE otherwise
+    uint8_t invalid;  // KIND_INVALID: no other control signal is set
+} DecodedInst_t;
+
+// Decode a single instruction located at address pc.
+void decode_instr(uint32_t instr, uint32_t pc, DecodedInst_t *d);
+
+// Assembler mnemonic of an instruction word ("nop" for 0, "?" if unknown).
+const char *decode_name(uint32_t instr);
+
+// Decode the whole loaded instruction memory into a table indexed by PC/4.
+// Returns a malloc'd table of st->instr_count entries, or NULL on failure.
+DecodedInst_t *decode_program(const ArchState_t *st);
+
+#endif // DECODE_H
@@ -0,0 +1,384 @@
+/**
+ * dual.c - Cycle-by-cycle 2-wide in-order pipeline: paired fetch, issue and retire.
+ */
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "hazard.h"
+#include "alu.h"
+#include "decode.h"
+#include "branch.h"
+#include "cache.h"
+#include "stats.h"
+#include "syscall.h"
+#include "sim.h"
+#include "pipeline.h"
+#include "dual.h"
+#include "multicore.h"
+
+static const char *split_names[SPLIT_COUNT] = {
+    "none", "alone", "memory", "branch", "raw", "muldiv", "syscall", "stall"
+};
+
+const char *dual_split_name(int reason) {
+    return (reason >= 0 && reason < SPLIT_COUNT) ? split_names[reason] : "?";
+}
+
+static void write_back(struct Sim *sim, const MEMWB_t *wb) {
+    if (wb->valid && wb->regWrite) {
+        reg_write(&sim->arch, wb->destReg, wb->write_val);
+    }
+}
+
+// MEM stage of one slot
+static void memory_stage(struct Sim *sim, const EXMEM_t *in, MEMWB_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->instr = in->instr;
+    out->pc = in->pc;
+    out->valid = in->valid;
+    out->destReg = in->destReg;
+    out->regWrite = in->regWrite;
+    if (!in->valid) {
+        return;
+    }
+    if (in->memRead || in->memWrite) {
+        // A pair holds at most one load/store, so this is the only access
+        sim->pipe.mem_stall = cache_access(&sim->dcache, (uint32_t)in->alu_result, in->memWrite);
+    }
+    if (in->llsc == LLSC_SC) {
+        out->write_val = mc_store_conditional(sim, (uint32_t)in->alu_result, in->store_val);
+    } else if (in->memRead) {
+        out->write_val = mem_read_sized(&sim->arch, (uint32_t)in->alu_result, in->memSize, in->memSigned);
+    } else {
+        out->write_val = in->alu_result;
+    }
+    if (in->memWrite && in->llsc != LLSC_SC) {
+        mem_write_sized(&sim->arch, (uint32_t)in->alu_result, in->memSize, in->store_val);
+    }
+}
+
+// Newest in-flight value of register src for an EX operand: MEM before WB and,
+// within a stage, the younger slot first. A load in MEM is never forwarded.
+static void forward(const Pipeline_t *p, uint8_t src, int32_t *val) {
+    if (src == 0) {
+        return;
+    }
+    const EXMEM_t *mem[2] = { &p->EXMEM2, &p->EXMEM };
+    const MEMWB_t *wb[2] = { &p->MEMWB2, &p->MEMWB };
+    for (int i = 0; i < 2; ++i) {
+        if (mem[i]->valid && mem[i]->regWrite && !mem[i]->memRead && mem[i]->destReg == src) {
+            *val = mem[i]->alu_result;
+            return;
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        if (wb[i]->valid && wb[i]->regWrite && wb[i]->destReg == src) {
+            *val = wb[i]->write_val;
+            return;
+        }
+    }
+}
+
+// EX stage of one slot. Sets *mispredict and *redirect_pc for a wrongly
+// predicted branch or jump; returns 1 if a SYSCALL or an invalid instruction
+// ended the program.
+static int execute_stage(struct Sim *sim, IDEX_t *x, EXMEM_t *out, int *mispredict, uint32_t *redirect_pc) {
+    memset(out, 0, sizeof(*out));
+    out->instr = x->instr;
+    out->pc = x->pc;
+    out->valid = x->valid;
+    out->destReg = x->destReg;
+    out->regWrite = x->regWrite;
+    out->memRead = x->memRead;
+    out->memWrite = x->memWrite;
+    out->memSize = x->memSize;
+    out->memSigned = x->memSigned;
+    out->llsc = x->llsc;
+    if (!x->valid) {
+        return 0;
+    }
+    if (sim->config.forwarding) {
+        forward(&sim->pipe, x->rs, &x->rs_val);
+        forward(&sim->pipe, x->rt, &x->rt_val);
+    }
+    int branch_taken = 0;
+    uint32_t branch_target = 0;
+    if (x->jump) {
+        branch_taken = 1;
+        branch_target = (x->jump == 1) ? x->target : (uint32_t)x->rs_val;
+        if (x->regWrite) {
+            out->alu_result = (int32_t)(x->pc + 4);
+        }
+    } else {
+        if (x->branch) {
+            branch_target = x->target;
+            int equal = (x->rs_val == x->rt_val);
+            branch_taken = (x->branch == 1) ? equal : !equal;
+        }
+        out->alu_result = alu_execute(x->ALUop, x->rs_val, x->useImm ? x->imm : x->rt_val);
+    }
+    if (x->muldiv) {
+        alu_muldiv(x->muldiv, x->rs_val, x->rt_val, &sim->arch.hi, &sim->arch.lo);
+        int latency = (x->muldiv <= MD_MULTU) ? sim->config.mult_latency : sim->config.div_latency;
+        sim->pipe.md_busy = latency - 1;
+        sim->pipe.md_pc = x->pc;
+    }
+    int exited = 0;
+    if (x->syscall) {
+        exited = syscall_exec(sim, x->pc, x->rs_val, x->rt_val, &out->alu_result);
+    }
+    if (x->invalid) {
+        exited = sim_invalid(sim, x->pc, x->instr);
+    }
+    if (x->memWrite) {
+        out->store_val = x->rt_val;
+    }
+    if (x->jump || x->branch) {
+        uint32_t actual_next = branch_taken ? branch_target : x->pc + 4;
+        uint32_t predicted_next = x->pred_taken ? x->pred_target : x->pc + 4;
+        *mispredict = (actual_next != predicted_next);
+        *redirect_pc = actual_next;
+        bp_update(&sim->bp, x->pc, x->jump != 0, branch_taken, branch_target, *mispredict);
+    }
+    return exited;
+}
+
+// ID stage of one slot: control signals from the decode table, register reads
+static void decode_stage(struct Sim *sim, const IFID_t *in, IDEX_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!in->valid) {
+        return;
+    }
+    const DecodedInst_t *d = &sim->decoded[(in->pc - sim->arch.text_base) / 4];
+    out->instr = in->instr;
+    out->pc = in->pc;
+    out->valid = 1;
+    out->rs = d->srcA;
+    out->rt = d->srcB;
+    out->rd = RD(in->instr);
+    out->imm = d->imm;
+    out->target = d->target;
+    out->useImm = d->useImm;
+    out->destReg = d->destReg;
+    out->regWrite = d->regWrite;
+    out->memRead = d->memRead;
+    out->memWrite = d->memWrite;
+    out->ALUop = d->ALUop;
+    out->branch = d->branch;
+    out->jump = d->jump;
+    out->memSize = d->memSize;
+    out->memSigned = d->memSigned;
+    out->llsc = d->llsc;
+    out->muldiv = d->muldiv;
+    out->syscall = d->syscall;
+    out->invalid = d->invalid;
+    out->pred_taken = in->pred_taken;
+    out->pred_target = in->pred_target;
+    out->rs_val = reg_read(&sim->arch, d->srcA);
+    out->rt_val = reg_read(&sim->arch, d->srcB);
+    if (d->hilo) {
+        out->rs_val = (d->hilo == 1) ? sim->arch.hi : sim->arch.lo;
+    }
+}
+
+// Hazard of the ID instruction d against both slots of EX and MEM and the
+// multiply/divide unit. Returns a HazardSource (HAZARD_NONE if it can issue)
+// and sets *producer to the PC of the instruction waited for.
+static int older_hazard(const struct Sim *sim, const DecodedInst_t *d, uint32_t *producer) {
+    const Pipeline_t *p = &sim->pipe;
+    int forwarding = sim->config.forwarding;
+    int hazard = hazard_detect_data(p->IDEX2.regWrite, p->EXMEM2.regWrite, p->IDEX2.destReg,
+                                    p->EXMEM2.destReg, d->srcA, d->srcB, p->IDEX2.memRead, forwarding);
+    if (hazard) {
+        *producer = (hazard == HAZARD_IDEX) ? p->IDEX2.pc : p->EXMEM2.pc;
+        return hazard;
+    }
+    hazard = hazard_detect_data(p->IDEX.regWrite, p->EXMEM.regWrite, p->IDEX.destReg,
+                                p->EXMEM.destReg, d->srcA, d->srcB, p->IDEX.memRead, forwarding);
+    if (hazard) {
+        *producer = (hazard == HAZARD_IDEX) ? p->IDEX.pc : p->EXMEM.pc;
+        return hazard;
+    }
+    *producer = p->md_pc;
+    return hazard_detect_muldiv(d->muldiv || d->hilo, p->md_busy);
+}
+
+// Pairing rules for the older instruction a and the younger b. Returns the
+// IssueSplit reason that keeps them apart, SPLIT_NONE if they may pair.
+static int pair_conflict(const DecodedInst_t *a, const DecodedInst_t *b) {
+    if (a->syscall || b->syscall) {
+        return SPLIT_SYSCALL;
+    }
+    if ((a->memRead || a->memWrite) && (b->memRead || b->memWrite)) {
+        return SPLIT_MEM;
+    }
+    if ((a->branch || a->jump) && (b->branch || b->jump)) {
+        return SPLIT_BRANCH;
+    }
+    if ((a->muldiv || a->hilo) && (b->muldiv || b->hilo)) {
+        return SPLIT_MULDIV;
+    }
+    if (a->regWrite && a->destReg != 0 && (a->destReg == b->srcA || a->destReg == b->srcB)) {
+        return SPLIT_RAW;
+    }
+    return SPLIT_NONE;
+}
+
+// The second instruction of a fetch group must come from the same cache line
+static int same_fetch_line(const struct Sim *sim, uint32_t pc) {
+    if (!sim->icache.lines) {
+        return 1;
+    }
+    uint32_t line = sim->icache.config.line_size;
+    return pc / line == (pc + 4) / line;
+}
+
+int dual_step(struct Sim *sim) {
+    Pipeline_t *p = &sim->pipe;
+    sim->cycle++;
+    if (p->md_busy > 0) {
+        p->md_busy--;
+    }
+    if (p->mem_stall > 0) {
+        p->mem_stall--;
+        sim->dcache_stall_cycles++;
+        return 1;
+    }
+    // WB: the younger slot writes last, so it wins a same-register pair
+    write_back(sim, &p->MEMWB);
+    write_back(sim, &p->MEMWB2);
+    if (!p->fetch_enable && !p->IFID.valid && !p->IDEX.valid && !p->EXMEM.valid && !p->MEMWB.valid &&
+        !p->IFID2.valid && !p->IDEX2.valid && !p->EXMEM2.valid && !p->MEMWB2.valid) {
+        return 0;
+    }
+    MEMWB_t MEMWB_new[2];
+    memory_stage(sim, &p->EXMEM, &MEMWB_new[0]);
+    memory_stage(sim, &p->EXMEM2, &MEMWB_new[1]);
+    // EX: the younger slot is on the path predicted after the older one, so a
+    // misprediction or exit in the older slot squashes it before it executes
+    EXMEM_t EXMEM_new[2];
+    int mispredict = 0;
+    uint32_t redirect_pc = 0;
+    int exited = execute_stage(sim, &p->IDEX, &EXMEM_new[0], &mispredict, &redirect_pc);
+    if (mispredict || exited) {
+        memset(&EXMEM_new[1], 0, sizeof(EXMEM_new[1]));
+    } else {
+        exited = execute_stage(sim, &p->IDEX2, &EXMEM_new[1], &mispredict, &redirect_pc);
+    }
+    if (mispredict) {
+        p->PC = redirect_pc;
+        p->fetch_enable = !p->draining;
+        p->fetch_wait = 0;
+        p->fetch_ready = 0;
+        p->IFID = p->IFID2 = (IFID_t){0};
+        p->IDEX = p->IDEX2 = (IDEX_t){0};
+    }
+    if (exited) {
+        p->PC = sim->arch.text_base + (uint32_t)sim->arch.instr_count * 4;
+        p->fetch_enable = 0;
+        p->fetch_wait = 0;
+        p->fetch_ready = 0;
+        p->IFID = p->IFID2 = (IFID_t){0};
+        p->IDEX = p->IDEX2 = (IDEX_t){0};
+    }
+    IDEX_t IDEX_new[2];
+    decode_stage(sim, &p->IFID, &IDEX_new[0]);
+    decode_stage(sim, &p->IFID2, &IDEX_new[1]);
+    // IF: the instruction at PC and, unless it is predicted taken, the next
+    // one if it is in the same instruction cache line
+    IFID_t IFID_new[2] = { {0}, {0} };
+    uint32_t next_pc = p->PC;
+    uint32_t first_next_pc = p->PC;     // fetch PC after the first instruction only
+    if (p->fetch_enable) {
+        uint32_t index = (p->PC - sim->arch.text_base) / 4;
+        if (index < (uint32_t)sim->arch.instr_count) {
+            if (!p->fetch_ready) {
+                p->fetch_wait = cache_access(&sim->icache, p->PC, 0);
+                p->fetch_ready = 1;
+            }
+            if (p->fetch_wait > 0) {
+                p->fetch_wait--;
+                sim->icache_stall_cycles++;
+            } else {
+                p->fetch_ready = 0;
+                for (int i = 0; i < 2; ++i) {
+                    uint32_t pc = p->PC + (uint32_t)i * 4;
+                    if (i == 1 && (IFID_new[0].pred_taken || index + 1 >= (uint32_t)sim->arch.instr_count ||
+                                   !same_fetch_line(sim, p->PC))) {
+                        break;
+                    }
+                    IFID_new[i].instr = instr_read(&sim->arch, index + i);
+                    IFID_new[i].pc = pc;
+                    IFID_new[i].valid = 1;
+                    IFID_new[i].pred_taken = (uint8_t)bp_predict(&sim->bp, pc, &IFID_new[i].pred_target);
+                    next_pc = IFID_new[i].pred_taken ? IFID_new[i].pred_target : pc + 4;
+                    if (i == 0) {
+                        first_next_pc = next_pc;
+                    }
+                }
+            }
+        } else {
+            p->fetch_enable = 0;
+        }
+    }
+    // Issue: the older instruction waits for its producers; the younger one
+    // joins it unless the pairing rules or its own producers forbid it
+    int stall = 0;
+    int split = SPLIT_NONE;
+    if (p->IFID.valid) {
+        const DecodedInst_t *d = &sim->decoded[(p->IFID.pc - sim->arch.text_base) / 4];
+        uint32_t producer;
+        stall = older_hazard(sim, d, &producer);
+        if (stall && sim->stats.pc_exec) {
+            stats_stall(&sim->stats, stall, p->IFID.pc, producer);
+        }
+        if (!stall) {
+            if (p->IFID2.valid) {
+                const DecodedInst_t *d2 = &sim->decoded[(p->IFID2.pc - sim->arch.text_base) / 4];
+                split = pair_conflict(d, d2);
+                if (split == SPLIT_NONE && older_hazard(sim, d2, &producer)) {
+                    split = SPLIT_STALL;
+                }
+            } else {
+                split = SPLIT_ALONE;
+            }
+            sim->issue.issue_cycles++;
+            sim->issue.dual_issues += (split == SPLIT_NONE);
+            sim->issue.split[split]++;
+        }
+    }
+    if (stall) {
+        p->IDEX = p->IDEX2 = (IDEX_t){0};
+        if (IFID_new[0].valid) {
+            p->fetch_ready = 1;
+        }
+    } else if (split != SPLIT_NONE && p->IFID2.valid) {
+        // The older instruction issues alone; the younger one moves up and
+        // can pair with the first newly fetched instruction next cycle
+        p->IDEX = IDEX_new[0];
+        p->IDEX2 = (IDEX_t){0};
+        p->IFID = p->IFID2;
+        p->IFID2 = IFID_new[0];
+        p->PC = first_next_pc;
+    } else {
+        p->IDEX = IDEX_new[0];
+        p->IDEX2 = IDEX_new[1];
+        p->IFID = IFID_new[0];
+        p->IFID2 = IFID_new[1];
+        p->PC = next_pc;
+    }
+    p->EXMEM = EXMEM_new[0];
+    p->EXMEM2 = EXMEM_new[1];
+    p->MEMWB = MEMWB_new[0];
+    p->MEMWB2 = MEMWB_new[1];
+    if (p->MEMWB.valid && p->MEMWB.instr != 0) {
+        sim->instructions++;
+    }
+    if (p->MEMWB2.valid && p->MEMWB2.instr != 0) {
+        sim->instructions++;
+    }
+    if (sim->stats.pc_exec) {
+        stats_cycle(&sim->stats, sim);
+    }
+    return 1;
+}
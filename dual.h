@@ -0,0 +1,18 @@
+/**
+ * dual.h - Dual-issue (2-wide in-order) mode of the pipeline model.
+ */
+#ifndef DUAL_H
+#define DUAL_H
+
+struct Sim;
+
+// Simulate one clock cycle of the 2-wide pipeline. Up to two sequential
+// instructions from one instruction cache line are fetched together and issue
+// as a pair unless a pairing rule or a hazard of the younger one splits them.
+// Returns 0 once the pipeline has drained with no more instructions to fetch.
+int dual_step(struct Sim *sim);
+
+// Name of an IssueSplit reason.
+const char *dual_split_name(int reason);
+
+#endif // DUAL_H
@@ -0,0 +1,393 @@
+/**
+ * dump.c - Final-state dumps and golden-image verification.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "sim.h"
+#include "dump.h"
+
+#define STATE_REGS (NUM_REGS + 2)   /* $0-$31, HI, LO */
+#define MAX_DIFFS 20                /* mismatching locations listed by --verify */
+
+static const char *format_names[] = { "hex", "csv", "bin", "hash" };
+
+int dump_parse_format(const char *name) {
+    for (int i = 0; i < (int)(sizeof(format_names) / sizeof(format_names[0])); ++i) {
+        if (strcmp(name, format_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int dump_parse_range(const char *text, uint32_t *address, uint32_t *length) {
+    char *end;
+    unsigned long long a = strtoull(text, &end, 0);
+    if (end == text || *end != ':' || text[0] == '-') {
+        return -1;
+    }
+    const char *len_text = end + 1;
+    unsigned long long n = strtoull(len_text, &end, 0);
+    if (end == len_text || *end != '\0' || len_text[0] == '-' || n == 0 ||
+        a > 0xFFFFFFFFull || n > 0x100000000ull - a) {
+        return -1;
+    }
+    *address = (uint32_t)a;
+    *length = (uint32_t)n;
+    return 0;
+}
+
+static void put_word(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_word(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Ranges that start and end on word boundaries are shown as words, others as bytes
+static int range_is_words(uint32_t address, uint32_t length) {
+    return (address & 3) == 0 && (length & 3) == 0;
+}
+
+// Bytes in the state image of one context
+static size_t state_size(const SimConfig_t *c) {
+    size_t size = c->dump_regs ? STATE_REGS * 4 : 0;
+    for (int i = 0; i < c->num_dumps; ++i) {
+        size += c->dumps[i].length;
+    }
+    return size;
+}
+
+// Write the state image of the selection in sim to p (state_size bytes)
+static void state_image(const SimConfig_t *c, Sim_t *sim, uint8_t *p) {
+    if (c->dump_regs) {
+        for (int r = 0; r < NUM_REGS; ++r, p += 4) {
+            put_word(p, (uint32_t)reg_read(&sim->arch, r));
+        }
+        put_word(p, (uint32_t)sim->arch.hi);
+        put_word(p + 4, (uint32_t)sim->arch.lo);
+        p += 8;
+    }
+    for (int i = 0; i < c->num_dumps; ++i) {
+        uint32_t address = c->dumps[i].address;
+        uint32_t n = c->dumps[i].length;
+        // Whole words wherever the range allows
+        for (; n > 0 && (address & 3); --n) {
+            *p++ = (uint8_t)mem_read_byte(&sim->arch, address++);
+        }
+        for (; n >= 4; n -= 4, address += 4, p += 4) {
+            put_word(p, (uint32_t)mem_read_word(&sim->arch, address));
+        }
+        for (; n > 0; --n) {
+            *p++ = (uint8_t)mem_read_byte(&sim->arch, address++);
+        }
+    }
+}
+
+// 64-bit FNV-1a style hash taking the image eight bytes at a time
+static uint64_t state_hash(const uint8_t *bytes, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w = (uint64_t)get_word(bytes + i) | ((uint64_t)get_word(bytes + i + 4) << 32);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 32;
+    }
+    for (; i < len; ++i) {
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return h ^ (uint64_t)len;
+}
+
+// Describe the field of the image at offset: its size (4 for registers and
+// words, 1 for bytes of unaligned ranges) and its name in name
+static int field_at(const SimConfig_t *c, size_t offset, char *name, size_t cap) {
+    if (c->dump_regs) {
+        if (offset < STATE_REGS * 4) {
+            int r = (int)(offset / 4);
+            if (r < NUM_REGS) {
+                snprintf(name, cap, "$%d", r);
+            } else {
+                snprintf(name, cap, "%s", r == NUM_REGS ? "hi" : "lo");
+            }
+            return 4;
+        }
+        offset -= STATE_REGS * 4;
+    }
+    for (int i = 0; i < c->num_dumps; ++i) {
+        if (offset < c->dumps[i].length) {
+            snprintf(name, cap, "[0x%08x]", (unsigned)(c->dumps[i].address + (uint32_t)offset));
+            return range_is_words(c->dumps[i].address, c->dumps[i].length) ? 4 : 1;
+        }
+        offset -= c->dumps[i].length;
+    }
+    snprintf(name, cap, "(end)");
+    return 1;
+}
+
+// Which contexts the image holds: count images of each bytes, the one at i
+// labelled "<unit> <first + i>" (no labels for a single context, unit NULL)
+typedef struct {
+    int count;
+    size_t each;
+    const char *unit;
+    int first;
+} DumpGroup_t;
+
+// Format the image of context i as hex or CSV text into a memory buffer
+static char *format_text(const SimConfig_t *c, const DumpGroup_t *g, int i, const uint8_t *image, int csv,
+                         size_t *len) {
+    char *text = NULL;
+    FILE *f = open_memstream(&text, len);
+    if (!f) {
+        return NULL;
+    }
+    const uint8_t *p = image;
+    // CSV rows of a group carry the context number, hex gets a heading
+    char prefix[24] = "";
+    if (g->unit && csv) {
+        snprintf(prefix, sizeof(prefix), "%d,", g->first + i);
+    }
+    if (csv && i == 0) {
+        fprintf(f, "%s%slocation,value\n", g->unit ? g->unit : "", g->unit ? "," : "");
+    } else if (g->unit && !csv) {
+        fprintf(f, "%s %d:\n", g->unit, g->first + i);
+    }
+    if (c->dump_regs) {
+        for (int r = 0; r < STATE_REGS; ++r, p += 4) {
+            uint32_t v = get_word(p);
+            char name[8];
+            if (r < NUM_REGS) {
+                snprintf(name, sizeof(name), "$%d", r);
+            } else {
+                snprintf(name, sizeof(name), "%s", r == NUM_REGS ? "hi" : "lo");
+            }
+            if (csv) {
+                fprintf(f, "%s%s,%d\n", prefix, name, (int32_t)v);
+            } else {
+                fprintf(f, "%s=%08x%s", name, (unsigned)v, (r % 8 == 7 || r == STATE_REGS - 1) ? "\n" : " ");
+            }
+        }
+    }
+    for (int i = 0; i < c->num_dumps; ++i) {
+        uint32_t address = c->dumps[i].address;
+        uint32_t length = c->dumps[i].length;
+        int words = range_is_words(address, length);
+        int per_line = words ? 8 : 16;
+        int step = words ? 4 : 1;
+        if (!csv) {
+            fprintf(f, "Memory 0x%08x-0x%08x (%u bytes):", (unsigned)address,
+                    (unsigned)(address + length - 1), (unsigned)length);
+        }
+        for (uint32_t off = 0; off < length; off += step, p += step) {
+            uint32_t v = words ? get_word(p) : *p;
+            if (csv) {
+                fprintf(f, "%s0x%08x,%d\n", prefix, (unsigned)(address + off), words ? (int32_t)v : (int)v);
+            } else {
+                if ((off / step) % per_line == 0) {
+                    fprintf(f, "\n0x%08x:", (unsigned)(address + off));
+                }
+                fprintf(f, words ? " %08x" : " %02x", (unsigned)v);
+            }
+        }
+        if (!csv) {
+            fprintf(f, "\n");
+        }
+    }
+    if (fclose(f) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+// Write the dump of context i in the configured format with a single write
+static int write_one(const SimConfig_t *c, const DumpGroup_t *g, int i, const uint8_t *image, FILE *f) {
+    char *text = NULL;
+    char line[96];
+    const void *data = image;
+    size_t size = g->each;
+    if (c->dump_format == DUMP_HEX || c->dump_format == DUMP_CSV) {
+        text = format_text(c, g, i, image, c->dump_format == DUMP_CSV, &size);
+        if (!text) {
+            fprintf(stderr, "Failed to format the state dump\n");
+            return -1;
+        }
+        data = text;
+    } else if (c->dump_format == DUMP_HASH) {
+        unsigned long long hash = state_hash(image, g->each);
+        size = g->unit ? (size_t)snprintf(line, sizeof(line), "State hash of %s %d: 0x%016llx (%zu bytes)\n",
+                                          g->unit, g->first + i, hash, g->each)
+                       : (size_t)snprintf(line, sizeof(line), "State hash: 0x%016llx (%zu bytes)\n",
+                                          hash, g->each);
+        data = line;
+    }
+    int status = fwrite(data, 1, size, f) == size ? 0 : -1;
+    free(text);
+    return status;
+}
+
+// Write the dump of every context of the group, one write each; a group's
+// hash dump ends with the hash of the whole image, the value --verify takes
+static int write_dump(const SimConfig_t *c, const DumpGroup_t *g, const uint8_t *image, uint64_t hash,
+                      FILE *out) {
+    FILE *f = c->dump_file ? fopen(c->dump_file, "wb") : out;
+    int status = f ? 0 : -1;
+    for (int i = 0; i < g->count && status == 0; ++i) {
+        status = write_one(c, g, i, image + (size_t)i * g->each, f);
+    }
+    if (status == 0 && g->unit && c->dump_format == DUMP_HASH &&
+        fprintf(f, "Combined state hash: 0x%016llx (%zu bytes, %d %ss)\n", (unsigned long long)hash,
+                (size_t)g->count * g->each, g->count, g->unit) < 0) {
+        status = -1;
+    }
+    if (f && (c->dump_file ? fclose(f) : fflush(f)) != 0) {
+        status = -1;
+    }
+    if (status < 0) {
+        fprintf(stderr, "Failed to write the state dump%s%s\n", c->dump_file ? " to " : "",
+                c->dump_file ? c->dump_file : "");
+    }
+    return status;
+}
+
+// A golden "0x<hex>" hash instead of an image
+static int parse_hash(const char *text, uint64_t *hash) {
+    if (strncmp(text, "0x", 2) != 0 || text[2] == '\0' || strlen(text) > 18 ||
+        strspn(text + 2, "0123456789abcdefABCDEF") != strlen(text + 2)) {
+        return -1;
+    }
+    *hash = strtoull(text + 2, NULL, 16);
+    return 0;
+}
+
+static uint8_t *read_file(const char *filename, size_t *len) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Failed to open golden image: %s\n", filename);
+        return NULL;
+    }
+    uint8_t *data = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+        data = malloc(size ? (size_t)size : 1);
+    }
+    if (!data || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "Failed to read golden image: %s\n", filename);
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return data;
+}
+
+// List the locations where the state differs from the golden image
+static void report_diff(const SimConfig_t *c, const DumpGroup_t *g, const uint8_t *image, size_t len,
+                        const uint8_t *golden, size_t golden_len, FILE *out) {
+    if (golden_len != len) {
+        fprintf(out, "  golden image has %zu bytes, the selected state %zu\n", golden_len, len);
+    }
+    size_t common = len < golden_len ? len : golden_len;
+    long diffs = 0;
+    char name[48];
+    for (size_t off = 0; off < common;) {
+        // Locations in a group are named after their context too
+        size_t i = g->each ? off / g->each : 0;
+        int prefix = g->unit ? snprintf(name, sizeof(name), "%s %d ", g->unit, g->first + (int)i) : 0;
+        int size = field_at(c, off - i * g->each, name + prefix, sizeof(name) - (size_t)prefix);
+        if (off + (size_t)size > common) {
+            size = 1;
+        }
+        if (memcmp(image + off, golden + off, (size_t)size) != 0) {
+            if (diffs < MAX_DIFFS) {
+                uint32_t got = size == 4 ? get_word(image + off) : image[off];
+                uint32_t want = size == 4 ? get_word(golden + off) : golden[off];
+                fprintf(out, "  %s: expected 0x%0*x, got 0x%0*x\n", name, 2 * size, (unsigned)want,
+                        2 * size, (unsigned)got);
+            }
+            diffs++;
+        }
+        off += (size_t)size;
+    }
+    if (diffs > MAX_DIFFS) {
+        fprintf(out, "  ... %ld more differing locations\n", diffs - MAX_DIFFS);
+    }
+}
+
+// Compare the state with the golden hash or image. Returns 0 if it matches.
+static int verify(const SimConfig_t *c, const DumpGroup_t *g, const uint8_t *image, size_t len, uint64_t hash,
+                  FILE *out) {
+    uint64_t expected;
+    if (parse_hash(c->verify_file, &expected) == 0) {
+        if (hash == expected) {
+            fprintf(out, "Verify: OK (hash 0x%016llx)\n", (unsigned long long)hash);
+            return 0;
+        }
+        fprintf(out, "Verify: MISMATCH (hash 0x%016llx, expected 0x%016llx)\n",
+                (unsigned long long)hash, (unsigned long long)expected);
+        return -1;
+    }
+    size_t golden_len;
+    uint8_t *golden = read_file(c->verify_file, &golden_len);
+    if (!golden) {
+        return -1;
+    }
+    // A golden image is compared byte for byte: equal hashes alone could hide
+    // a collision
+    int status = 0;
+    if (golden_len == len && memcmp(image, golden, len) == 0) {
+        fprintf(out, "Verify: OK (%zu bytes match %s)\n", len, c->verify_file);
+    } else {
+        fprintf(out, "Verify: MISMATCH against %s\n", c->verify_file);
+        report_diff(c, g, image, len, golden, golden_len, out);
+        status = -1;
+    }
+    free(golden);
+    return status;
+}
+
+static int dump_group(Sim_t **sims, const DumpGroup_t *g, FILE *out) {
+    const SimConfig_t *c = &sims[0]->config;
+    if (!c->dump_regs && !c->num_dumps) {
+        return 0;
+    }
+    size_t len = (size_t)g->count * g->each;
+    uint8_t *image = malloc(len ? len : 1);
+    if (!image) {
+        fprintf(stderr, "Failed to allocate the state image (%zu bytes)\n", len);
+        return -1;
+    }
+    for (int i = 0; i < g->count; ++i) {
+        state_image(c, sims[i], image + (size_t)i * g->each);
+    }
+    uint64_t hash = state_hash(image, len);
+    int status = 0;
+    // Verification runs only write the dump when it has a file of its own
+    if (!c->verify_file || c->dump_file) {
+        status = write_dump(c, g, image, hash, out);
+    }
+    if (c->verify_file && verify(c, g, image, len, hash, out) < 0) {
+        status = -1;
+    }
+    free(image);
+    return status;
+}
+
+int dump_final_state(Sim_t *sim, FILE *out) {
+    DumpGroup_t g = { 1, state_size(&sim->config), NULL, 0 };
+    return dump_group(&sim, &g, out);
+}
+
+int dump_final_states(Sim_t **sims, int count, const char *unit, int first, FILE *out) {
+    DumpGroup_t g = { count, state_size(&sims[0]->config), unit, first };
+    return dump_group(sims, &g, out);
+}
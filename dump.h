@@ -0,0 +1,43 @@
+/**
+ * dump.h - Final-state dumps (registers and memory ranges) and verification
+ * against a golden image.
+ */
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+struct Sim;
+
+// Output formats of --dump-format
+enum DumpFormat {
+    DUMP_HEX = 0,   /* registers and words in hex, 8 per line */
+    DUMP_CSV,       /* location,value per register and word */
+    DUMP_BIN,       /* the raw state image (the golden image format of --verify) */
+    DUMP_HASH       /* 64-bit hash of the state image */
+};
+
+// Parse a format name ("hex", "csv", "bin", "hash"). Returns -1 if unknown.
+int dump_parse_format(const char *name);
+
+// Parse a memory range "<address>:<length>" (bytes, decimal or 0x hex).
+// Returns 0 on success, -1 if invalid or past the end of the address space.
+int dump_parse_range(const char *text, uint32_t *address, uint32_t *length);
+
+// Write the final-state dump and run the verification requested by the
+// configuration of sim (nothing if neither is). The state image holds the
+// selected registers ($0-$31, HI, LO as little-endian words) followed by
+// the bytes of each memory range in order. Results and program-facing text
+// go to out, the dump to --dump-file if one is given. Returns 0 on success,
+// -1 on a write error or a verification mismatch.
+int dump_final_state(struct Sim *sim, FILE *out);
+
+// The same for the count contexts of a --cores or --lanes run, which share
+// one configuration. Each context is dumped with its own write, labelled
+// "<unit> <first + i>". The state image is the images of all contexts in
+// order, so --verify compares the whole group against one golden image or
+// hash; the hash format ends with that combined hash.
+int dump_final_states(struct Sim **sims, int count, const char *unit, int first, FILE *out);
+
+#endif // DUMP_H
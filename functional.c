@@ -0,0 +1,168 @@
+/**
+ * functional.c - Functional execution engine over a predecoded instruction table.
+ */
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "alu.h"
+#include "sim.h"
+#include "jit.h"
+#include "syscall.h"
+#include "replay.h"
+#include "functional.h"
+
+// Execute decoded instruction d located at pc against regs; returns the next PC
+// (one past the end of the program once it has exited)
+static inline uint32_t functional_exec(struct Sim *sim, int32_t *regs,
+                                       const DecodedInst_t *d, uint32_t pc) {
+    ArchState_t *st = &sim->arch;
+    int32_t a = regs[d->srcA];
+    int32_t b = regs[d->srcB];
+    pc += 4;
+    switch (d->kind) {
+        case KIND_ALU:
+            regs[d->destReg] = alu_execute(d->ALUop, a, d->useImm ? d->imm : b);
+            regs[0] = 0;
+            break;
+        case KIND_LOAD:
+            if (d->memSize == 4) {
+                regs[d->destReg] = mem_read_word(st, (uint32_t)(a + d->imm));
+            } else {
+                regs[d->destReg] = mem_read_sized(st, (uint32_t)(a + d->imm), d->memSize, d->memSigned);
+            }
+            regs[0] = 0;
+            break;
+        case KIND_STORE:
+            if (d->memSize == 4) {
+                mem_write_word(st, (uint32_t)(a + d->imm), b);
+            } else {
+                mem_write_sized(st, (uint32_t)(a + d->imm), d->memSize, b);
+            }
+            break;
+        case KIND_SC:
+            // A single core keeps its link, so SC always succeeds
+            mem_write_sized(st, (uint32_t)(a + d->imm), d->memSize, b);
+            regs[d->destReg] = 1;
+            regs[0] = 0;
+            break;
+        case KIND_MULDIV:
+            alu_muldiv(d->muldiv, a, b, &st->hi, &st->lo);
+            break;
+        case KIND_MFHI:
+            regs[d->destReg] = st->hi;
+            break;
+        case KIND_MFLO:
+            regs[d->destReg] = st->lo;
+            break;
+        case KIND_SYSCALL:
+            if (syscall_exec(sim, pc - 4, a, b, &regs[2])) {
+                pc = st->text_base + (uint32_t)st->instr_count * 4;
+            }
+            break;
+        case KIND_BEQ:
+            if (a == b) {
+                pc = d->target;
+            }
+            break;
+        case KIND_BNE:
+            if (a != b) {
+                pc = d->target;
+            }
+            break;
+        case KIND_J:
+            pc = d->target;
+            break;
+        case KIND_JAL:
+            regs[31] = (int32_t)pc;
+            pc = d->target;
+            break;
+        case KIND_JR:
+            pc = (uint32_t)a;
+            break;
+        case KIND_INVALID:
+            sim_invalid(sim, pc - 4, d->instr);
+            pc = st->text_base + (uint32_t)st->instr_count * 4;
+            break;
+        default:
+            break;
+    }
+    return pc;
+}
+
+// Record what a timing replay cannot derive from the program text (see
+// replay.h), before d executes; SYSCALL outcomes are recorded after it
+static inline void record_outcome(Recorder_t *rec, const DecodedInst_t *d, const int32_t *regs) {
+    if (d->memRead || d->memWrite) {
+        recorder_event(rec, (uint32_t)(regs[d->srcA] + d->imm));
+    } else if (d->branch) {
+        int equal = (regs[d->srcA] == regs[d->srcB]);
+        recorder_event(rec, (uint32_t)(equal == (d->branch == 1)));
+    } else if (d->jump == 2) {
+        recorder_event(rec, (uint32_t)regs[d->srcA]);
+    }
+}
+
+long functional_run(struct Sim *sim, long limit) {
+    // Translated blocks where the host supports them; recording needs to see
+    // every instruction
+    long done = 0;
+    if (!sim->config.no_jit && !sim->recorder) {
+        long before = sim->instructions;
+        long executed = jit_run(sim, limit);
+        if (executed >= 0) {
+            return executed;
+        }
+        // A translator that gave up part way has already run some of the budget
+        done = sim->instructions - before;
+    }
+    ArchState_t *st = &sim->arch;
+    const DecodedInst_t *prog = sim->decoded;
+    uint32_t count = (uint32_t)st->instr_count;
+    uint32_t base = st->text_base;
+    // Work on a private copy of the register file; $zero is re-cleared after each write
+    int32_t regs[NUM_REGS];
+    memcpy(regs, st->registers, sizeof(regs));
+    regs[0] = 0;
+    Recorder_t *rec = sim->recorder;
+    long executed = 0;
+    uint32_t pc = st->pc;
+    while (((pc - base) >> 2) < count && executed < limit - done) {
+        const DecodedInst_t *d = &prog[(pc - base) >> 2];
+        if (rec) {
+            record_outcome(rec, d, regs);
+        }
+        pc = functional_exec(sim, regs, d, pc);
+        if (rec && d->syscall) {
+            recorder_event(rec, (uint32_t)sim->exited);
+        }
+        // Match the pipeline, which does not count all-zero nops as completed
+        executed += (d->instr != 0);
+    }
+    memcpy(st->registers, regs, sizeof(regs));
+    st->pc = pc;
+    sim->instructions += executed;
+    return done + executed;
+}
+
+uint32_t functional_exec_inst(struct Sim *sim, int32_t *regs, const DecodedInst_t *d, uint32_t pc) {
+    return functional_exec(sim, regs, d, pc);
+}
+
+int functional_step(struct Sim *sim) {
+    ArchState_t *st = &sim->arch;
+    uint32_t index = (st->pc - st->text_base) >> 2;
+    if (index >= (uint32_t)st->instr_count) {
+        return 0;
+    }
+    const DecodedInst_t *d = &sim->decoded[index];
+    if (sim->recorder) {
+        record_outcome(sim->recorder, d, st->registers);
+    }
+    st->pc = functional_exec(sim, st->registers, d, st->pc);
+    if (sim->recorder && d->syscall) {
+        recorder_event(sim->recorder, (uint32_t)sim->exited);
+    }
+    st->registers[0] = 0;
+    sim->instructions += (d->instr != 0);
+    return 1;
+}
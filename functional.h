@@ -0,0 +1,25 @@
+/**
+ * functional.h - Functional (architectural-only) execution engine.
+ */
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+
+#include <stdint.h>
+#include "decode.h"
+
+struct Sim;
+
+// Execute the predecoded program without modelling the pipeline, from the
+// architectural PC until it leaves the program or limit instructions (nops
+// excluded) have executed. Registers and data memory are updated in place.
+// Returns the number of instructions executed (nops excluded).
+long functional_run(struct Sim *sim, long limit);
+
+// Execute a single instruction. Returns 0 if the PC is already outside the program.
+int functional_step(struct Sim *sim);
+
+// Execute decoded instruction d located at pc against regs, a private copy of
+// the register file ($zero is re-cleared after writes). Returns the next PC.
+uint32_t functional_exec_inst(struct Sim *sim, int32_t *regs, const DecodedInst_t *d, uint32_t pc);
+
+#endif // FUNCTIONAL_H
@@ -1,24 +1,55 @@
 /**
- * hazard.c - Hazard detection logic (stall-based resolution).
+ * hazard.c - Hazard detection logic (stall-based or forwarding-based resolution).
  */
 #include "hazard.h"
 
 int hazard_detect_data(uint8_t id_ex_regWrite, uint8_t ex_mem_regWrite,
                        uint8_t id_ex_dest, uint8_t ex_mem_dest,
                        uint8_t if_id_rs, uint8_t if_id_rt,
-                       uint8_t id_ex_memRead) {
+                       uint8_t id_ex_memRead, int forwarding) {
+    if (forwarding) {
+        // Only a load in EX cannot forward in time: its value exists after MEM
+        if (id_ex_memRead && id_ex_regWrite && id_ex_dest != 0) {
+            if (id_ex_dest == if_id_rs || id_ex_dest == if_id_rt) {
+                return HAZARD_IDEX; // load-use hazard, stall
+            }
+        }
+        return HAZARD_NONE;
+    }
     // Data hazard conditions (no forwarding):
     // If the instruction in EX stage writes a register that the instruction in ID stage needs
     if (id_ex_regWrite && id_ex_dest != 0) {
         if (id_ex_dest == if_id_rs || id_ex_dest == if_id_rt) {
-            return 1; // hazard, stall
+            return HAZARD_IDEX; // hazard, stall
         }
     }
     // If the instruction in MEM stage writes a register that the ID stage instruction needs
     if (ex_mem_regWrite && ex_mem_dest != 0) {
         if (ex_mem_dest == if_id_rs || ex_mem_dest == if_id_rt) {
-            return 1; // hazard, stall
+            return HAZARD_EXMEM; // hazard, stall
         }
     }
-    return 0;
+    return HAZARD_NONE;
+}
+
+int hazard_detect_muldiv(uint8_t uses_unit, int unit_busy) {
+    // The unit is not pipelined and HI/LO have no forwarding path: readers
+    // and new operations wait until the running operation completes
+    return (uses_unit && unit_busy > 0) ? HAZARD_MULDIV : HAZARD_NONE;
+}
+
+int hazard_forward_select(uint8_t src,
+                          uint8_t ex_mem_regWrite, uint8_t ex_mem_dest, uint8_t ex_mem_memRead,
+                          uint8_t mem_wb_regWrite, uint8_t mem_wb_dest) {
+    if (src == 0) {
+        return FWD_NONE; // $zero is never forwarded
+    }
+    // The most recent producer wins
+    if (ex_mem_regWrite && !ex_mem_memRead && ex_mem_dest == src) {
+        return FWD_EXMEM;
+    }
+    if (mem_wb_regWrite && mem_wb_dest == src) {
+        return FWD_MEMWB;
+    }
+    return FWD_NONE;
 }
@@ -1,16 +1,44 @@
 /**
- * hazard.h - Hazard detection module interface.
+ * hazard.h - Hazard detection and forwarding unit interface.
  */
 #ifndef HAZARD_H
 #define HAZARD_H
 
 #include <stdint.h>
 
-// Check for data hazard (without forwarding) between pipeline stages.
-// Returns 1 if a stall is needed, 0 otherwise.
+// Pipeline register holding the producer a stalled instruction waits for
+enum HazardSource {
+    HAZARD_NONE = 0,
+    HAZARD_IDEX,    /* producer in EX */
+    HAZARD_EXMEM,   /* producer in MEM */
+    HAZARD_MULDIV   /* producer in the multiply/divide unit */
+};
+
+// Forwarding source selected for an EX-stage operand
+enum ForwardSel {
+    FWD_NONE = 0,   /* use the value read from the register file in ID */
+    FWD_EXMEM,      /* ALU result of the instruction in MEM */
+    FWD_MEMWB       /* write-back value of the instruction in WB */
+};
+
+// Check for a data hazard between the instruction in ID and those in EX/MEM.
+// Without forwarding any RAW dependency on IDEX or EXMEM stalls; with forwarding
+// only a load in IDEX feeding the ID instruction (load-use) stalls.
+// Returns the HazardSource of the stall, HAZARD_NONE (0) if none is needed.
 int hazard_detect_data(uint8_t id_ex_regWrite, uint8_t ex_mem_regWrite,
                        uint8_t id_ex_dest, uint8_t ex_mem_dest,
                        uint8_t if_id_rs, uint8_t if_id_rt,
-                       uint8_t id_ex_memRead);
+                       uint8_t id_ex_memRead, int forwarding);
+
+// Check whether an instruction in ID that uses the multiply/divide unit (MULT,
+// DIV, MFHI, MFLO) must wait for the unit to finish its current operation.
+// Returns HAZARD_MULDIV if so, HAZARD_NONE otherwise.
+int hazard_detect_muldiv(uint8_t uses_unit, int unit_busy);
+
+// Select the forwarding source for an operand read from register src by the
+// instruction in EX. A load in EXMEM is never forwarded (load-use stalls instead).
+int hazard_forward_select(uint8_t src,
+                          uint8_t ex_mem_regWrite, uint8_t ex_mem_dest, uint8_t ex_mem_memRead,
+                          uint8_t mem_wb_regWrite, uint8_t mem_wb_dest);
 
 #endif // HAZARD_H
@@ -0,0 +1,238 @@
+/**
+ * hostprof.c - Host-side profiling of the simulator: stage block timing,
+ * helper call counts and Linux perf event counters for the whole run.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "sim.h"
+#include "hostprof.h"
+
+#if HOST_PROFILE
+
+#include <errno.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+HostProfile_t host_profile;
+
+static uint64_t wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#if !(defined(__x86_64__) || defined(__i386__))
+uint64_t hp_now(void) {
+    return wall_ns();
+}
+#endif
+
+// Hardware counters read over the whole run
+enum {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_EVENTS
+};
+
+static const char *perf_names[PERF_EVENTS] = {
+    "cycles", "instructions", "branch-misses", "L1d read misses"
+};
+
+static const char *stage_names[HP_STAGES] = {
+    "WB", "MEM", "EX", "ID", "IF", "hazard", "latch", "observe", "idle"
+};
+
+static const char *call_names[HP_CALLS] = {
+    "reg_read", "mem_read_word", "instr_read", "alu_execute"
+};
+
+// Clocks and counters of the profiled run
+static struct {
+    uint64_t start_ticks, stop_ticks;
+    uint64_t start_ns, stop_ns;
+    uint64_t mark_ticks;    // cost of taking one timestamp
+    int fd[PERF_EVENTS];
+    uint64_t value[PERF_EVENTS];
+    int perf_errno;         // why a counter could not be opened
+} run;
+
+static void perf_start(void) {
+#if defined(__linux__)
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[PERF_EVENTS] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+    };
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // This thread, on any CPU
+        run.fd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (run.fd[i] < 0) {
+            run.perf_errno = errno;
+        }
+    }
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (run.fd[i] >= 0) {
+            ioctl(run.fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(run.fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        run.fd[i] = -1;
+    }
+    run.perf_errno = ENOSYS;
+#endif
+}
+
+static void perf_stop(void) {
+#if defined(__linux__)
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (run.fd[i] >= 0) {
+            ioctl(run.fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (run.fd[i] >= 0) {
+            if (read(run.fd[i], &run.value[i], sizeof(run.value[i])) != (ssize_t)sizeof(run.value[i])) {
+                run.value[i] = 0;
+            }
+            close(run.fd[i]);
+        }
+    }
+#endif
+}
+
+// Cost of one timestamp: the shortest of many back-to-back pairs
+static uint64_t mark_cost(void) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 1000; ++i) {
+        uint64_t t0 = hp_now();
+        uint64_t t1 = hp_now();
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+        }
+    }
+    return best;
+}
+
+int host_profile_start(void) {
+    memset(&host_profile, 0, sizeof(host_profile));
+    memset(&run, 0, sizeof(run));
+    run.mark_ticks = mark_cost();
+    perf_start();
+    run.start_ns = wall_ns();
+    run.start_ticks = hp_now();
+    host_profile.active = 1;
+    return 0;
+}
+
+void host_profile_stop(void) {
+    if (!host_profile.active) {
+        return;
+    }
+    host_profile.active = 0;
+    run.stop_ticks = hp_now();
+    run.stop_ns = wall_ns();
+    perf_stop();
+}
+
+void host_profile_report(const Sim_t *sim, FILE *out) {
+    // Timestamp ticks are calibrated against the wall clock over the run
+    double total_ns = (double)(run.stop_ns - run.start_ns);
+    uint64_t ticks = run.stop_ticks - run.start_ticks;
+    double ns_per_tick = ticks ? total_ns / (double)ticks : 0.0;
+    const char *unit = sim->config.functional ? "instruction" : "cycle";
+    long units = sim->config.functional ? sim->instructions : sim->cycle;
+    double per = units ? 1.0 / (double)units : 0.0;
+    fprintf(out, "Host profile: %.3f ms, %.2f ns per simulated %s (%ld %ss)\n",
+            total_ns / 1e6, total_ns * per, unit, units, unit);
+    // Each stage is charged for the timestamp that ends it; that cost is
+    // shown on its own
+    double staged = 0.0;
+    double marks_ns = 0.0;
+    for (int i = 0; i < HP_STAGES; ++i) {
+        double mark_ns = (double)host_profile.stage_marks[i] * (double)run.mark_ticks * ns_per_tick;
+        double ns = (double)host_profile.stage_ticks[i] * ns_per_tick - mark_ns;
+        if (ns < 0.0) {
+            ns = 0.0;
+        }
+        staged += ns;
+        marks_ns += mark_ns;
+        if (host_profile.stage_ticks[i]) {
+            fprintf(out, "  %-8s %9.2f ns/%s %6.1f%%\n", stage_names[i], ns * per, unit,
+                    total_ns > 0 ? 100.0 * ns / total_ns : 0.0);
+        }
+    }
+    // Engine dispatch and everything the stage blocks do not cover (the
+    // functional, dual-issue and out-of-order engines entirely)
+    double other = total_ns > staged + marks_ns ? total_ns - staged - marks_ns : 0.0;
+    fprintf(out, "  %-8s %9.2f ns/%s %6.1f%%\n", "other", other * per, unit,
+            total_ns > 0 ? 100.0 * other / total_ns : 0.0);
+    fprintf(out, "  %-8s %9.2f ns/%s %6.1f%%\n", "timing", marks_ns * per, unit,
+            total_ns > 0 ? 100.0 * marks_ns / total_ns : 0.0);
+    fprintf(out, "Helper calls:");
+    for (int i = 0; i < HP_CALLS; ++i) {
+        fprintf(out, "%s %s %ld (%.2f/%s)", i ? "," : "", call_names[i], host_profile.calls[i],
+                (double)host_profile.calls[i] * per, unit);
+    }
+    fprintf(out, "\n");
+    int opened = 0;
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        opened += (run.fd[i] >= 0);
+    }
+    if (!opened) {
+        fprintf(out, "Host counters: unavailable (%s)\n", strerror(run.perf_errno));
+        return;
+    }
+    fprintf(out, "Host counters:");
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (run.fd[i] >= 0) {
+            fprintf(out, "%s %s %llu", i ? "," : "", perf_names[i], (unsigned long long)run.value[i]);
+        } else {
+            fprintf(out, "%s %s n/a", i ? "," : "", perf_names[i]);
+        }
+    }
+    if (run.fd[PERF_CYCLES] >= 0 && run.fd[PERF_INSTRUCTIONS] >= 0 && run.value[PERF_CYCLES]) {
+        fprintf(out, " (IPC %.2f)", (double)run.value[PERF_INSTRUCTIONS] / (double)run.value[PERF_CYCLES]);
+    }
+    fprintf(out, "\n");
+}
+
+#else
+
+int host_profile_start(void) {
+    fprintf(stderr, "Host profiling is not compiled in (build with make -f makefile.sim PROFILE=1)\n");
+    return -1;
+}
+
+void host_profile_stop(void) {
+}
+
+void host_profile_report(const Sim_t *sim, FILE *out) {
+    (void)sim;
+    (void)out;
+}
+
+#endif // HOST_PROFILE
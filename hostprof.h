@@ -0,0 +1,92 @@
+/**
+ * hostprof.h - Profiling of the simulator itself on the host: time per
+ * pipeline stage block, calls into hot helpers and hardware counters.
+ *
+ * Compiled in only when HOST_PROFILE is 1 (make -f makefile.sim PROFILE=1);
+ * otherwise the hooks below expand to nothing.
+ */
+#ifndef HOSTPROF_H
+#define HOSTPROF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "config.h"
+
+struct Sim;
+
+// Stage blocks of the single-issue pipeline cycle timed by HP_STAGE
+enum HostStage {
+    HP_STAGE_WB = 0,
+    HP_STAGE_MEM,
+    HP_STAGE_EX,        /* including forwarding and misprediction flushes */
+    HP_STAGE_ID,
+    HP_STAGE_IF,
+    HP_STAGE_HAZARD,
+    HP_STAGE_LATCH,     /* pipeline register update and instruction count */
+    HP_STAGE_OBSERVE,   /* loop detector, counters and trace */
+    HP_STAGE_IDLE,      /* frozen and idle periods passed in one step */
+    HP_STAGES
+};
+
+// Helpers whose calls HP_COUNT counts
+enum HostCall {
+    HP_CALL_REG_READ = 0,
+    HP_CALL_MEM_READ_WORD,
+    HP_CALL_INSTR_READ,
+    HP_CALL_ALU_EXECUTE,
+    HP_CALLS
+};
+
+#if HOST_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define hp_now() ((uint64_t)__rdtsc())
+#else
+uint64_t hp_now(void);
+#endif
+
+// Process-wide profile; only one simulation may run while it is active
+typedef struct {
+    int active;
+    uint64_t mark;                      // timestamp of the end of the last stage block
+    uint64_t stage_ticks[HP_STAGES];
+    long stage_marks[HP_STAGES];        // timestamps taken, to subtract their own cost
+    long calls[HP_CALLS];
+} HostProfile_t;
+
+extern HostProfile_t host_profile;
+
+static inline void hp_stage(int stage) {
+    if (host_profile.active) {
+        uint64_t now = hp_now();
+        host_profile.stage_ticks[stage] += now - host_profile.mark;
+        host_profile.stage_marks[stage]++;
+        host_profile.mark = now;
+    }
+}
+
+#define HP_CYCLE_BEGIN() (host_profile.mark = host_profile.active ? hp_now() : 0)
+#define HP_STAGE(stage) hp_stage(stage)
+#define HP_COUNT(call) (host_profile.calls[call]++)
+
+#else
+
+#define HP_CYCLE_BEGIN() ((void)0)
+#define HP_STAGE(stage) ((void)0)
+#define HP_COUNT(call) ((void)0)
+
+#endif // HOST_PROFILE
+
+// Start profiling: reset the counts and open the hardware counters (Linux
+// perf events, where permitted). Returns -1 if profiling is not compiled in.
+int host_profile_start(void);
+
+// Stop the clocks and counters.
+void host_profile_stop(void);
+
+// Print the breakdown per simulated cycle of sim (per instruction for
+// functional runs).
+void host_profile_report(const struct Sim *sim, FILE *out);
+
+#endif // HOSTPROF_H
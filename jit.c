@@ -0,0 +1,569 @@
+/**
+ * jit.c - x86-64 translation cache: blocks of predecoded MIPS instructions compiled to host
+ * code that works on the register file and data memory, chained directly on direct exits.
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "config.h"
+#include "util.h"
+#include "alu.h"
+#include "memory.h"
+#include "decode.h"
+#include "functional.h"
+#include "sim.h"
+#include "jit.h"
+
+#if JIT_AVAILABLE
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define JIT_CODE_SIZE (16u << 20)   /* code buffer; flushed when full */
+#define JIT_MAX_BLOCK 256           /* instructions per block */
+#define JIT_MAX_INSTR_BYTES 96      /* worst-case host code for one instruction */
+#define JIT_HOT_VISITS 2            /* dispatcher visits before a PC is translated */
+
+// Generated code runs with rbx = register file, r12 = data memory,
+// r13 = remaining instruction budget, r14 = where to store the budget on exit.
+// Every exit returns the next MIPS PC in rax and, for a direct exit that may
+// be chained, the address of its jmp rel32 field in rdx (0 otherwise).
+typedef struct {
+    uint64_t pc;
+    uint8_t *patch;
+} JitExit_t;
+
+typedef JitExit_t (*JitEnter_t)(int32_t *regs, Memory_t *mem, long *remaining, const uint8_t *code);
+
+typedef struct {
+    uint8_t *code;      // host entry point, NULL if not translated
+    uint32_t count;     // instructions counted by one execution (nops excluded)
+    uint32_t visits;    // times reached by the dispatcher before translation
+    int no_code;        // first instruction cannot be translated: always interpreted
+} JitBlock_t;
+
+// The buffer is never writable and executable at once: it is mapped
+// read-write, and the emitted part is switched to read-execute before blocks
+// run and back to read-write before translating or chaining.
+struct Jit {
+    uint8_t *buffer;
+    size_t used;
+    size_t exec_end;        // bytes from buffer currently read-execute, 0 if writable
+    size_t page;
+    int failed;             // protection change failed; the interpreter takes over
+    uint8_t *epilogue;
+    JitEnter_t enter;
+    JitBlock_t *blocks;     // indexed by (PC - text_base) / 4
+    uint32_t count;         // instructions covered by blocks
+    uint32_t text_base;
+};
+
+// Byte emitters
+static void emit8(struct Jit *j, uint8_t b) {
+    j->buffer[j->used++] = b;
+}
+
+static void emit32(struct Jit *j, uint32_t v) {
+    memcpy(j->buffer + j->used, &v, 4);
+    j->used += 4;
+}
+
+static void emit64(struct Jit *j, uint64_t v) {
+    memcpy(j->buffer + j->used, &v, 8);
+    j->used += 8;
+}
+
+static void emit_bytes(struct Jit *j, const uint8_t *bytes, size_t n) {
+    memcpy(j->buffer + j->used, bytes, n);
+    j->used += n;
+}
+
+// Point the rel32 field at site to target
+static void patch_rel32(uint8_t *site, const uint8_t *target) {
+    int32_t rel = (int32_t)(target - (site + 4));
+    memcpy(site, &rel, 4);
+}
+
+// Emit a short conditional jump with a placeholder; returns the rel8 offset
+static size_t emit_jcc8(struct Jit *j, uint8_t cc) {
+    emit8(j, cc);
+    emit8(j, 0);
+    return j->used - 1;
+}
+
+static void bind8(struct Jit *j, size_t site) {
+    j->buffer[site] = (uint8_t)(j->used - (site + 1));
+}
+
+// mov r32, [rbx + 4*reg] (r32: 0 eax, 1 ecx, 2 edx, 6 esi)
+static void load_reg(struct Jit *j, int r32, int reg) {
+    emit8(j, 0x8B);
+    emit8(j, (uint8_t)(0x43 | (r32 << 3)));
+    emit8(j, (uint8_t)(4 * reg));
+}
+
+// mov [rbx + 4*reg], eax
+static void store_eax(struct Jit *j, int reg) {
+    emit8(j, 0x89);
+    emit8(j, 0x43);
+    emit8(j, (uint8_t)(4 * reg));
+}
+
+// mov eax, imm32; lea rdx, [rip + patch] or xor edx, edx; jmp epilogue
+static void emit_exit(struct Jit *j, uint32_t pc, uint8_t *patch) {
+    emit8(j, 0xB8);
+    emit32(j, pc);
+    if (patch) {
+        emit_bytes(j, (const uint8_t[]){ 0x48, 0x8D, 0x15 }, 3);
+        emit32(j, (uint32_t)(patch - (j->buffer + j->used + 4)));
+    } else {
+        emit_bytes(j, (const uint8_t[]){ 0x31, 0xD2 }, 2);
+    }
+    emit8(j, 0xE9);
+    emit32(j, 0);
+    patch_rel32(j->buffer + j->used - 4, j->epilogue);
+}
+
+// Chainable direct exit to pc: a jmp that initially falls through to its own stub
+static void emit_chain_exit(struct Jit *j, uint32_t pc) {
+    emit8(j, 0xE9);
+    emit32(j, 0);
+    uint8_t *site = j->buffer + j->used - 4;
+    emit_exit(j, pc, site);
+}
+
+// Compute the effective address a + imm of a load/store into eax and leave a
+// pointer to the host word in rdx+rax on the fast path. Returns the rel8 site
+// of the jump to the slow path (taken when the page is not the cached one or
+// the access is unaligned).
+static void emit_address(struct Jit *j, const DecodedInst_t *d, size_t *slow1, size_t *slow2) {
+    load_reg(j, 0, d->srcA);
+    emit8(j, 0x05);                                             // add eax, imm32
+    emit32(j, (uint32_t)d->imm);
+    emit_bytes(j, (const uint8_t[]){ 0x89, 0xC2 }, 2);          // mov edx, eax
+    emit_bytes(j, (const uint8_t[]){ 0xC1, 0xEA, PAGE_BITS }, 3); // shr edx, PAGE_BITS
+    emit_bytes(j, (const uint8_t[]){ 0x41, 0x3B, 0x94, 0x24 }, 4); // cmp edx, [r12 + last_page]
+    emit32(j, (uint32_t)offsetof(Memory_t, last_page));
+    *slow1 = emit_jcc8(j, 0x75);                                // jne slow
+    emit_bytes(j, (const uint8_t[]){ 0xA8, 0x03 }, 2);          // test al, 3
+    *slow2 = emit_jcc8(j, 0x75);                                // jnz slow
+    emit_bytes(j, (const uint8_t[]){ 0x49, 0x8B, 0x94, 0x24 }, 4); // mov rdx, [r12 + last_data]
+    emit32(j, (uint32_t)offsetof(Memory_t, last_data));
+    emit8(j, 0x25);                                             // and eax, PAGE_SIZE - 1
+    emit32(j, PAGE_SIZE - 1);
+}
+
+// mov rax, fn; call rax
+static void emit_call(struct Jit *j, const void *fn) {
+    emit_bytes(j, (const uint8_t[]){ 0x48, 0xB8 }, 2);
+    uint64_t addr;
+    memcpy(&addr, &fn, sizeof(addr));
+    emit64(j, addr);
+    emit_bytes(j, (const uint8_t[]){ 0xFF, 0xD0 }, 2);
+}
+
+// mov rdi, r12; mov esi, eax; call fn
+static void emit_mem_call(struct Jit *j, const void *fn) {
+    emit_bytes(j, (const uint8_t[]){ 0x4C, 0x89, 0xE7, 0x89, 0xC6 }, 5);
+    emit_call(j, fn);
+}
+
+// Offset of HI/LO from the register file pointer held in rbx
+#define HI_DISP ((uint32_t)(offsetof(ArchState_t, hi) - offsetof(ArchState_t, registers)))
+#define LO_DISP ((uint32_t)(offsetof(ArchState_t, lo) - offsetof(ArchState_t, registers)))
+
+// Byte or halfword load/store through the memory helpers (no inline fast path)
+static void emit_subword(struct Jit *j, const DecodedInst_t *d) {
+    if (d->kind == KIND_STORE) {
+        load_reg(j, 1, d->srcB);
+    }
+    load_reg(j, 0, d->srcA);
+    emit8(j, 0x05);                                             // add eax, imm32
+    emit32(j, (uint32_t)d->imm);
+    if (d->kind == KIND_STORE) {
+        emit_bytes(j, (const uint8_t[]){ 0x89, 0xCA }, 2);         // mov edx, ecx
+        emit_mem_call(j, d->memSize == 1 ? (const void *)memory_write8 : (const void *)memory_write16);
+        return;
+    }
+    emit_mem_call(j, d->memSize == 1 ? (const void *)memory_read8 : (const void *)memory_read16);
+    // movzx/movsx eax, al/ax
+    uint8_t ext = (uint8_t)((d->memSize == 1 ? 0xB6 : 0xB7) | (d->memSigned ? 0x08 : 0));
+    emit_bytes(j, (const uint8_t[]){ 0x0F, ext, 0xC0 }, 3);
+    store_eax(j, d->destReg);
+}
+
+// Translate one non-control instruction. Returns 0, or -1 if unsupported.
+static int emit_instr(struct Jit *j, const DecodedInst_t *d) {
+    size_t slow1, slow2, done;
+    switch (d->kind) {
+        case KIND_NOP:
+            return 0;
+        case KIND_ALU:
+            load_reg(j, 0, d->srcA);
+            if (!d->useImm) {
+                load_reg(j, 1, d->srcB);
+            }
+            switch (d->ALUop) {
+                case ALU_ADD: case ALU_SUB: case ALU_AND: case ALU_OR: case ALU_XOR: case ALU_NOR: {
+                    // Register forms use op r/m32, r32; immediates use op eax, imm32
+                    static const uint8_t reg_op[] = { [ALU_ADD] = 0x01, [ALU_SUB] = 0x29, [ALU_AND] = 0x21,
+                                                      [ALU_OR] = 0x09, [ALU_XOR] = 0x31, [ALU_NOR] = 0x09 };
+                    static const uint8_t imm_op[] = { [ALU_ADD] = 0x05, [ALU_SUB] = 0x2D, [ALU_AND] = 0x25,
+                                                      [ALU_OR] = 0x0D, [ALU_XOR] = 0x35, [ALU_NOR] = 0x0D };
+                    if (d->useImm) {
+                        emit8(j, imm_op[d->ALUop]);
+                        emit32(j, (uint32_t)d->imm);
+                    } else {
+                        emit8(j, reg_op[d->ALUop]);
+                        emit8(j, 0xC8);
+                    }
+                    if (d->ALUop == ALU_NOR) {
+                        emit_bytes(j, (const uint8_t[]){ 0xF7, 0xD0 }, 2);  // not eax
+                    }
+                    break;
+                }
+                case ALU_SLT:
+                    if (d->useImm) {
+                        emit8(j, 0x3D);                                     // cmp eax, imm32
+                        emit32(j, (uint32_t)d->imm);
+                    } else {
+                        emit_bytes(j, (const uint8_t[]){ 0x39, 0xC8 }, 2);  // cmp eax, ecx
+                    }
+                    emit_bytes(j, (const uint8_t[]){ 0x0F, 0x9C, 0xC0, 0x0F, 0xB6, 0xC0 }, 6); // setl; movzx
+                    break;
+                case ALU_SLL: case ALU_SRL: {
+                    uint8_t ext = (d->ALUop == ALU_SLL) ? 0xE0 : 0xE8;
+                    if (d->useImm) {
+                        emit_bytes(j, (const uint8_t[]){ 0xC1, ext, (uint8_t)(d->imm & 0x1F) }, 3);
+                    } else {
+                        emit_bytes(j, (const uint8_t[]){ 0xD3, ext }, 2);  // shift by cl (masked to 5 bits)
+                    }
+                    break;
+                }
+                default:
+                    return -1;
+            }
+            store_eax(j, d->destReg);
+            return 0;
+        case KIND_LOAD:
+            if (d->memSize != 4) {
+                emit_subword(j, d);
+                return 0;
+            }
+            emit_address(j, d, &slow1, &slow2);
+            emit_bytes(j, (const uint8_t[]){ 0x8B, 0x04, 0x02 }, 3);   // mov eax, [rdx + rax]
+            done = emit_jcc8(j, 0xEB);
+            bind8(j, slow1);
+            bind8(j, slow2);
+            emit_mem_call(j, (const void *)memory_read32);
+            bind8(j, done);
+            store_eax(j, d->destReg);
+            return 0;
+        case KIND_STORE:
+            if (d->memSize != 4) {
+                emit_subword(j, d);
+                return 0;
+            }
+            load_reg(j, 1, d->srcB);
+            emit_address(j, d, &slow1, &slow2);
+            emit_bytes(j, (const uint8_t[]){ 0x89, 0x0C, 0x02 }, 3);   // mov [rdx + rax], ecx
+            done = emit_jcc8(j, 0xEB);
+            bind8(j, slow1);
+            bind8(j, slow2);
+            emit_bytes(j, (const uint8_t[]){ 0x89, 0xCA }, 2);         // mov edx, ecx
+            emit_mem_call(j, (const void *)memory_write32);
+            bind8(j, done);
+            return 0;
+        case KIND_MULDIV:
+            if (d->muldiv == MD_DIV || d->muldiv == MD_DIVU) {
+                // Divides call alu_muldiv, which handles the zero and overflow cases:
+                // mov edi, op; mov esi, rs; mov edx, rt; lea rcx, [rbx + hi]; lea r8, [rbx + lo]
+                emit8(j, 0xBF);
+                emit32(j, (uint32_t)d->muldiv);
+                load_reg(j, 6, d->srcA);
+                load_reg(j, 2, d->srcB);
+                emit_bytes(j, (const uint8_t[]){ 0x48, 0x8D, 0x8B }, 3);
+                emit32(j, HI_DISP);
+                emit_bytes(j, (const uint8_t[]){ 0x4C, 0x8D, 0x83 }, 3);
+                emit32(j, LO_DISP);
+                emit_call(j, (const void *)alu_muldiv);
+                return 0;
+            }
+            load_reg(j, 0, d->srcA);
+            emit_bytes(j, (const uint8_t[]){ 0xF7, d->muldiv == MD_MULT ? 0x6B : 0x63,
+                                             (uint8_t)(4 * d->srcB) }, 3);   // imul/mul dword [rbx+rt]
+            emit_bytes(j, (const uint8_t[]){ 0x89, 0x93 }, 2);             // mov [rbx + hi], edx
+            emit32(j, HI_DISP);
+            emit_bytes(j, (const uint8_t[]){ 0x89, 0x83 }, 2);             // mov [rbx + lo], eax
+            emit32(j, LO_DISP);
+            return 0;
+        case KIND_MFHI:
+        case KIND_MFLO:
+            emit_bytes(j, (const uint8_t[]){ 0x8B, 0x83 }, 2);             // mov eax, [rbx + hi/lo]
+            emit32(j, d->kind == KIND_MFHI ? HI_DISP : LO_DISP);
+            store_eax(j, d->destReg);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+// Entry trampoline and shared epilogue at the start of the buffer
+static void emit_runtime(struct Jit *j) {
+    j->enter = (JitEnter_t)(void *)(j->buffer + j->used);
+    static const uint8_t enter[] = {
+        0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57,    // push rbx, rbp, r12-r15
+        0x48, 0x83, 0xEC, 0x08,                                          // sub rsp, 8 (align calls)
+        0x48, 0x89, 0xFB,                                                // mov rbx, rdi
+        0x49, 0x89, 0xF4,                                                // mov r12, rsi
+        0x49, 0x89, 0xD6,                                                // mov r14, rdx
+        0x4C, 0x8B, 0x2A,                                                // mov r13, [rdx]
+        0xFF, 0xE1                                                       // jmp rcx
+    };
+    emit_bytes(j, enter, sizeof(enter));
+    j->epilogue = j->buffer + j->used;
+    static const uint8_t leave[] = {
+        0x4D, 0x89, 0x2E,                                                // mov [r14], r13
+        0x48, 0x83, 0xC4, 0x08,                                          // add rsp, 8
+        0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B,      // pop r15-r12, rbp, rbx
+        0xC3
+    };
+    emit_bytes(j, leave, sizeof(leave));
+}
+
+// Forget every translation and start over with an empty buffer
+static void jit_flush(struct Jit *j) {
+    memset(j->blocks, 0, j->count * sizeof(JitBlock_t));
+    j->used = 0;
+    emit_runtime(j);
+}
+
+static struct Jit *jit_create(const ArchState_t *st) {
+    struct Jit *j = calloc(1, sizeof(struct Jit));
+    if (!j) {
+        return NULL;
+    }
+    j->buffer = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    j->count = (uint32_t)st->instr_count;
+    j->blocks = calloc(j->count ? j->count : 1, sizeof(JitBlock_t));
+    if (j->buffer == MAP_FAILED || !j->blocks) {
+        if (j->buffer != MAP_FAILED) {
+            munmap(j->buffer, JIT_CODE_SIZE);
+        }
+        free(j->blocks);
+        free(j);
+        return NULL;
+    }
+    j->text_base = st->text_base;
+    j->page = (size_t)sysconf(_SC_PAGESIZE);
+    jit_flush(j);
+    return j;
+}
+
+// Make the emitted code writable for translation or chaining. Returns -1 if
+// the protection cannot be changed.
+static int jit_writable(struct Jit *j) {
+    if (j->exec_end && mprotect(j->buffer, j->exec_end, PROT_READ | PROT_WRITE) < 0) {
+        return -1;
+    }
+    j->exec_end = 0;
+    return 0;
+}
+
+// Make the emitted code executable before entering it. Returns -1 if the
+// protection cannot be changed.
+static int jit_executable(struct Jit *j) {
+    size_t end = (j->used + j->page - 1) / j->page * j->page;
+    if (j->exec_end != end) {
+        if (mprotect(j->buffer, end, PROT_READ | PROT_EXEC) < 0) {
+            return -1;
+        }
+        j->exec_end = end;
+    }
+    return 0;
+}
+
+void jit_free(struct Jit *j) {
+    if (!j) {
+        return;
+    }
+    munmap(j->buffer, JIT_CODE_SIZE);
+    free(j->blocks);
+    free(j);
+}
+
+// Compile the block starting at instruction index. Returns NULL if its first
+// instruction cannot be translated (the caller interprets it, and the block is
+// marked so later visits do not try again). Sets *flushed if the buffer had to
+// be emptied first.
+static JitBlock_t *translate(struct Jit *j, const DecodedInst_t *prog, uint32_t index, int *flushed) {
+    if (j->used + (size_t)JIT_MAX_BLOCK * JIT_MAX_INSTR_BYTES > JIT_CODE_SIZE) {
+        jit_flush(j);
+        *flushed = 1;
+    }
+    uint32_t pc = j->text_base + index * 4;
+    size_t start = j->used;
+    // Budget check: leave before running a block that does not fit
+    emit_bytes(j, (const uint8_t[]){ 0x49, 0x81, 0xFD }, 3);    // cmp r13, imm32
+    size_t count_cmp = j->used;
+    emit32(j, 0);
+    emit_bytes(j, (const uint8_t[]){ 0x0F, 0x8C }, 2);          // jl bail
+    size_t bail = j->used;
+    emit32(j, 0);
+    emit_bytes(j, (const uint8_t[]){ 0x49, 0x81, 0xED }, 3);    // sub r13, imm32
+    size_t count_sub = j->used;
+    emit32(j, 0);
+    uint32_t counted = 0, n = 0;
+    int ended = 0;
+    while (!ended && n < JIT_MAX_BLOCK && index + n < j->count) {
+        const DecodedInst_t *d = &prog[index + n];
+        uint32_t at = pc + n * 4;
+        switch (d->kind) {
+            case KIND_BEQ:
+            case KIND_BNE: {
+                load_reg(j, 0, d->srcA);
+                emit_bytes(j, (const uint8_t[]){ 0x3B, 0x43, (uint8_t)(4 * d->srcB) }, 3); // cmp eax, [rbx+rt]
+                emit_bytes(j, (const uint8_t[]){ 0x0F, d->kind == KIND_BEQ ? 0x85 : 0x84 }, 2);
+                size_t not_taken = j->used;
+                emit32(j, 0);
+                emit_chain_exit(j, d->target);
+                patch_rel32(j->buffer + not_taken, j->buffer + j->used);
+                emit_chain_exit(j, at + 4);
+                ended = 1;
+                break;
+            }
+            case KIND_JAL:
+                emit_bytes(j, (const uint8_t[]){ 0xC7, 0x43, 4 * 31 }, 3);  // mov dword [rbx + $ra], imm32
+                emit32(j, at + 4);
+                emit_chain_exit(j, d->target);
+                ended = 1;
+                break;
+            case KIND_J:
+                emit_chain_exit(j, d->target);
+                ended = 1;
+                break;
+            case KIND_JR:
+                load_reg(j, 0, d->srcA);
+                emit_bytes(j, (const uint8_t[]){ 0x31, 0xD2, 0xE9 }, 3);  // xor edx, edx; jmp epilogue
+                emit32(j, 0);
+                patch_rel32(j->buffer + j->used - 4, j->epilogue);
+                ended = 1;
+                break;
+            default:
+                if (emit_instr(j, d) < 0) {
+                    if (n == 0) {
+                        j->used = start;
+                        j->blocks[index].no_code = 1;
+                        return NULL;
+                    }
+                    // Stop before it; the dispatcher interprets it
+                    emit_chain_exit(j, at);
+                    ended = 2;
+                }
+                break;
+        }
+        if (ended != 2) {
+            counted += (d->instr != 0);
+            n++;
+        }
+    }
+    if (!ended) {
+        emit_chain_exit(j, pc + n * 4);
+    }
+    patch_rel32(j->buffer + bail, j->buffer + j->used);
+    emit_exit(j, pc, NULL);
+    memcpy(j->buffer + count_cmp, &counted, 4);
+    memcpy(j->buffer + count_sub, &counted, 4);
+    JitBlock_t *b = &j->blocks[index];
+    b->code = j->buffer + start;
+    b->count = counted;
+    return b;
+}
+
+long jit_run(struct Sim *sim, long limit) {
+    ArchState_t *st = &sim->arch;
+    if (!sim->jit) {
+        sim->jit = jit_create(st);
+        if (!sim->jit) {
+            return -1;
+        }
+    }
+    struct Jit *j = sim->jit;
+    if (j->failed) {
+        return -1;
+    }
+    long remaining = limit;
+    uint32_t pc = st->pc;
+    uint8_t *patch = NULL;
+    long interpreted = 0;
+    while (((pc - j->text_base) >> 2) < j->count && remaining > 0) {
+        uint32_t index = (pc - j->text_base) >> 2;
+        JitBlock_t *b = &j->blocks[index];
+        if (!b->code && (b->no_code || ++b->visits < JIT_HOT_VISITS || remaining < JIT_MAX_BLOCK)) {
+            // Interpret code until it proves hot, and near the end of the
+            // budget, where a block may be entered only part way through;
+            // untranslatable instructions always
+            b = NULL;
+        } else if (!b->code) {
+            int flushed = 0;
+            if (jit_writable(j) < 0) {
+                j->failed = 1;
+                break;
+            }
+            b = translate(j, sim->decoded, index, &flushed);
+            if (flushed) {
+                patch = NULL;
+            }
+        }
+        if (b && patch) {
+            // Chain the exit we came from straight to this block
+            if (jit_writable(j) < 0) {
+                j->failed = 1;
+                break;
+            }
+            patch_rel32(patch, b->code);
+        }
+        patch = NULL;
+        if (!b || (long)b->count > remaining) {
+            // Untranslatable instruction or budget too small for the block
+            long before = sim->instructions;
+            st->pc = pc;
+            functional_step(sim);
+            pc = st->pc;
+            remaining -= sim->instructions - before;
+            interpreted += sim->instructions - before;
+            continue;
+        }
+        if (jit_executable(j) < 0) {
+            j->failed = 1;
+            break;
+        }
+        JitExit_t exit = j->enter(st->registers, &st->mem, &remaining, b->code);
+        pc = (uint32_t)exit.pc;
+        patch = exit.patch;
+    }
+    st->pc = pc;
+    long executed = limit - remaining;
+    sim->instructions += executed - interpreted;
+    if (j->failed) {
+        // The caller interprets the rest of the budget from here
+        fprintf(stderr, "Failed to change the protection of translated code; interpreting from 0x%08x\n", pc);
+        return -1;
+    }
+    return executed;
+}
+
+#else
+
+long jit_run(struct Sim *sim, long limit) {
+    (void)sim;
+    (void)limit;
+    return -1;
+}
+
+void jit_free(struct Jit *jit) {
+    (void)jit;
+}
+
+#endif
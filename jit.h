@@ -0,0 +1,27 @@
+/**
+ * jit.h - Basic-block translator from MIPS to x86-64 host code for the functional engine.
+ */
+#ifndef JIT_H
+#define JIT_H
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_AVAILABLE 1
+#else
+#define JIT_AVAILABLE 0
+#endif
+
+struct Sim;
+struct Jit;
+
+// Run like functional_run using translated blocks, translating on first
+// execution; instructions the translator does not handle are interpreted.
+// Returns the number of instructions executed (nops excluded), or -1 if no
+// translator is available for this host or its code could not be made
+// executable; instructions already run are then counted in sim->instructions
+// and the architectural state is left where they stopped.
+long jit_run(struct Sim *sim, long limit);
+
+// Drop all translations (the instruction memory was replaced) and release the cache.
+void jit_free(struct Jit *jit);
+
+#endif // JIT_H
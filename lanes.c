@@ -0,0 +1,976 @@
+/**
+ * lanes.c - Lockstep (SIMD-style) functional engine. The register files and
+ * PCs of all lanes are kept as one array per register with an element per
+ * lane, so an instruction is fetched and decoded once for the whole group of
+ * lanes at its PC and applied with a loop over lanes. On x86 hosts with AVX2
+ * the ALU, compare and blend loops use 8-lane vectors (chosen at run time);
+ * elsewhere they are plain C. Data memory stays private to each lane (its own
+ * context), so loads and stores are gathered lane by lane.
+ *
+ * Lanes that take different paths are regrouped by the smallest PC: only the
+ * lanes at that PC execute, the others wait until the group reaches them
+ * again, which for structured code is where the paths rejoin.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "alu.h"
+#include "decode.h"
+#include "syscall.h"
+#include "sim.h"
+#include "dump.h"
+#include "lanes.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define LANES_AVX2 1
+#else
+#define LANES_AVX2 0
+#endif
+
+// Direct page accesses are little-endian
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LANES_PAGE_CACHE 0
+#else
+#define LANES_PAGE_CACHE 1
+#endif
+
+#define LANE_BLOCK 8            /* lanes per vector; lane arrays are padded to a multiple */
+#define NO_PAGE 0xFFFFFFFFu     /* never a valid page number */
+
+static const char *const reg_names[NUM_REGS] = {
+    "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+// One instance and the text that describes it
+typedef struct {
+    char *line;
+    Sim_t *sim;         // memory, console and exit status of the lane
+    FILE *report;       // program output of the lane
+    char *report_buf;
+    size_t report_len;
+} Lane_t;
+
+// Lane state in structure-of-arrays form: element l of every array is lane l
+typedef struct LaneState {
+    int count;
+    int width;          // count rounded up to LANE_BLOCK, the extent of every lane loop
+    int running;        // lanes still in the program
+    const char *loops;  // "AVX2" or "scalar": the lane loops in use
+    int32_t *regs;      // NUM_REGS rows of width lanes
+    int32_t *hi, *lo;
+    uint32_t *pc;       // lanes outside the current group
+    int32_t *mask;      // 1 for the lanes of the current group
+    int32_t *operand;   // immediate broadcast to every lane
+    int32_t *done;      // left the program (state written back to the lane's context); 1 for padding
+    long *executed;     // instructions per lane, nops excluded
+    long group_executed;    // ... by the current group, not yet added to executed
+    uint32_t *load_page;    // per lane: page of the last load and its host data
+    uint8_t **load_data;
+    uint32_t *store_page;   // same for stores
+    uint8_t **store_data;
+    long steps;         // instructions issued to a group
+    long lane_steps;    // ... summed over the lanes of the group
+    long regroups;      // groups formed after the lanes went separate ways
+} LaneState_t;
+
+static int32_t *row(LaneState_t *s, int reg) {
+    return &s->regs[(size_t)reg * s->width];
+}
+
+// Host data of an access that stays within one page, through the lane's
+// one-entry cache (*page, *data). NULL where the access must go through
+// mem_read_sized/mem_write_sized: page-crossing, or an untouched page on a load.
+static inline uint8_t *lane_page(Memory_t *m, uint32_t *page, uint8_t **data, uint32_t address,
+                                 int size, int allocate) {
+#if LANES_PAGE_CACHE
+    uint32_t offset = address & (PAGE_SIZE - 1);
+    if (offset + (uint32_t)size > PAGE_SIZE) {
+        return NULL;
+    }
+    if (*page != address >> PAGE_BITS) {
+        uint8_t *p = memory_page(m, address, allocate);
+        if (!p) {
+            return NULL;
+        }
+        *page = address >> PAGE_BITS;
+        *data = p;
+    }
+    return *data + offset;
+#else
+    (void)m, (void)page, (void)data, (void)address, (void)size, (void)allocate;
+    return NULL;
+#endif
+}
+
+static int32_t lane_load(LaneState_t *s, Lane_t *lane, int l, uint32_t address, int size, int is_signed) {
+    const uint8_t *p = lane_page(&lane->sim->arch.mem, &s->load_page[l], &s->load_data[l], address, size, 0);
+    if (!p) {
+        return mem_read_sized(&lane->sim->arch, address, size, is_signed);
+    }
+    if (size == 1) {
+        return is_signed ? (int8_t)p[0] : p[0];
+    }
+    if (size == 2) {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return is_signed ? (int16_t)v : v;
+    }
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (int32_t)v;
+}
+
+static void lane_store(LaneState_t *s, Lane_t *lane, int l, uint32_t address, int size, int32_t value) {
+    uint8_t *p = lane_page(&lane->sim->arch.mem, &s->store_page[l], &s->store_data[l], address, size, 1);
+    if (!p) {
+        mem_write_sized(&lane->sim->arch, address, size, value);
+    } else if (size == 1) {
+        p[0] = (uint8_t)value;
+    } else if (size == 2) {
+        uint16_t v = (uint16_t)value;
+        memcpy(p, &v, sizeof(v));
+    } else {
+        memcpy(p, &value, sizeof(value));
+    }
+}
+
+// Lane-wise expression over l into dst, on the masked lanes only unless the
+// whole group runs (mask NULL). Blending keeps the loops branch-free.
+#define LANE_LOOP(expr) \
+    do { \
+        if (mask) { \
+            for (int l = 0; l < n; ++l) { \
+                int32_t v = (expr); \
+                dst[l] = mask[l] ? v : dst[l]; \
+            } \
+        } else { \
+            for (int l = 0; l < n; ++l) { \
+                dst[l] = (expr); \
+            } \
+        } \
+    } while (0)
+
+static void alu_lanes(int op, int32_t *dst, const int32_t *a, const int32_t *b,
+                      const int32_t *mask, int n) {
+    switch (op) {
+        case ALU_ADD:
+            LANE_LOOP((int32_t)((uint32_t)a[l] + (uint32_t)b[l]));
+            break;
+        case ALU_SUB:
+            LANE_LOOP((int32_t)((uint32_t)a[l] - (uint32_t)b[l]));
+            break;
+        case ALU_AND:
+            LANE_LOOP(a[l] & b[l]);
+            break;
+        case ALU_OR:
+            LANE_LOOP(a[l] | b[l]);
+            break;
+        case ALU_XOR:
+            LANE_LOOP(a[l] ^ b[l]);
+            break;
+        case ALU_NOR:
+            LANE_LOOP(~(a[l] | b[l]));
+            break;
+        case ALU_SLT:
+            LANE_LOOP(a[l] < b[l] ? 1 : 0);
+            break;
+        case ALU_SLL:
+            LANE_LOOP((int32_t)((uint32_t)a[l] << (b[l] & 0x1F)));
+            break;
+        case ALU_SRL:
+            LANE_LOOP((int32_t)((uint32_t)a[l] >> (b[l] & 0x1F)));
+            break;
+        default:
+            LANE_LOOP(a[l]);
+            break;
+    }
+}
+
+static void alu_imm_lanes(int op, int32_t *dst, const int32_t *a, int32_t imm, int32_t *scratch,
+                          const int32_t *mask, int n) {
+    for (int l = 0; l < n; ++l) {
+        scratch[l] = imm;
+    }
+    alu_lanes(op, dst, a, scratch, mask, n);
+}
+
+static int branch_lanes(int eq, const int32_t *a, const int32_t *b, const int32_t *mask, uint32_t *pc,
+                        uint32_t target, uint32_t next, int n) {
+    int taken = 0;
+    for (int l = 0; l < n; ++l) {
+        int t = mask[l] & ((a[l] == b[l]) == eq);
+        pc[l] = mask[l] ? (t ? target : next) : pc[l];
+        taken += t;
+    }
+    return taken;
+}
+
+static void set_pc_lanes(uint32_t *pc, uint32_t value, const int32_t *mask, int n) {
+    for (int l = 0; l < n; ++l) {
+        pc[l] = mask[l] ? value : pc[l];
+    }
+}
+
+static int select_lanes(int32_t *mask, const uint32_t *pc, const int32_t *done, uint32_t group_pc, int n) {
+    int active = 0;
+    for (int l = 0; l < n; ++l) {
+        mask[l] = !done[l] && pc[l] == group_pc;
+        active += mask[l];
+    }
+    return active;
+}
+
+static void load_words(LaneState_t *s, Lane_t *lanes, int32_t *dst, const int32_t *a, int32_t imm) {
+    for (int l = 0; l < s->count; ++l) {
+        if (s->mask[l]) {
+            dst[l] = lane_load(s, &lanes[l], l, (uint32_t)(a[l] + imm), 4, 0);
+        }
+    }
+}
+
+#if LANES_AVX2
+
+#define LOAD8(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE8(p, v) _mm256_storeu_si256((__m256i *)(p), (v))
+// 0/1 lane mask to an all-ones/zero vector
+#define MASK8(p) _mm256_sub_epi32(_mm256_setzero_si256(), LOAD8(p))
+
+// AVX2 form of LANE_LOOP: expr computes v from va and vb, where vb is
+// B_OPERAND (b[l..l+7] or the broadcast immediate)
+#define LANE_LOOP8(expr) \
+    do { \
+        for (int l = 0; l < n; l += LANE_BLOCK) { \
+            __m256i va = LOAD8(a + l); \
+            __m256i vb = B_OPERAND; \
+            __m256i v = (expr); \
+            (void)va; \
+            (void)vb; \
+            if (mask) { \
+                v = _mm256_blendv_epi8(LOAD8(dst + l), v, MASK8(mask + l)); \
+            } \
+            STORE8(dst + l, v); \
+        } \
+    } while (0)
+
+// ALU operations of LANE_LOOP8
+#define ALU_SWITCH8() \
+    do { \
+        const __m256i ones = _mm256_set1_epi32(-1); \
+        const __m256i shift = _mm256_set1_epi32(0x1F); \
+        switch (op) { \
+            case ALU_ADD: \
+                LANE_LOOP8(_mm256_add_epi32(va, vb)); \
+                break; \
+            case ALU_SUB: \
+                LANE_LOOP8(_mm256_sub_epi32(va, vb)); \
+                break; \
+            case ALU_AND: \
+                LANE_LOOP8(_mm256_and_si256(va, vb)); \
+                break; \
+            case ALU_OR: \
+                LANE_LOOP8(_mm256_or_si256(va, vb)); \
+                break; \
+            case ALU_XOR: \
+                LANE_LOOP8(_mm256_xor_si256(va, vb)); \
+                break; \
+            case ALU_NOR: \
+                LANE_LOOP8(_mm256_xor_si256(_mm256_or_si256(va, vb), ones)); \
+                break; \
+            case ALU_SLT: \
+                LANE_LOOP8(_mm256_srli_epi32(_mm256_cmpgt_epi32(vb, va), 31)); \
+                break; \
+            case ALU_SLL: \
+                LANE_LOOP8(_mm256_sllv_epi32(va, _mm256_and_si256(vb, shift))); \
+                break; \
+            case ALU_SRL: \
+                LANE_LOOP8(_mm256_srlv_epi32(va, _mm256_and_si256(vb, shift))); \
+                break; \
+            default: \
+                LANE_LOOP8(va); \
+                break; \
+        } \
+    } while (0)
+
+__attribute__((target("avx2")))
+static void alu_lanes_avx2(int op, int32_t *dst, const int32_t *a, const int32_t *b,
+                           const int32_t *mask, int n) {
+#define B_OPERAND LOAD8(b + l)
+    ALU_SWITCH8();
+#undef B_OPERAND
+}
+
+__attribute__((target("avx2")))
+static void alu_imm_lanes_avx2(int op, int32_t *dst, const int32_t *a, int32_t imm, int32_t *scratch,
+                               const int32_t *mask, int n) {
+    const __m256i vimm = _mm256_set1_epi32(imm);
+    (void)scratch;
+#define B_OPERAND vimm
+    ALU_SWITCH8();
+#undef B_OPERAND
+}
+
+__attribute__((target("avx2")))
+static int branch_lanes_avx2(int eq, const int32_t *a, const int32_t *b, const int32_t *mask, uint32_t *pc,
+                             uint32_t target, uint32_t next, int n) {
+    const __m256i flip = _mm256_set1_epi32(eq ? 0 : -1);
+    const __m256i vtarget = _mm256_set1_epi32((int32_t)target);
+    const __m256i vnext = _mm256_set1_epi32((int32_t)next);
+    int taken = 0;
+    for (int l = 0; l < n; l += LANE_BLOCK) {
+        __m256i m = MASK8(mask + l);
+        __m256i t = _mm256_and_si256(_mm256_xor_si256(_mm256_cmpeq_epi32(LOAD8(a + l), LOAD8(b + l)), flip), m);
+        __m256i v = _mm256_blendv_epi8(vnext, vtarget, t);
+        STORE8(pc + l, _mm256_blendv_epi8(LOAD8(pc + l), v, m));
+        taken += __builtin_popcount((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(t)));
+    }
+    return taken;
+}
+
+__attribute__((target("avx2")))
+static void set_pc_lanes_avx2(uint32_t *pc, uint32_t value, const int32_t *mask, int n) {
+    const __m256i v = _mm256_set1_epi32((int32_t)value);
+    for (int l = 0; l < n; l += LANE_BLOCK) {
+        STORE8(pc + l, _mm256_blendv_epi8(LOAD8(pc + l), v, MASK8(mask + l)));
+    }
+}
+
+__attribute__((target("avx2")))
+static int select_lanes_avx2(int32_t *mask, const uint32_t *pc, const int32_t *done, uint32_t group_pc, int n) {
+    const __m256i g = _mm256_set1_epi32((int32_t)group_pc);
+    const __m256i zero = _mm256_setzero_si256();
+    int active = 0;
+    for (int l = 0; l < n; l += LANE_BLOCK) {
+        __m256i m = _mm256_and_si256(_mm256_cmpeq_epi32(LOAD8(pc + l), g), _mm256_cmpeq_epi32(LOAD8(done + l), zero));
+        STORE8(mask + l, _mm256_srli_epi32(m, 31));
+        active += __builtin_popcount((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+    }
+    return active;
+}
+
+// Aligned words on pages already in the lanes' load caches are gathered 8
+// lanes at a time; a block with any other access goes lane by lane
+__attribute__((target("avx2")))
+static void load_words_avx2(LaneState_t *s, Lane_t *lanes, int32_t *dst, const int32_t *a, int32_t imm) {
+    const __m256i vimm = _mm256_set1_epi32(imm);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i offset_mask = _mm256_set1_epi32(PAGE_SIZE - 1);
+    const __m256i align_mask = _mm256_set1_epi32(3);
+    for (int l = 0; l < s->width; l += LANE_BLOCK) {
+        __m256i m = MASK8(s->mask + l);
+        if (_mm256_testz_si256(m, m)) {
+            continue;
+        }
+        __m256i address = _mm256_add_epi32(LOAD8(a + l), vimm);
+        __m256i hit = _mm256_and_si256(
+            _mm256_cmpeq_epi32(_mm256_srli_epi32(address, PAGE_BITS), LOAD8(s->load_page + l)),
+            _mm256_cmpeq_epi32(_mm256_and_si256(address, align_mask), zero));
+        if (!_mm256_testc_si256(hit, m)) {
+            for (int i = l; i < l + LANE_BLOCK && i < s->count; ++i) {
+                if (s->mask[i]) {
+                    dst[i] = lane_load(s, &lanes[i], i, (uint32_t)(a[i] + imm), 4, 0);
+                }
+            }
+            continue;
+        }
+        // Host addresses of the words, as 64-bit gather indices from 0
+        __m256i offset = _mm256_and_si256(address, offset_mask);
+        __m256i lo = _mm256_add_epi64(LOAD8(s->load_data + l),
+                                      _mm256_cvtepu32_epi64(_mm256_castsi256_si128(offset)));
+        __m256i hi = _mm256_add_epi64(LOAD8(s->load_data + l + 4),
+                                      _mm256_cvtepu32_epi64(_mm256_extracti128_si256(offset, 1)));
+        __m256i old = LOAD8(dst + l);
+        __m128i v0 = _mm256_mask_i64gather_epi32(_mm256_castsi256_si128(old), (const int *)0, lo,
+                                                 _mm256_castsi256_si128(m), 1);
+        __m128i v1 = _mm256_mask_i64gather_epi32(_mm256_extracti128_si256(old, 1), (const int *)0, hi,
+                                                 _mm256_extracti128_si256(m, 1), 1);
+        STORE8(dst + l, _mm256_inserti128_si256(_mm256_castsi128_si256(v0), v1, 1));
+    }
+}
+
+#else
+
+// Portable loops only
+#define alu_lanes_avx2 alu_lanes
+#define alu_imm_lanes_avx2 alu_imm_lanes
+#define branch_lanes_avx2 branch_lanes
+#define set_pc_lanes_avx2 set_pc_lanes
+#define select_lanes_avx2 select_lanes
+#define load_words_avx2 load_words
+
+#endif // LANES_AVX2
+
+// Zeroed lane array on a cache line boundary: with rows a multiple of
+// LANE_BLOCK lanes, no vector access then splits a line
+static void *lane_array(size_t lanes, size_t size) {
+    void *p = NULL;
+    if (posix_memalign(&p, 64, lanes * size) != 0) {
+        return NULL;
+    }
+    memset(p, 0, lanes * size);
+    return p;
+}
+
+static int lane_state_init(LaneState_t *s, Lane_t *lanes, int count) {
+    memset(s, 0, sizeof(*s));
+    s->count = count;
+    s->width = (count + LANE_BLOCK - 1) / LANE_BLOCK * LANE_BLOCK;
+    s->running = count;
+    size_t w = (size_t)s->width;
+    s->regs = lane_array(NUM_REGS * w, sizeof(int32_t));
+    s->hi = lane_array(w, sizeof(int32_t));
+    s->lo = lane_array(w, sizeof(int32_t));
+    s->pc = lane_array(w, sizeof(uint32_t));
+    s->mask = lane_array(w, sizeof(int32_t));
+    s->operand = lane_array(w, sizeof(int32_t));
+    s->done = lane_array(w, sizeof(int32_t));
+    s->executed = lane_array(w, sizeof(long));
+    s->load_page = lane_array(w, sizeof(uint32_t));
+    s->load_data = lane_array(w, sizeof(uint8_t *));
+    s->store_page = lane_array(w, sizeof(uint32_t));
+    s->store_data = lane_array(w, sizeof(uint8_t *));
+    if (!s->regs || !s->hi || !s->lo || !s->pc || !s->mask || !s->operand || !s->done || !s->executed ||
+        !s->load_page || !s->load_data || !s->store_page || !s->store_data) {
+        fprintf(stderr, "Failed to allocate lane state\n");
+        return -1;
+    }
+    for (int l = 0; l < s->width; ++l) {
+        s->load_page[l] = NO_PAGE;
+        s->store_page[l] = NO_PAGE;
+        // Padding lanes never run
+        s->done[l] = (l >= count);
+    }
+    for (int l = 0; l < count; ++l) {
+        const ArchState_t *st = &lanes[l].sim->arch;
+        for (int r = 1; r < NUM_REGS; ++r) {
+            row(s, r)[l] = st->registers[r];
+        }
+        s->hi[l] = st->hi;
+        s->lo[l] = st->lo;
+        s->pc[l] = st->pc;
+    }
+    return 0;
+}
+
+static void lane_state_free(LaneState_t *s) {
+    free(s->regs);
+    free(s->hi);
+    free(s->lo);
+    free(s->pc);
+    free(s->mask);
+    free(s->operand);
+    free(s->done);
+    free(s->executed);
+    free(s->load_page);
+    free(s->load_data);
+    free(s->store_page);
+    free(s->store_data);
+}
+
+// Add the instructions of the current group to its lanes
+static void flush_executed(LaneState_t *s) {
+    if (s->group_executed) {
+        for (int l = 0; l < s->count; ++l) {
+            s->executed[l] += s->mask[l] * s->group_executed;
+        }
+        s->group_executed = 0;
+    }
+}
+
+// Write lane l back to its context once it has left the program
+static void retire_lane(LaneState_t *s, Lane_t *lane, int l, uint32_t pc) {
+    ArchState_t *st = &lane->sim->arch;
+    for (int r = 0; r < NUM_REGS; ++r) {
+        st->registers[r] = row(s, r)[l];
+    }
+    st->hi = s->hi[l];
+    st->lo = s->lo[l];
+    st->pc = pc;
+    lane->sim->instructions = s->executed[l];
+    lane->sim->finished = 1;
+    console_flush(&lane->sim->console);
+    s->done[l] = 1;
+    s->mask[l] = 0;
+    s->running--;
+}
+
+// Form the next group: the running lanes at the smallest PC. Lanes whose PC
+// has left the program are retired first. Returns the lanes in the group (0
+// once every lane is done) and sets *group_pc.
+static ALWAYS_INLINE int regroup(LaneState_t *s, Lane_t *lanes, const ArchState_t *prog, uint32_t *group_pc,
+                                 const int avx2) {
+    flush_executed(s);
+    uint32_t size = (uint32_t)prog->instr_count * 4;
+    uint32_t min = UINT32_MAX;
+    for (int l = 0; l < s->count; ++l) {
+        if (s->done[l]) {
+            continue;
+        }
+        uint32_t offset = s->pc[l] - prog->text_base;
+        if (offset >= size) {
+            retire_lane(s, &lanes[l], l, s->pc[l]);
+        } else if (offset < min) {
+            min = offset;
+        }
+    }
+    if (min == UINT32_MAX) {
+        return 0;
+    }
+    *group_pc = prog->text_base + min;
+    return avx2 ? select_lanes_avx2(s->mask, s->pc, s->done, *group_pc, s->width)
+                : select_lanes(s->mask, s->pc, s->done, *group_pc, s->width);
+}
+
+#define ALU_LANES(op, dst, a, b, mask, n) \
+    (avx2 ? alu_lanes_avx2(op, dst, a, b, mask, n) : alu_lanes(op, dst, a, b, mask, n))
+
+// Run every lane to the end of the program, with the AVX2 loops if avx2 is
+// set. Instantiated once per form below, so the loops inline into it.
+static ALWAYS_INLINE void lanes_execute(LaneState_t *s, Lane_t *lanes, const int avx2) {
+    const ArchState_t *prog = &lanes[0].sim->arch;
+    const DecodedInst_t *decoded = lanes[0].sim->decoded;
+    uint32_t end = prog->text_base + (uint32_t)prog->instr_count * 4;
+    int n = s->width;
+    uint32_t pc = 0;
+    int active = regroup(s, lanes, prog, &pc, avx2);
+    while (active > 0) {
+        const DecodedInst_t *d = &decoded[(pc - prog->text_base) >> 2];
+        // With every running lane in the group, writes to the retired and
+        // padding lanes' columns are harmless and the loops need no mask
+        const int32_t *mask = (active == s->running) ? NULL : s->mask;
+        int32_t *a = row(s, d->srcA);
+        int32_t *b = row(s, d->srcB);
+        int32_t *dst = row(s, d->destReg);
+        uint32_t next = pc + 4;
+        int diverged = 0;
+        s->steps++;
+        s->lane_steps += active;
+        s->group_executed += (d->instr != 0);
+        switch (d->kind) {
+            case KIND_ALU:
+                if (d->destReg) {
+                    if (d->useImm) {
+                        if (avx2) {
+                            alu_imm_lanes_avx2(d->ALUop, dst, a, d->imm, s->operand, mask, n);
+                        } else {
+                            alu_imm_lanes(d->ALUop, dst, a, d->imm, s->operand, mask, n);
+                        }
+                    } else {
+                        ALU_LANES(d->ALUop, dst, a, b, mask, n);
+                    }
+                }
+                break;
+            case KIND_LOAD:
+                if (!d->destReg) {
+                    // Loads have no side effects
+                    break;
+                }
+                if (d->memSize == 4) {
+                    if (avx2) {
+                        load_words_avx2(s, lanes, dst, a, d->imm);
+                    } else {
+                        load_words(s, lanes, dst, a, d->imm);
+                    }
+                    break;
+                }
+                for (int l = 0; l < s->count; ++l) {
+                    if (s->mask[l]) {
+                        dst[l] = lane_load(s, &lanes[l], l, (uint32_t)(a[l] + d->imm), d->memSize, d->memSigned);
+                    }
+                }
+                break;
+            case KIND_STORE:
+            case KIND_SC:
+                // A lane is a single core, so SC always succeeds
+                for (int l = 0; l < s->count; ++l) {
+                    if (s->mask[l]) {
+                        lane_store(s, &lanes[l], l, (uint32_t)(a[l] + d->imm), d->memSize, b[l]);
+                    }
+                }
+                if (d->kind == KIND_SC && d->destReg) {
+                    for (int l = 0; l < n; ++l) {
+                        s->operand[l] = 1;
+                    }
+                    ALU_LANES(ALU_NOP, dst, s->operand, s->operand, mask, n);
+                }
+                break;
+            case KIND_MULDIV:
+                for (int l = 0; l < s->count; ++l) {
+                    if (s->mask[l]) {
+                        alu_muldiv(d->muldiv, a[l], b[l], &s->hi[l], &s->lo[l]);
+                    }
+                }
+                break;
+            case KIND_MFHI:
+            case KIND_MFLO:
+                if (d->destReg) {
+                    ALU_LANES(ALU_NOP, dst, d->kind == KIND_MFHI ? s->hi : s->lo, b, mask, n);
+                }
+                break;
+            case KIND_SYSCALL:
+                // Retiring lanes need their instruction counts
+                flush_executed(s);
+                for (int l = 0; l < s->count; ++l) {
+                    if (s->mask[l] && syscall_exec(lanes[l].sim, pc, a[l], b[l], &row(s, 2)[l])) {
+                        retire_lane(s, &lanes[l], l, end);
+                        --active;
+                    }
+                }
+                break;
+            case KIND_INVALID:
+                flush_executed(s);
+                for (int l = 0; l < s->count; ++l) {
+                    if (s->mask[l] && sim_invalid(lanes[l].sim, pc, d->instr)) {
+                        retire_lane(s, &lanes[l], l, end);
+                        --active;
+                    }
+                }
+                break;
+            case KIND_BEQ:
+            case KIND_BNE: {
+                int eq = (d->kind == KIND_BEQ);
+                int taken = avx2 ? branch_lanes_avx2(eq, a, b, s->mask, s->pc, d->target, next, n)
+                                 : branch_lanes(eq, a, b, s->mask, s->pc, d->target, next, n);
+                if (taken == active) {
+                    next = d->target;
+                } else if (taken) {
+                    diverged = 1;
+                }
+                break;
+            }
+            case KIND_J:
+            case KIND_JAL:
+                if (d->kind == KIND_JAL) {
+                    for (int l = 0; l < n; ++l) {
+                        s->operand[l] = (int32_t)next;
+                    }
+                    ALU_LANES(ALU_NOP, row(s, 31), s->operand, s->operand, mask, n);
+                }
+                next = d->target;
+                break;
+            case KIND_JR: {
+                int first = -1;
+                for (int l = 0; l < s->count; ++l) {
+                    if (s->mask[l]) {
+                        s->pc[l] = (uint32_t)a[l];
+                        first = (first < 0) ? l : first;
+                        diverged |= (s->pc[l] != s->pc[first]);
+                    }
+                }
+                next = s->pc[first];
+                break;
+            }
+            default:
+                break;
+        }
+        if (active == 0) {
+            // Every lane of the group exited
+            active = regroup(s, lanes, prog, &pc, avx2);
+            continue;
+        }
+        if (!diverged && active == s->running && next - prog->text_base < end - prog->text_base) {
+            // Still one group covering every running lane
+            pc = next;
+            continue;
+        }
+        if (!diverged) {
+            if (avx2) {
+                set_pc_lanes_avx2(s->pc, next, s->mask, n);
+            } else {
+                set_pc_lanes(s->pc, next, s->mask, n);
+            }
+        }
+        s->regroups += diverged;
+        active = regroup(s, lanes, prog, &pc, avx2);
+    }
+}
+
+static void lanes_execute_scalar(LaneState_t *s, Lane_t *lanes) {
+    s->loops = "scalar";
+    lanes_execute(s, lanes, 0);
+}
+
+#if LANES_AVX2
+__attribute__((target("avx2")))
+static void lanes_execute_avx2(LaneState_t *s, Lane_t *lanes) {
+    s->loops = "AVX2";
+    lanes_execute(s, lanes, 1);
+}
+#endif
+
+// Vector loops where the host has them, portable ones otherwise
+static void lanes_execute_best(LaneState_t *s, Lane_t *lanes) {
+#if LANES_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        lanes_execute_avx2(s, lanes);
+        return;
+    }
+#endif
+    lanes_execute_scalar(s, lanes);
+}
+
+// Parse a number with an optional 0x prefix and sign. Returns -1 if malformed.
+static int parse_value(const char *text, int32_t *value) {
+    char *end = NULL;
+    long long v = strtoll(text, &end, 0);
+    if (end == text || *end != '\0' || v < INT32_MIN || v > UINT32_MAX) {
+        return -1;
+    }
+    *value = (int32_t)(uint32_t)v;
+    return 0;
+}
+
+static int parse_reg(const char *name) {
+    if (strcmp(name, "hi") == 0) {
+        return NUM_REGS;
+    }
+    if (strcmp(name, "lo") == 0) {
+        return NUM_REGS + 1;
+    }
+    if (name[0] != '$') {
+        return -1;
+    }
+    ++name;
+    int32_t index;
+    if (parse_value(name, &index) == 0) {
+        return (index >= 0 && index < NUM_REGS) ? index : -1;
+    }
+    for (int r = 0; r < NUM_REGS; ++r) {
+        if (strcmp(name, reg_names[r]) == 0) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+// Apply the settings of a lane line to its freshly loaded context
+static int apply_settings(Lane_t *lane) {
+    char *args = strdup(lane->line);
+    if (!args) {
+        return -1;
+    }
+    ArchState_t *st = &lane->sim->arch;
+    int status = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(args, " \t\r\n", &save); tok && status == 0;
+         tok = strtok_r(NULL, " \t\r\n", &save)) {
+        char *eq = strchr(tok, '=');
+        char *at = strrchr(tok, '@');
+        int32_t value, address;
+        status = -1;
+        if (eq) {
+            *eq = '\0';
+            size_t len = strlen(tok);
+            if (parse_value(eq + 1, &value) < 0) {
+                // Reported below
+            } else if (tok[0] == '[' && len > 2 && tok[len - 1] == ']') {
+                tok[len - 1] = '\0';
+                if (parse_value(tok + 1, &address) == 0) {
+                    mem_write_word(st, (uint32_t)address, value);
+                    status = 0;
+                }
+            } else {
+                int reg = parse_reg(tok);
+                if (reg == NUM_REGS) {
+                    st->hi = value;
+                } else if (reg == NUM_REGS + 1) {
+                    st->lo = value;
+                } else if (reg > 0) {
+                    st->registers[reg] = value;
+                }
+                status = (reg > 0) ? 0 : -1;
+            }
+        } else if (at) {
+            *at = '\0';
+            if (parse_value(at + 1, &address) == 0) {
+                // load_data_image reports its own failures
+                status = load_data_image(st, tok, (uint32_t)address) < 0 ? -2 : 0;
+            }
+        }
+        if (status == -1) {
+            fprintf(stderr, "Invalid lane setting in: %s\n", lane->line);
+        }
+    }
+    free(args);
+    return status < 0 ? -1 : 0;
+}
+
+// Read the lane lines. Returns number of lanes, -1 on error.
+static int read_lanes(const char *filename, Lane_t **lanes_out) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open lane file: %s\n", filename);
+        return -1;
+    }
+    Lane_t *lanes = NULL;
+    int count = 0, capacity = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    int failed = 0;
+    while (getline(&line, &line_cap, file) != -1) {
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        if (strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            Lane_t *grown = realloc(lanes, capacity * sizeof(Lane_t));
+            if (!grown) {
+                failed = 1;
+                break;
+            }
+            lanes = grown;
+        }
+        Lane_t *lane = &lanes[count++];
+        memset(lane, 0, sizeof(*lane));
+        line[strcspn(line, "\r\n")] = '\0';
+        lane->line = strdup(line);
+        if (!lane->line) {
+            failed = 1;
+            break;
+        }
+    }
+    free(line);
+    fclose(file);
+    if (failed || count == 0) {
+        fprintf(stderr, failed ? "Failed to read lane file: %s\n" : "No lanes in %s\n", filename);
+        for (int i = 0; i < count; ++i) {
+            free(lanes[i].line);
+        }
+        free(lanes);
+        return -1;
+    }
+    *lanes_out = lanes;
+    return count;
+}
+
+static void report(const LaneState_t *s, Lane_t *lanes, FILE *out) {
+    for (int l = 0; l < s->count; ++l) {
+        Lane_t *lane = &lanes[l];
+        const Sim_t *sim = lane->sim;
+        fprintf(out, "=== lane %d: %s ===\n", l + 1, lane->line);
+        if (lane->report_buf) {
+            fwrite(lane->report_buf, 1, lane->report_len, out);
+        }
+        fprintf(out, "Lane %d: %ld instructions", l + 1, sim->instructions);
+        if (sim->exited) {
+            fprintf(out, ", exited with code %d", sim->exit_code);
+        } else if (sim->invalid) {
+            fprintf(out, ", stopped at an invalid instruction");
+        }
+        fprintf(out, "; $v0 = %d, $v1 = %d\n", sim->arch.registers[2], sim->arch.registers[3]);
+    }
+    long instructions = 0;
+    for (int l = 0; l < s->count; ++l) {
+        instructions += lanes[l].sim->instructions;
+    }
+    fprintf(out, "Lockstep run of %d lanes (%s loops): %ld instructions in %ld group steps "
+            "(%.2f lanes per step, %.1f%% of the lanes), %ld regroups after divergence\n",
+            s->count, s->loops, instructions, s->steps,
+            s->steps ? (double)s->lane_steps / (double)s->steps : 0.0,
+            s->steps ? 100.0 * (double)s->lane_steps / ((double)s->steps * s->count) : 0.0,
+            s->regroups);
+}
+
+// Load and run count lanes of program, then print the report and the state
+// dumps to out (none if NULL). Takes ownership of lanes. Returns the
+// instructions executed over all lanes, -1 on error, a verification mismatch or
+// a lane stopped at an invalid instruction.
+static long run_lanes(const SimConfig_t *cfg, const char *program, Lane_t *lanes, int count, FILE *out) {
+    SimConfig_t lane_cfg = *cfg;
+    lane_cfg.functional = 1;
+    long instructions = -1;
+    int status = 0;
+    int invalid = 0;
+    for (int l = 0; l < count && status == 0; ++l) {
+        Lane_t *lane = &lanes[l];
+        lane->report = open_memstream(&lane->report_buf, &lane->report_len);
+        lane->sim = lane->report ? sim_create(&lane_cfg) : NULL;
+        if (!lane->sim || sim_load(lane->sim, program) < 0 || apply_settings(lane) < 0) {
+            status = -1;
+            break;
+        }
+        lane->sim->console.out = lane->report;
+    }
+    LaneState_t state;
+    memset(&state, 0, sizeof(state));
+    if (status == 0 && lane_state_init(&state, lanes, count) == 0) {
+        lanes_execute_best(&state, lanes);
+        instructions = 0;
+        for (int l = 0; l < count; ++l) {
+            fflush(lanes[l].report);
+            instructions += lanes[l].sim->instructions;
+            invalid |= lanes[l].sim->invalid;
+        }
+        if (out) {
+            report(&state, lanes, out);
+            Sim_t **sims = malloc(count * sizeof(Sim_t *));
+            for (int l = 0; sims && l < count; ++l) {
+                sims[l] = lanes[l].sim;
+            }
+            if (!sims || dump_final_states(sims, count, "lane", 1, out) < 0) {
+                instructions = -1;
+            }
+            free(sims);
+        }
+        if (invalid) {
+            instructions = -1;
+        }
+    }
+    lane_state_free(&state);
+    for (int l = 0; l < count; ++l) {
+        sim_destroy(lanes[l].sim);
+        if (lanes[l].report) {
+            fclose(lanes[l].report);
+        }
+        free(lanes[l].report_buf);
+        free(lanes[l].line);
+    }
+    free(lanes);
+    return instructions;
+}
+
+int lanes_run(const SimConfig_t *cfg, const char *program, const char *lanes_file, FILE *out) {
+    if (cfg->dual_issue || cfg->ooo || cfg->cores > 1 || cfg->trace_file || cfg->stats ||
+        cfg->stats_json || cfg->stats_csv || cfg->checkpoint_file || cfg->restore_file ||
+        cfg->record_file || cfg->sample_size) {
+        fprintf(stderr, "--lanes runs the functional semantics only (no --dual-issue, --ooo, --cores, "
+                "--trace, --stats options, --checkpoint, --restore, --record or --sample)\n");
+        return -1;
+    }
+    Lane_t *lanes = NULL;
+    int count = read_lanes(lanes_file, &lanes);
+    if (count < 0) {
+        return -1;
+    }
+    return run_lanes(cfg, program, lanes, count, out) < 0 ? -1 : 0;
+}
+
+long lanes_run_copies(const SimConfig_t *cfg, const char *program, int count) {
+    Lane_t *lanes = calloc(count, sizeof(Lane_t));
+    if (!lanes) {
+        fprintf(stderr, "Failed to allocate lanes\n");
+        return -1;
+    }
+    for (int l = 0; l < count; ++l) {
+        lanes[l].line = strdup("");
+        if (!lanes[l].line) {
+            for (int i = 0; i < l; ++i) {
+                free(lanes[i].line);
+            }
+            free(lanes);
+            fprintf(stderr, "Failed to allocate lanes\n");
+            return -1;
+        }
+    }
+    return run_lanes(cfg, program, lanes, count, NULL);
+}
@@ -0,0 +1,26 @@
+/**
+ * lanes.h - Lockstep engine running many instances (lanes) of one program
+ * that differ only in their initial registers and memory.
+ */
+#ifndef LANES_H
+#define LANES_H
+
+#include <stdio.h>
+#include "sim.h"
+
+// Run program once per lane listed in lanes_file, all lanes together with the
+// functional semantics, and print each lane's program output and results to
+// out in lane order. Each non-empty line of lanes_file describes one lane
+// ('#' starts a comment) as settings applied after loading:
+//   <reg>=<value>       register ($4, $a0, hi or lo)
+//   [<address>]=<value> data memory word
+//   <file>@<address>    raw data image (as --data)
+// Only the loading options of cfg apply. Returns 0 on success, -1 on error or
+// if a lane stopped at an invalid instruction.
+int lanes_run(const SimConfig_t *cfg, const char *program, const char *lanes_file, FILE *out);
+
+// Run count identical lanes of program without output, for throughput
+// measurements. Returns the instructions executed over all lanes, -1 on error.
+long lanes_run_copies(const SimConfig_t *cfg, const char *program, int count);
+
+#endif // LANES_H
@@ -0,0 +1,226 @@
+/**
+ * memory.c - Paged data memory with on-demand page allocation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+
+#define PAGE_OFFSET_MASK (PAGE_SIZE - 1)
+#define L1_INDEX(page) ((page) >> PAGE_TABLE_BITS)
+#define L2_INDEX(page) ((page) & (PAGE_TABLE_ENTRIES - 1))
+#define NO_PAGE 0xFFFFFFFFu   /* never a valid page number */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_BIG_ENDIAN 1
+#else
+#define HOST_BIG_ENDIAN 0
+#endif
+
+void memory_init(Memory_t *m) {
+    memset(m, 0, sizeof(*m));
+    m->last_page = NO_PAGE;
+}
+
+void memory_free(Memory_t *m) {
+    if (m->owner) {
+        memory_init(m);
+        return;
+    }
+    for (uint32_t i = 0; i < PAGE_TABLE_ENTRIES; ++i) {
+        if (!m->tables[i]) {
+            continue;
+        }
+        for (uint32_t j = 0; j < PAGE_TABLE_ENTRIES; ++j) {
+            uint8_t *data = m->tables[i][j];
+            // Mapped-in pages belong to the adopted buffer
+            if (m->backing && data >= (uint8_t *)m->backing &&
+                data < (uint8_t *)m->backing + m->backing_len) {
+                continue;
+            }
+            free(data);
+        }
+        free(m->tables[i]);
+    }
+    if (m->backing) {
+        m->release(m->backing, m->backing_len);
+    }
+    memory_init(m);
+}
+
+// Second-level table for page, allocated on demand
+static uint8_t **table_for(Memory_t *m, uint32_t page) {
+    uint8_t **table = m->tables[L1_INDEX(page)];
+    if (!table) {
+        table = calloc(PAGE_TABLE_ENTRIES, sizeof(uint8_t *));
+        if (!table) {
+            fprintf(stderr, "Out of memory allocating page table\n");
+            exit(1);
+        }
+        m->tables[L1_INDEX(page)] = table;
+    }
+    return table;
+}
+
+// Page in the tables of m, allocated if allocate is set; NULL for an
+// untouched page when not allocating
+static uint8_t *table_lookup(Memory_t *m, uint32_t page, int allocate) {
+    uint8_t **table = m->tables[L1_INDEX(page)];
+    uint8_t *data = table ? table[L2_INDEX(page)] : NULL;
+    if (!data) {
+        if (!allocate) {
+            return NULL;
+        }
+        table = table_for(m, page);
+        data = calloc(1, PAGE_SIZE);
+        if (!data) {
+            fprintf(stderr, "Out of memory allocating page 0x%08x\n", page << PAGE_BITS);
+            exit(1);
+        }
+        table[L2_INDEX(page)] = data;
+        m->resident_pages++;
+    }
+    return data;
+}
+
+// Translate address to its page; allocates the page if allocate is set.
+// Returns NULL for an untouched page when not allocating.
+static uint8_t *page_lookup(Memory_t *m, uint32_t address, int allocate) {
+    uint32_t page = address >> PAGE_BITS;
+    if (page == m->last_page) {
+        return m->last_data;
+    }
+    uint8_t *data;
+    if (m->lock) {
+        // Shared tables: another thread may be adding a page right now
+        pthread_mutex_lock(m->lock);
+        data = table_lookup(m->owner ? m->owner : m, page, allocate);
+        pthread_mutex_unlock(m->lock);
+    } else {
+        data = table_lookup(m, page, allocate);
+    }
+    if (!data) {
+        return NULL;
+    }
+    m->last_page = page;
+    m->last_data = data;
+    return data;
+}
+
+uint8_t memory_read8(Memory_t *m, uint32_t address) {
+    uint8_t *data = page_lookup(m, address, 0);
+    return data ? data[address & PAGE_OFFSET_MASK] : 0;
+}
+
+void memory_write8(Memory_t *m, uint32_t address, uint8_t value) {
+    page_lookup(m, address, 1)[address & PAGE_OFFSET_MASK] = value;
+}
+
+uint16_t memory_read16(Memory_t *m, uint32_t address) {
+    if ((address & 1) || HOST_BIG_ENDIAN) {
+        // Unaligned (possibly page-crossing) or byte-swapping host: go byte by byte
+        return (uint16_t)(memory_read8(m, address) | (memory_read8(m, address + 1) << 8));
+    }
+    uint8_t *data = page_lookup(m, address, 0);
+    uint16_t value = 0;
+    if (data) {
+        memcpy(&value, data + (address & PAGE_OFFSET_MASK), sizeof(value));
+    }
+    return value;
+}
+
+void memory_write16(Memory_t *m, uint32_t address, uint16_t value) {
+    if ((address & 1) || HOST_BIG_ENDIAN) {
+        memory_write8(m, address, (uint8_t)value);
+        memory_write8(m, address + 1, (uint8_t)(value >> 8));
+        return;
+    }
+    memcpy(page_lookup(m, address, 1) + (address & PAGE_OFFSET_MASK), &value, sizeof(value));
+}
+
+uint32_t memory_read32(Memory_t *m, uint32_t address) {
+    if ((address & 3) || HOST_BIG_ENDIAN) {
+        return (uint32_t)memory_read16(m, address) | ((uint32_t)memory_read16(m, address + 2) << 16);
+    }
+    uint8_t *data = page_lookup(m, address, 0);
+    uint32_t value = 0;
+    if (data) {
+        memcpy(&value, data + (address & PAGE_OFFSET_MASK), sizeof(value));
+    }
+    return value;
+}
+
+void memory_write32(Memory_t *m, uint32_t address, uint32_t value) {
+    if ((address & 3) || HOST_BIG_ENDIAN) {
+        memory_write16(m, address, (uint16_t)value);
+        memory_write16(m, address + 2, (uint16_t)(value >> 16));
+        return;
+    }
+    memcpy(page_lookup(m, address, 1) + (address & PAGE_OFFSET_MASK), &value, sizeof(value));
+}
+
+uint8_t *memory_page(Memory_t *m, uint32_t address, int allocate) {
+    return page_lookup(m, address, allocate);
+}
+
+void memory_write_block(Memory_t *m, uint32_t address, const uint8_t *bytes, size_t len) {
+    while (len > 0) {
+        size_t offset = address & PAGE_OFFSET_MASK;
+        size_t chunk = PAGE_SIZE - offset;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(page_lookup(m, address, 1) + offset, bytes, chunk);
+        address += (uint32_t)chunk;
+        bytes += chunk;
+        len -= chunk;
+    }
+}
+
+void memory_for_each_page(const Memory_t *m, void (*fn)(void *ctx, uint32_t address, const uint8_t *data),
+                          void *ctx) {
+    for (uint32_t i = 0; i < PAGE_TABLE_ENTRIES; ++i) {
+        if (!m->tables[i]) {
+            continue;
+        }
+        for (uint32_t j = 0; j < PAGE_TABLE_ENTRIES; ++j) {
+            if (m->tables[i][j]) {
+                fn(ctx, ((i << PAGE_TABLE_BITS) | j) << PAGE_BITS, m->tables[i][j]);
+            }
+        }
+    }
+}
+
+void memory_map_page(Memory_t *m, uint32_t address, uint8_t *data) {
+    uint32_t page = address >> PAGE_BITS;
+    uint8_t **table = table_for(m, page);
+    if (!table[L2_INDEX(page)]) {
+        m->resident_pages++;
+    }
+    table[L2_INDEX(page)] = data;
+    m->last_page = NO_PAGE;
+    m->last_data = NULL;
+}
+
+void memory_adopt(Memory_t *m, void *base, size_t len, void (*release)(void *base, size_t len)) {
+    m->backing = base;
+    m->backing_len = len;
+    m->release = release;
+}
+
+void memory_share(Memory_t *m, Memory_t *owner, pthread_mutex_t *lock) {
+    memory_free(m);
+    m->owner = owner;
+    m->lock = lock;
+    owner->lock = lock;
+}
+
+size_t memory_resident_bytes(const Memory_t *m) {
+    size_t bytes = (size_t)m->resident_pages * PAGE_SIZE;
+    for (uint32_t i = 0; i < PAGE_TABLE_ENTRIES; ++i) {
+        if (m->tables[i]) {
+            bytes += PAGE_TABLE_ENTRIES * sizeof(uint8_t *);
+        }
+    }
+    return bytes;
+}
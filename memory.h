@@ -0,0 +1,70 @@
+/**
+ * memory.h - Sparse paged data memory covering the 32-bit address space.
+ */
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "config.h"
+
+#define PAGE_SIZE (1u << PAGE_BITS)
+#define PAGE_TABLE_ENTRIES (1u << PAGE_TABLE_BITS)
+
+// Two-level page table: the top PAGE_TABLE_BITS of an address select a
+// second-level table, the next PAGE_TABLE_BITS a page. Pages are allocated
+// on the first write; reads of untouched memory return zero.
+typedef struct Memory {
+    uint8_t **tables[PAGE_TABLE_ENTRIES];
+    uint32_t last_page;     // page number of the cached translation
+    uint8_t *last_data;     // its page, or NULL if nothing is cached
+    long resident_pages;
+    void *backing;          // adopted buffer holding mapped-in pages, NULL if none
+    size_t backing_len;
+    void (*release)(void *base, size_t len);   // frees backing
+    struct Memory *owner;   // memory whose pages this one shares, NULL if it owns its tables
+    pthread_mutex_t *lock;  // serializes page table updates between sharers, NULL if unshared
+} Memory_t;
+
+// Start with an empty address space / release every page.
+void memory_init(Memory_t *m);
+void memory_free(Memory_t *m);
+
+// Little-endian accesses; aligned words and halfwords are single host accesses.
+uint32_t memory_read32(Memory_t *m, uint32_t address);
+uint16_t memory_read16(Memory_t *m, uint32_t address);
+uint8_t memory_read8(Memory_t *m, uint32_t address);
+void memory_write32(Memory_t *m, uint32_t address, uint32_t value);
+void memory_write16(Memory_t *m, uint32_t address, uint16_t value);
+void memory_write8(Memory_t *m, uint32_t address, uint8_t value);
+
+// Host page holding address, allocated if allocate is set; NULL for an
+// untouched page when not allocating. Pages stay in place until memory_free,
+// so callers may keep the pointer for direct little-endian accesses.
+uint8_t *memory_page(Memory_t *m, uint32_t address, int allocate);
+
+// Copy len bytes into memory starting at address.
+void memory_write_block(Memory_t *m, uint32_t address, const uint8_t *bytes, size_t len);
+
+// Call fn for every resident page, in address order.
+void memory_for_each_page(const Memory_t *m, void (*fn)(void *ctx, uint32_t address, const uint8_t *data),
+                          void *ctx);
+
+// Use the PAGE_SIZE bytes at data as the page containing address, without
+// copying. data must lie in a writable buffer adopted with memory_adopt.
+void memory_map_page(Memory_t *m, uint32_t address, uint8_t *data);
+
+// Take ownership of the buffer behind mapped pages; memory_free releases it
+// with release(base, len) instead of freeing its pages one by one.
+void memory_adopt(Memory_t *m, void *base, size_t len, void (*release)(void *base, size_t len));
+
+// Make m an empty view of owner's pages, for cores on different threads
+// sharing one memory. Page allocation in either is serialized by lock; owner
+// must outlive m, and memory_free(m) only detaches it.
+void memory_share(Memory_t *m, Memory_t *owner, pthread_mutex_t *lock);
+
+// Bytes of host memory backing touched pages.
+size_t memory_resident_bytes(const Memory_t *m);
+
+#endif // MEMORY_H
@@ -0,0 +1,433 @@
+/**
+ * multicore.c - Multicore system simulation. Every core is a complete pipeline
+ * context (sim.h) whose data memory is a view of core 0's pages and whose data
+ * cache is its coherent L1. Cores run on their own host threads and only meet
+ * at quantum boundaries, so simulated time may drift apart by up to a quantum
+ * between cores; coherence transactions are serialized by a bus lock in host
+ * order, while hits in a private state (or reads of shared lines) proceed
+ * without it. Every access moves its data inside the step that checks the line
+ * state: under the bus lock for a transaction, with the line marked busy for
+ * a hit, so what ends up in memory follows the order of the coherence events.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "config.h"
+#include "util.h"
+#include "decode.h"
+#include "cache.h"
+#include "pipeline.h"
+#include "sim.h"
+#include "dump.h"
+#include "multicore.h"
+
+typedef struct McSystem {
+    int num_cores;
+    long quantum;
+    McCore_t *cores;
+    pthread_mutex_t bus;    // one coherence transaction (and LL/SC) at a time
+    pthread_mutex_t pages;  // page allocation in the shared memory
+    pthread_mutex_t sync;   // quantum barrier and start gate
+    pthread_cond_t next;
+    long generation;        // completed quanta
+    int arrived;            // cores at the barrier of the current quantum
+    int unfinished;         // ... of which still running a program
+    int stop;               // every program has finished
+    int started;            // all core threads exist (or abort is set)
+    int abort;
+} McSystem_t;
+
+#define LINE_BUSY 0x80      /* state flag: the owner is accessing the line without the bus */
+
+// Line states change under the bus lock but are read by their own core
+// without it, so they are accessed atomically
+static int load_state(CacheLine_t *line) {
+    return __atomic_load_n(&line->state, __ATOMIC_ACQUIRE);
+}
+
+static void set_state(CacheLine_t *line, int state) {
+    __atomic_store_n(&line->state, (uint8_t)state, __ATOMIC_RELEASE);
+    line->valid = (state != MESI_I);
+}
+
+// Valid line of c holding block (address >> line bits), NULL if none
+static CacheLine_t *l1_find(Cache_t *c, uint32_t block) {
+    CacheLine_t *ways = &c->lines[(size_t)(block & (c->sets - 1)) * c->config.assoc];
+    uint32_t tag = block >> c->set_bits;
+    for (uint32_t w = 0; w < c->config.assoc; ++w) {
+        if (ways[w].tag == tag && load_state(&ways[w]) != MESI_I) {
+            return &ways[w];
+        }
+    }
+    return NULL;
+}
+
+// Snoop the other caches for block on behalf of core: a write takes their
+// copies away (and with them any LL link on the line), a read leaves them
+// shared. Returns 1 if another cache held the line and supplies it.
+static int snoop(McCore_t *core, uint32_t block, int is_write) {
+    McSystem_t *sys = core->sys;
+    int held = 0;
+    for (int i = 0; i < sys->num_cores; ++i) {
+        McCore_t *other = &sys->cores[i];
+        CacheLine_t *line = (other == core) ? NULL : l1_find(&other->sim->dcache, block);
+        if (!line) {
+            continue;
+        }
+        held = 1;
+        // Wait for a hit the owner is making without the bus to land, then take
+        // the line; the compare-exchange also sees a silent E -> M upgrade
+        uint8_t old = (uint8_t)load_state(line);
+        while ((old & LINE_BUSY) ||
+               !__atomic_compare_exchange_n(&line->state, &old, (uint8_t)(is_write ? MESI_I : MESI_S), 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if (old & LINE_BUSY) {
+                old = (uint8_t)load_state(line);
+            }
+        }
+        line->valid = !is_write;
+        if (old == MESI_M) {
+            other->stats.flushes++;
+        }
+        if (is_write) {
+            other->stats.invalidations++;
+            if (other->linked && other->link_block == block) {
+                other->linked = 0;
+            }
+        }
+    }
+    return held;
+}
+
+// Access by core that needs the bus lock (held by the caller): a miss, a
+// write to a line not held exclusively, or any access whose state changed
+// since the unlocked check. Returns the stall cycles.
+static int bus_transaction(McCore_t *core, uint32_t address, int is_write) {
+    Cache_t *c = &core->sim->dcache;
+    uint32_t block = address >> c->line_bits;
+    CacheLine_t *line = l1_find(c, block);
+    c->clock++;
+    if (line) {
+        c->hits++;
+        line->last_use = c->clock;
+        int state = load_state(line);
+        if (!is_write || state == MESI_M) {
+            return 0;
+        }
+        if (state == MESI_S) {
+            snoop(core, block, 1);
+            core->stats.bus_upgrades++;
+        }
+        set_state(line, MESI_M);
+        return (state == MESI_S) ? BUS_TRANSFER_LATENCY : 0;
+    }
+    c->misses++;
+    int held = snoop(core, block, is_write);
+    int penalty = held ? BUS_TRANSFER_LATENCY : c->config.miss_latency;
+    CacheLine_t *victim = cache_victim(c, address);
+    if (victim->valid) {
+        uint32_t victim_block = (victim->tag << c->set_bits) | (block & (c->sets - 1));
+        if (load_state(victim) == MESI_M) {
+            c->writebacks++;
+            penalty += c->config.miss_latency;
+        }
+        if (core->linked && core->link_block == victim_block) {
+            core->linked = 0;
+        }
+    }
+    victim->tag = block >> c->set_bits;
+    victim->last_use = c->clock;
+    set_state(victim, is_write ? MESI_M : held ? MESI_S : MESI_E);
+    if (is_write) {
+        core->stats.bus_read_excl++;
+    } else {
+        core->stats.bus_reads++;
+    }
+    core->stats.transfers += held;
+    return penalty;
+}
+
+// Load into *value, or store *value
+static void data_access(ArchState_t *st, uint32_t address, int is_write, int size, int is_signed, int32_t *value) {
+    if (is_write) {
+        mem_write_sized(st, address, size, *value);
+    } else {
+        *value = mem_read_sized(st, address, size, is_signed);
+    }
+}
+
+int mc_access(McCore_t *core, uint32_t address, int is_write, int llsc, int size, int is_signed, int32_t *value) {
+    Cache_t *c = &core->sim->dcache;
+    uint32_t block = address >> c->line_bits;
+    if (llsc == LLSC_NONE) {
+        // Reads of any valid line and writes to an owned one stay private. The
+        // line is busy while the data moves, so no snoop can take it in between.
+        CacheLine_t *line = l1_find(c, block);
+        uint8_t state = line ? (uint8_t)load_state(line) : MESI_I;
+        if (state != MESI_I && (!is_write || state == MESI_M || state == MESI_E) &&
+            __atomic_compare_exchange_n(&line->state, &state, (uint8_t)(state | LINE_BUSY), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            data_access(&core->sim->arch, address, is_write, size, is_signed, value);
+            __atomic_store_n(&line->state, (uint8_t)(is_write ? MESI_M : state), __ATOMIC_RELEASE);
+            c->clock++;
+            c->hits++;
+            line->last_use = c->clock;
+            return 0;
+        }
+    }
+    McSystem_t *sys = core->sys;
+    int stall = 0;
+    pthread_mutex_lock(&sys->bus);
+    // A store-conditional that is going to fail stays off the bus
+    if (llsc != LLSC_SC || (core->linked && core->link_block == block)) {
+        stall = bus_transaction(core, address, is_write);
+    }
+    if (llsc == LLSC_LL) {
+        core->linked = 1;
+        core->link_block = block;
+        core->stats.ll++;
+    }
+    // The data moves with the line state and the link (SC stores in
+    // mc_store_conditional, under the lock again)
+    if (llsc != LLSC_SC) {
+        data_access(&core->sim->arch, address, is_write, size, is_signed, value);
+    }
+    pthread_mutex_unlock(&sys->bus);
+    return stall;
+}
+
+int mc_store_conditional(Sim_t *sim, uint32_t address, int32_t value) {
+    McCore_t *core = sim->core;
+    if (!core) {
+        mem_write_sized(&sim->arch, address, 4, value);
+        return 1;
+    }
+    McSystem_t *sys = core->sys;
+    uint32_t block = address >> sim->dcache.line_bits;
+    pthread_mutex_lock(&sys->bus);
+    int stored = core->linked && core->link_block == block;
+    if (stored) {
+        // The line is still here (losing it breaks the link), but others may
+        // have read it since the access in this MEM stage
+        CacheLine_t *line = l1_find(&sim->dcache, block);
+        if (line && load_state(line) == MESI_S) {
+            snoop(core, block, 1);
+            core->stats.bus_upgrades++;
+        }
+        if (line) {
+            set_state(line, MESI_M);
+        }
+        mem_write_sized(&sim->arch, address, 4, value);
+        core->stats.sc_success++;
+    } else {
+        core->stats.sc_fail++;
+    }
+    core->linked = 0;
+    pthread_mutex_unlock(&sys->bus);
+    return stored;
+}
+
+// Wait until every core has reached the end of the current quantum. Returns 1
+// once all of their programs have finished.
+static int quantum_barrier(McSystem_t *sys, int finished) {
+    pthread_mutex_lock(&sys->sync);
+    long generation = sys->generation;
+    sys->unfinished += !finished;
+    if (++sys->arrived == sys->num_cores) {
+        sys->stop = (sys->unfinished == 0);
+        sys->arrived = 0;
+        sys->unfinished = 0;
+        sys->generation++;
+        pthread_cond_broadcast(&sys->next);
+    } else {
+        while (generation == sys->generation) {
+            pthread_cond_wait(&sys->next, &sys->sync);
+        }
+    }
+    // stop only changes again once this thread has arrived at the next barrier
+    int stop = sys->stop;
+    pthread_mutex_unlock(&sys->sync);
+    return stop;
+}
+
+static void run_core(McCore_t *core) {
+    Sim_t *sim = core->sim;
+    for (long end = core->sys->quantum; ; end += core->sys->quantum) {
+        sim->cycle_limit = end;
+        while (sim->cycle < end && sim_step(sim)) {
+        }
+        if (quantum_barrier(core->sys, sim->finished)) {
+            return;
+        }
+    }
+}
+
+static void *core_thread(void *arg) {
+    McCore_t *core = arg;
+    McSystem_t *sys = core->sys;
+    // Start only once every thread exists, as the barrier counts all cores
+    pthread_mutex_lock(&sys->sync);
+    while (!sys->started) {
+        pthread_cond_wait(&sys->next, &sys->sync);
+    }
+    int abort = sys->abort;
+    pthread_mutex_unlock(&sys->sync);
+    if (!abort) {
+        run_core(core);
+    }
+    return NULL;
+}
+
+static void report(const McSystem_t *sys, FILE *out) {
+    long cycles = 0, instructions = 0;
+    McCoreStats_t total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < sys->num_cores; ++i) {
+        const Sim_t *sim = sys->cores[i].sim;
+        const McCoreStats_t *s = &sys->cores[i].stats;
+        cycles = sim->cycle > cycles ? sim->cycle : cycles;
+        instructions += sim->instructions;
+        total.bus_reads += s->bus_reads;
+        total.bus_read_excl += s->bus_read_excl;
+        total.bus_upgrades += s->bus_upgrades;
+        total.transfers += s->transfers;
+        total.invalidations += s->invalidations;
+        total.flushes += s->flushes;
+        total.ll += s->ll;
+        total.sc_success += s->sc_success;
+        total.sc_fail += s->sc_fail;
+    }
+    fprintf(out, "Multicore simulation of %d cores completed in %ld cycles (%s, quantum %ld cycles).\n",
+            sys->num_cores, cycles, sys->cores[0].sim->config.forwarding ? "forwarding" : "stall-only",
+            sys->quantum);
+    fprintf(out, "Total instructions executed (completed): %ld (IPC %.3f)\n", instructions,
+            cycles ? (double)instructions / (double)cycles : 0.0);
+    for (int i = 0; i < sys->num_cores; ++i) {
+        const Sim_t *sim = sys->cores[i].sim;
+        const McCoreStats_t *s = &sys->cores[i].stats;
+        long accesses = sim->dcache.hits + sim->dcache.misses;
+        fprintf(out, "Core %d: %ld cycles, %ld instructions (CPI %.3f)", i, sim->cycle, sim->instructions,
+                sim->instructions ? (double)sim->cycle / (double)sim->instructions : 0.0);
+        if (sim->exited) {
+            fprintf(out, ", exited with code %d", sim->exit_code);
+        } else if (sim->invalid) {
+            fprintf(out, ", stopped at an invalid instruction");
+        }
+        fprintf(out, "\n  L1 D: %ld accesses, %ld misses (%.2f%%), %ld writebacks; bus: %ld BusRd, "
+                "%ld BusRdX, %ld BusUpgr, %ld served by other caches; %ld lines invalidated, "
+                "%ld modified lines supplied; LL %ld, SC %ld ok / %ld failed\n",
+                accesses, sim->dcache.misses,
+                accesses ? 100.0 * (double)sim->dcache.misses / (double)accesses : 0.0,
+                sim->dcache.writebacks, s->bus_reads, s->bus_read_excl, s->bus_upgrades, s->transfers,
+                s->invalidations, s->flushes, s->ll, s->sc_success, s->sc_fail);
+    }
+    fprintf(out, "Coherence bus: %ld transactions (%ld BusRd, %ld BusRdX, %ld BusUpgr), "
+            "%ld cache-to-cache transfers, %ld invalidations, %ld modified lines supplied\n",
+            total.bus_reads + total.bus_read_excl + total.bus_upgrades, total.bus_reads,
+            total.bus_read_excl, total.bus_upgrades, total.transfers, total.invalidations, total.flushes);
+    fprintf(out, "LL/SC: %ld LL, %ld SC succeeded, %ld failed\n", total.ll, total.sc_success, total.sc_fail);
+    const ArchState_t *shared = &sys->cores[0].sim->arch;
+    fprintf(out, "Data memory (shared): %ld pages touched, %zu KB resident\n",
+            shared->mem.resident_pages, memory_resident_bytes(&shared->mem) / 1024);
+}
+
+int mc_run(const SimConfig_t *cfg, const char *program, FILE *out) {
+    if (cfg->functional || cfg->dual_issue || cfg->ooo || cfg->trace_file || cfg->stats ||
+        cfg->stats_json || cfg->stats_csv || cfg->checkpoint_file || cfg->restore_file ||
+        cfg->record_file || cfg->sample_size) {
+        fprintf(stderr, "--cores runs the scalar pipeline only (no --functional, --dual-issue, --ooo, "
+                "--trace, --stats options, --checkpoint, --restore, --record or --sample)\n");
+        return -1;
+    }
+    if (!cfg->dcache.size || !cfg->dcache.write_back) {
+        fprintf(stderr, "--cores needs a write-back --dcache for the coherent L1 caches\n");
+        return -1;
+    }
+    McSystem_t sys;
+    memset(&sys, 0, sizeof(sys));
+    sys.num_cores = cfg->cores;
+    sys.quantum = cfg->quantum;
+    sys.cores = calloc(cfg->cores, sizeof(McCore_t));
+    pthread_t *threads = malloc(cfg->cores * sizeof(pthread_t));
+    if (!sys.cores || !threads) {
+        fprintf(stderr, "Failed to allocate cores\n");
+        free(sys.cores);
+        free(threads);
+        return -1;
+    }
+    pthread_mutex_init(&sys.bus, NULL);
+    pthread_mutex_init(&sys.pages, NULL);
+    pthread_mutex_init(&sys.sync, NULL);
+    pthread_cond_init(&sys.next, NULL);
+    // Each core is a single-core context
+    SimConfig_t core_cfg = *cfg;
+    core_cfg.cores = 1;
+    int status = 0;
+    for (int i = 0; i < sys.num_cores && status == 0; ++i) {
+        McCore_t *core = &sys.cores[i];
+        core->sys = &sys;
+        core->id = i;
+        core->sim = sim_create(&core_cfg);
+        if (!core->sim || sim_load(core->sim, program) < 0) {
+            status = -1;
+            break;
+        }
+        if (i > 0) {
+            memory_share(&core->sim->arch.mem, &sys.cores[0].sim->arch.mem, &sys.pages);
+        }
+        core->sim->core = core;
+        core->sim->engine = pipeline_select(core->sim);
+        core->sim->arch.registers[CORE_ID_REG] = i;
+        core->sim->arch.registers[CORE_COUNT_REG] = sys.num_cores;
+    }
+    if (status == 0) {
+        // Core 0 runs on this thread
+        int created = 1;
+        while (created < sys.num_cores &&
+               pthread_create(&threads[created], NULL, core_thread, &sys.cores[created]) == 0) {
+            ++created;
+        }
+        pthread_mutex_lock(&sys.sync);
+        sys.started = 1;
+        sys.abort = (created < sys.num_cores);
+        pthread_cond_broadcast(&sys.next);
+        pthread_mutex_unlock(&sys.sync);
+        if (sys.abort) {
+            fprintf(stderr, "Failed to start core threads\n");
+            status = -1;
+        } else {
+            run_core(&sys.cores[0]);
+        }
+        for (int i = 1; i < created; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    if (status == 0) {
+        report(&sys, out);
+        Sim_t **sims = malloc(sys.num_cores * sizeof(Sim_t *));
+        for (int i = 0; sims && i < sys.num_cores; ++i) {
+            sims[i] = sys.cores[i].sim;
+        }
+        if (!sims || dump_final_states(sims, sys.num_cores, "core", 0, out) < 0) {
+            status = -1;
+        }
+        free(sims);
+        for (int i = 0; i < sys.num_cores; ++i) {
+            if (sys.cores[i].sim->invalid) {
+                status = -1;
+            }
+        }
+    }
+    // Core 0 owns the shared pages and goes last
+    for (int i = sys.num_cores - 1; i >= 0; --i) {
+        sim_destroy(sys.cores[i].sim);
+    }
+    pthread_cond_destroy(&sys.next);
+    pthread_mutex_destroy(&sys.sync);
+    pthread_mutex_destroy(&sys.pages);
+    pthread_mutex_destroy(&sys.bus);
+    free(threads);
+    free(sys.cores);
+    return status;
+}
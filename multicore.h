@@ -0,0 +1,64 @@
+/**
+ * multicore.h - Multicore system: pipeline cores sharing one memory, each with
+ * a private L1 data cache kept coherent by MESI over a snooping bus, LL/SC
+ * synchronization, and parallel simulation on one host thread per core.
+ */
+#ifndef MULTICORE_H
+#define MULTICORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "sim.h"
+
+// MESI state of a coherent L1 line
+enum MesiState {
+    MESI_I = 0,
+    MESI_S,
+    MESI_E,
+    MESI_M
+};
+
+// Coherence activity of one core
+typedef struct {
+    long bus_reads;         // BusRd: read misses
+    long bus_read_excl;     // BusRdX: write misses
+    long bus_upgrades;      // BusUpgr: writes to a shared line
+    long transfers;         // misses served by another core's cache
+    long invalidations;     // lines taken away by other cores' writes
+    long flushes;           // modified lines supplied to other cores
+    long ll;
+    long sc_success;
+    long sc_fail;
+} McCoreStats_t;
+
+struct McSystem;
+
+typedef struct McCore {
+    struct McSystem *sys;
+    struct Sim *sim;
+    int id;
+    int linked;             // LL link still holds
+    uint32_t link_block;    // line (address >> line bits) of the link
+    McCoreStats_t stats;
+} McCore_t;
+
+// Data cache access of a load (LL if llsc is LLSC_LL, which also sets the
+// link) or store by core, keeping the other cores' caches coherent, and the
+// memory access itself: size bytes loaded into *value (sign-extended if
+// is_signed) or *value stored. Hits in a private state need no bus. For an SC
+// only the line is acquired; mc_store_conditional stores. Returns the stall
+// cycles it adds.
+int mc_access(McCore_t *core, uint32_t address, int is_write, int llsc, int size, int is_signed,
+              int32_t *value);
+
+// Store-conditional of the core simulated by sim: write the word at address
+// if its link still holds and clear the link. Returns 1 if it stored, 0 if
+// not. A single-core simulation never loses its link.
+int mc_store_conditional(struct Sim *sim, uint32_t address, int32_t value);
+
+// Run program on cfg->cores cores, each starting at the entry point with its
+// core number in $k0 and the core count in $k1, and print the report to out.
+// Returns 0 on success, -1 on error or if a core stopped at an invalid instruction.
+int mc_run(const SimConfig_t *cfg, const char *program, FILE *out);
+
+#endif // MULTICORE_H
@@ -0,0 +1,598 @@
+/**
+ * ooo.c - Out-of-order core model. Instructions are fetched down the predicted
+ * path, renamed onto reorder buffer entries and dispatched to per-unit
+ * reservation stations; they issue when their operands have been broadcast on
+ * the common data bus and commit in program order, which keeps exceptions
+ * (SYSCALL) and misprediction recovery precise. Memory is only written at
+ * commit, so wrong-path loads and stores leave no trace.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "alu.h"
+#include "decode.h"
+#include "branch.h"
+#include "cache.h"
+#include "syscall.h"
+#include "sim.h"
+#include "ooo.h"
+
+#define RAT_HI NUM_REGS         /* rename table slots of HI and LO */
+#define RAT_LO (NUM_REGS + 1)
+#define RAT_SIZE (NUM_REGS + 2)
+#define NO_UNIT -1              /* needs no functional unit (nop, syscall, invalid) */
+
+// Progress of a reorder buffer entry
+enum RobState {
+    ROB_WAITING = 0,    /* in a reservation station (syscall, invalid: until it reaches the head) */
+    ROB_ADDRESSED,      /* load with its address, waiting for memory */
+    ROB_EXECUTING,      /* result on the data bus at ready_at */
+    ROB_DONE
+};
+
+typedef struct {
+    const DecodedInst_t *d;
+    uint32_t pc;
+    uint32_t pred_next;     // PC fetch continued at after this instruction
+    uint32_t next_pc;       // resolved next PC of a branch or jump
+    uint32_t addr;          // effective address of a load/store
+    int32_t value;          // result (LO of a multiply/divide)
+    int32_t hi;             // HI of a multiply/divide
+    int32_t store_val;
+    long ready_at;
+    uint8_t state;
+    uint8_t taken;
+} RobEntry_t;
+
+typedef struct {
+    uint8_t busy;
+    uint8_t q_hi[2];    // operand is the producer's HI result
+    int rob;            // entry the result belongs to
+    int q[2];           // entry producing operand A/B, -1 once the value is in v
+    int32_t v[2];
+} RsEntry_t;
+
+typedef struct {
+    uint32_t pc;
+    uint32_t pred_next;
+} FetchEntry_t;
+
+struct Ooo {
+    OooConfig_t cfg;
+    OooStats_t stats;
+    RobEntry_t *rob;
+    int head, count;
+    RsEntry_t *rs[UNIT_COUNT];
+    long *md_free_at;       // cycle each multiply/divide unit takes new work
+    int rat[RAT_SIZE];      // entry producing each register, -1: register file
+    int mem_in_flight;      // loads and stores in the load/store queue
+    FetchEntry_t *fq;
+    int fq_head, fq_count, fq_size;
+    uint32_t fetch_pc;
+    int fetch_wait;
+    int fetch_ready;
+    int fetch_stopped;      // program exited, nothing more to fetch
+};
+
+void ooo_config_default(OooConfig_t *cfg) {
+    cfg->rob_size = OOO_ROB_SIZE;
+    cfg->width = OOO_WIDTH;
+    cfg->units[UNIT_ALU] = OOO_ALU_UNITS;
+    cfg->units[UNIT_MEM] = OOO_MEM_UNITS;
+    cfg->units[UNIT_MULDIV] = OOO_MULDIV_UNITS;
+    cfg->rs_size = OOO_RS_SIZE;
+    cfg->lsq_size = OOO_LSQ_SIZE;
+}
+
+int ooo_parse_units(const char *text, int units[UNIT_COUNT]) {
+    int parsed[UNIT_COUNT];
+    const char *p = text;
+    for (int i = 0; i < UNIT_COUNT; ++i) {
+        char *end;
+        long n = strtol(p, &end, 10);
+        if (end == p || n < 1 || n > 64 || *end != (i == UNIT_COUNT - 1 ? '\0' : ':')) {
+            return -1;
+        }
+        parsed[i] = (int)n;
+        p = end + 1;
+    }
+    memcpy(units, parsed, sizeof(parsed));
+    return 0;
+}
+
+Ooo_t *ooo_create(const OooConfig_t *cfg, uint32_t pc) {
+    Ooo_t *o = calloc(1, sizeof(*o));
+    if (!o) {
+        fprintf(stderr, "Failed to allocate out-of-order core\n");
+        return NULL;
+    }
+    o->cfg = *cfg;
+    o->fq_size = 4 * cfg->width;
+    o->rob = calloc(cfg->rob_size, sizeof(*o->rob));
+    o->fq = calloc(o->fq_size, sizeof(*o->fq));
+    o->md_free_at = calloc(cfg->units[UNIT_MULDIV], sizeof(*o->md_free_at));
+    int ok = o->rob && o->fq && o->md_free_at;
+    for (int u = 0; u < UNIT_COUNT; ++u) {
+        o->rs[u] = calloc(cfg->rs_size, sizeof(*o->rs[u]));
+        ok = ok && o->rs[u];
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate out-of-order core\n");
+        ooo_free(o);
+        return NULL;
+    }
+    for (int r = 0; r < RAT_SIZE; ++r) {
+        o->rat[r] = -1;
+    }
+    o->fetch_pc = pc;
+    return o;
+}
+
+void ooo_free(Ooo_t *o) {
+    if (!o) {
+        return;
+    }
+    for (int u = 0; u < UNIT_COUNT; ++u) {
+        free(o->rs[u]);
+    }
+    free(o->md_free_at);
+    free(o->fq);
+    free(o->rob);
+    free(o);
+}
+
+// Position of ROB entry idx counted from the head (0 = oldest)
+static int rob_age(const Ooo_t *o, int idx) {
+    return (idx - o->head + o->cfg.rob_size) % o->cfg.rob_size;
+}
+
+static int rob_index(const Ooo_t *o, int age) {
+    return (o->head + age) % o->cfg.rob_size;
+}
+
+static int unit_of(const DecodedInst_t *d) {
+    if (d->memRead || d->memWrite) {
+        return UNIT_MEM;
+    }
+    if (d->muldiv) {
+        return UNIT_MULDIV;
+    }
+    if (d->kind == KIND_NOP || d->kind == KIND_INVALID || d->syscall) {
+        return NO_UNIT;
+    }
+    return UNIT_ALU;
+}
+
+// Common data bus: hand the result of entry idx to every waiting operand
+static void broadcast(Ooo_t *o, int idx) {
+    const RobEntry_t *e = &o->rob[idx];
+    for (int u = 0; u < UNIT_COUNT; ++u) {
+        for (int i = 0; i < o->cfg.rs_size; ++i) {
+            RsEntry_t *s = &o->rs[u][i];
+            for (int k = 0; s->busy && k < 2; ++k) {
+                if (s->q[k] == idx) {
+                    s->v[k] = s->q_hi[k] ? e->hi : e->value;
+                    s->q[k] = -1;
+                }
+            }
+        }
+    }
+}
+
+static void rename_dest(Ooo_t *o, const DecodedInst_t *d, int idx) {
+    if (d->regWrite && d->destReg != 0) {
+        o->rat[d->destReg] = idx;
+    }
+    if (d->muldiv) {
+        o->rat[RAT_HI] = o->rat[RAT_LO] = idx;
+    }
+}
+
+// Recovery after a misprediction or an exit: discard everything younger than
+// entry idx and the fetch queue, and rebuild the rename table from the rest
+static void flush_after(Sim_t *sim, int idx) {
+    Ooo_t *o = sim->ooo;
+    int keep = rob_age(o, idx) + 1;
+    for (int age = keep; age < o->count; ++age) {
+        const RobEntry_t *e = &o->rob[rob_index(o, age)];
+        if (e->d->memRead || e->d->memWrite) {
+            o->mem_in_flight--;
+        }
+        o->stats.squashed += e->d->instr != 0;
+    }
+    for (int u = 0; u < UNIT_COUNT; ++u) {
+        for (int i = 0; i < o->cfg.rs_size; ++i) {
+            RsEntry_t *s = &o->rs[u][i];
+            if (s->busy && rob_age(o, s->rob) >= keep) {
+                s->busy = 0;
+            }
+        }
+    }
+    o->count = keep;
+    for (int r = 0; r < RAT_SIZE; ++r) {
+        o->rat[r] = -1;
+    }
+    for (int age = 0; age < o->count; ++age) {
+        int i = rob_index(o, age);
+        rename_dest(o, o->rob[i].d, i);
+    }
+    o->fq_count = 0;
+    o->fetch_wait = 0;
+    o->fetch_ready = 0;
+}
+
+// Retire finished instructions from the head in program order. Stores write
+// memory here and SYSCALL runs here, once everything older has committed; an
+// invalid instruction stops the program here.
+static void commit(Sim_t *sim) {
+    Ooo_t *o = sim->ooo;
+    ArchState_t *st = &sim->arch;
+    for (int n = 0; n < o->cfg.width && o->count; ++n) {
+        RobEntry_t *e = &o->rob[o->head];
+        const DecodedInst_t *d = e->d;
+        if (d->syscall && e->state != ROB_DONE) {
+            e->value = st->registers[2];
+            int exited = syscall_exec(sim, e->pc, st->registers[2], st->registers[4], &e->value);
+            e->state = ROB_DONE;
+            broadcast(o, o->head);
+            if (exited) {
+                flush_after(sim, o->head);
+                o->fetch_stopped = 1;
+            }
+        }
+        if (d->invalid && e->state != ROB_DONE) {
+            // Wrong-path invalid instructions are flushed before they get here
+            sim_invalid(sim, e->pc, d->instr);
+            e->state = ROB_DONE;
+            flush_after(sim, o->head);
+            o->fetch_stopped = 1;
+        }
+        if (e->state != ROB_DONE) {
+            break;
+        }
+        if (d->memWrite) {
+            cache_access(&sim->dcache, e->addr, 1);
+            mem_write_sized(st, e->addr, d->memSize, e->store_val);
+        }
+        if (d->regWrite && d->destReg != 0) {
+            reg_write(st, d->destReg, e->value);
+            if (o->rat[d->destReg] == o->head) {
+                o->rat[d->destReg] = -1;
+            }
+        }
+        if (d->muldiv) {
+            st->hi = e->hi;
+            st->lo = e->value;
+            if (o->rat[RAT_HI] == o->head) {
+                o->rat[RAT_HI] = o->rat[RAT_LO] = -1;
+            }
+        }
+        if (d->memRead || d->memWrite) {
+            o->mem_in_flight--;
+        }
+        sim->instructions += d->instr != 0;
+        o->head = (o->head + 1) % o->cfg.rob_size;
+        o->count--;
+    }
+}
+
+// Put finished results on the data bus, oldest first and at most width per
+// cycle. Branches and jumps resolve here and recover from a misprediction.
+static void writeback(Sim_t *sim) {
+    Ooo_t *o = sim->ooo;
+    int slots = o->cfg.width;
+    for (int age = 0; age < o->count; ++age) {
+        int idx = rob_index(o, age);
+        RobEntry_t *e = &o->rob[idx];
+        if (e->state != ROB_EXECUTING || e->ready_at > sim->cycle) {
+            continue;
+        }
+        // Stores only need to be marked done, they have no result to broadcast
+        if (!e->d->memWrite) {
+            if (!slots) {
+                o->stats.cdb_conflicts++;
+                continue;
+            }
+            slots--;
+        }
+        e->state = ROB_DONE;
+        broadcast(o, idx);
+        const DecodedInst_t *d = e->d;
+        if (d->branch || d->jump) {
+            int mispredict = e->next_pc != e->pred_next;
+            bp_update(&sim->bp, e->pc, d->jump != 0, e->taken, e->next_pc, mispredict);
+            if (mispredict) {
+                flush_after(sim, idx);
+                o->fetch_pc = e->next_pc;
+                o->stats.flushes++;
+            }
+        }
+    }
+}
+
+// Value a load reads from an older store of the same address and size
+static int32_t forward_value(const DecodedInst_t *load, int32_t store_val) {
+    if (load->memSize == 1) {
+        return load->memSigned ? (int32_t)(int8_t)store_val : (store_val & 0xFF);
+    }
+    if (load->memSize == 2) {
+        return load->memSigned ? (int32_t)(int16_t)store_val : (store_val & 0xFFFF);
+    }
+    return store_val;
+}
+
+// Load/store queue: loads with an address access memory, one per memory unit
+// and cycle, once no older store could still write the same bytes. A store of
+// the same address and size forwards its data; any other overlap waits for
+// the store to commit.
+static void memory_access(Sim_t *sim) {
+    Ooo_t *o = sim->ooo;
+    int ports = o->cfg.units[UNIT_MEM];
+    for (int age = 0; age < o->count && ports; ++age) {
+        RobEntry_t *e = &o->rob[rob_index(o, age)];
+        if (e->state != ROB_ADDRESSED || e->ready_at > sim->cycle) {
+            continue;
+        }
+        int blocked = 0, from = -1;
+        for (int older = 0; older < age && !blocked; ++older) {
+            const RobEntry_t *s = &o->rob[rob_index(o, older)];
+            if (!s->d->memWrite) {
+                continue;
+            }
+            if (s->state == ROB_WAITING) {
+                blocked = 1;
+            } else if (s->addr == e->addr && s->d->memSize == e->d->memSize) {
+                from = older;
+            } else if (e->addr - s->addr < s->d->memSize || s->addr - e->addr < e->d->memSize) {
+                // Overlap, also across the wrap at the top of the address space
+                blocked = 1;
+            }
+        }
+        if (blocked) {
+            o->stats.load_waits++;
+            continue;
+        }
+        if (from >= 0) {
+            e->value = forward_value(e->d, o->rob[rob_index(o, from)].store_val);
+            e->ready_at = sim->cycle + 1;
+            o->stats.loads_forwarded++;
+        } else {
+            int latency = cache_access(&sim->dcache, e->addr, 0);
+            e->value = mem_read_sized(&sim->arch, e->addr, e->d->memSize, e->d->memSigned);
+            e->ready_at = sim->cycle + 1 + latency;
+        }
+        e->state = ROB_EXECUTING;
+        ports--;
+    }
+}
+
+// Start the ready instruction in reservation station s on a unit of class u
+static void execute(Sim_t *sim, int u, RsEntry_t *s) {
+    Ooo_t *o = sim->ooo;
+    RobEntry_t *e = &o->rob[s->rob];
+    const DecodedInst_t *d = e->d;
+    int32_t a = s->v[0], b = s->v[1];
+    e->ready_at = sim->cycle + 1;
+    e->state = ROB_EXECUTING;
+    if (u == UNIT_MEM) {
+        // Address generation; a load then waits in the queue for memory
+        e->addr = (uint32_t)(a + d->imm);
+        e->store_val = b;
+        if (d->llsc == LLSC_SC) {
+            // A lone core keeps its link: SC is a store that reports success
+            e->value = 1;
+        } else if (d->memRead) {
+            e->state = ROB_ADDRESSED;
+        }
+    } else if (u == UNIT_MULDIV) {
+        alu_muldiv(d->muldiv, a, b, &e->hi, &e->value);
+        int latency = (d->muldiv <= MD_MULTU) ? sim->config.mult_latency : sim->config.div_latency;
+        e->ready_at = sim->cycle + latency;
+    } else if (d->jump) {
+        e->taken = 1;
+        e->next_pc = (d->jump == 2) ? (uint32_t)a : d->target;
+        e->value = (int32_t)(e->pc + 4);
+    } else if (d->branch) {
+        int equal = (a == b);
+        e->taken = (d->branch == 1) == equal;
+        e->next_pc = e->taken ? d->target : e->pc + 4;
+    } else {
+        e->value = alu_execute(d->ALUop, a, d->useImm ? d->imm : b);
+    }
+    s->busy = 0;
+}
+
+// Issue the oldest ready reservation station entries of every class to the
+// free units. ALU and address units are pipelined; a multiply/divide unit is
+// busy until its result is ready.
+static void issue(Sim_t *sim) {
+    Ooo_t *o = sim->ooo;
+    for (int u = 0; u < UNIT_COUNT; ++u) {
+        int free_units = o->cfg.units[u];
+        if (u == UNIT_MULDIV) {
+            free_units = 0;
+            for (int i = 0; i < o->cfg.units[u]; ++i) {
+                free_units += o->md_free_at[i] <= sim->cycle;
+            }
+        }
+        while (free_units > 0) {
+            RsEntry_t *pick = NULL;
+            int pick_age = o->cfg.rob_size;
+            for (int i = 0; i < o->cfg.rs_size; ++i) {
+                RsEntry_t *s = &o->rs[u][i];
+                if (s->busy && s->q[0] < 0 && s->q[1] < 0 && rob_age(o, s->rob) < pick_age) {
+                    pick = s;
+                    pick_age = rob_age(o, s->rob);
+                }
+            }
+            if (!pick) {
+                break;
+            }
+            execute(sim, u, pick);
+            if (u == UNIT_MULDIV) {
+                for (int i = 0; i < o->cfg.units[u]; ++i) {
+                    if (o->md_free_at[i] <= sim->cycle) {
+                        o->md_free_at[i] = o->rob[pick->rob].ready_at;
+                        break;
+                    }
+                }
+            }
+            free_units--;
+        }
+    }
+}
+
+// Read a source operand through the rename table: the value if it is known,
+// otherwise the entry that will broadcast it
+static void read_operand(const Sim_t *sim, int reg, RsEntry_t *s, int k) {
+    const Ooo_t *o = sim->ooo;
+    int hi = (reg == RAT_HI);
+    int producer = (reg == 0) ? -1 : o->rat[reg];
+    s->q[k] = -1;
+    s->q_hi[k] = (uint8_t)hi;
+    if (producer < 0) {
+        s->v[k] = (reg == RAT_HI) ? sim->arch.hi
+                : (reg == RAT_LO) ? sim->arch.lo : sim->arch.registers[reg];
+    } else if (o->rob[producer].state == ROB_DONE) {
+        s->v[k] = hi ? o->rob[producer].hi : o->rob[producer].value;
+    } else {
+        s->q[k] = producer;
+    }
+}
+
+// Rename and dispatch fetched instructions in order into the reorder buffer
+// and their reservation stations, until one finds its structure full
+static void dispatch(Sim_t *sim) {
+    Ooo_t *o = sim->ooo;
+    if (!o->fq_count) {
+        o->stats.dispatch_stall[OSTALL_EMPTY]++;
+        return;
+    }
+    for (int n = 0; n < o->cfg.width && o->fq_count; ++n) {
+        const FetchEntry_t *f = &o->fq[o->fq_head];
+        const DecodedInst_t *d = &sim->decoded[(f->pc - sim->arch.text_base) / 4];
+        int u = unit_of(d);
+        RsEntry_t *s = NULL;
+        if (o->count == o->cfg.rob_size) {
+            o->stats.dispatch_stall[OSTALL_ROB]++;
+            return;
+        }
+        if (u == UNIT_MEM && o->mem_in_flight == o->cfg.lsq_size) {
+            o->stats.dispatch_stall[OSTALL_LSQ]++;
+            return;
+        }
+        if (u != NO_UNIT) {
+            for (int i = 0; i < o->cfg.rs_size && !s; ++i) {
+                s = o->rs[u][i].busy ? NULL : &o->rs[u][i];
+            }
+            if (!s) {
+                o->stats.dispatch_stall[OSTALL_RS_ALU + u]++;
+                return;
+            }
+        }
+        int idx = rob_index(o, o->count);
+        RobEntry_t *e = &o->rob[idx];
+        memset(e, 0, sizeof(*e));
+        e->d = d;
+        e->pc = f->pc;
+        e->pred_next = f->pred_next;
+        e->state = (u == NO_UNIT && !d->syscall && !d->invalid) ? ROB_DONE : ROB_WAITING;
+        if (s) {
+            // MFHI/MFLO read HI/LO as operand A
+            read_operand(sim, d->hilo ? (d->hilo == 1 ? RAT_HI : RAT_LO) : d->srcA, s, 0);
+            read_operand(sim, d->srcB, s, 1);
+            s->rob = idx;
+            s->busy = 1;
+        }
+        rename_dest(o, d, idx);
+        if (u == UNIT_MEM) {
+            o->mem_in_flight++;
+        }
+        o->count++;
+        o->fq_head = (o->fq_head + 1) % o->fq_size;
+        o->fq_count--;
+    }
+}
+
+// Fetch up to width instructions from one instruction cache line down the
+// predicted path, ending the group after a predicted-taken branch or jump
+static void fetch(Sim_t *sim) {
+    Ooo_t *o = sim->ooo;
+    ArchState_t *st = &sim->arch;
+    uint32_t index = (o->fetch_pc - st->text_base) / 4;
+    if (o->fetch_stopped || index >= (uint32_t)st->instr_count || o->fq_count == o->fq_size) {
+        return;
+    }
+    if (!o->fetch_ready) {
+        o->fetch_wait = cache_access(&sim->icache, o->fetch_pc, 0);
+        o->fetch_ready = 1;
+    }
+    if (o->fetch_wait > 0) {
+        o->fetch_wait--;
+        sim->icache_stall_cycles++;
+        return;
+    }
+    o->fetch_ready = 0;
+    uint32_t line = sim->icache.lines ? sim->icache.config.line_size : 4u * o->cfg.width;
+    uint32_t first_line = o->fetch_pc / line;
+    for (int n = 0; n < o->cfg.width && o->fq_count < o->fq_size; ++n) {
+        index = (o->fetch_pc - st->text_base) / 4;
+        if (index >= (uint32_t)st->instr_count || (n && o->fetch_pc / line != first_line)) {
+            break;
+        }
+        FetchEntry_t *f = &o->fq[(o->fq_head + o->fq_count) % o->fq_size];
+        uint32_t target;
+        int taken = bp_predict(&sim->bp, o->fetch_pc, &target);
+        f->pc = o->fetch_pc;
+        f->pred_next = taken ? target : o->fetch_pc + 4;
+        o->fq_count++;
+        o->fetch_pc = f->pred_next;
+        if (taken) {
+            break;
+        }
+    }
+}
+
+int ooo_step(Sim_t *sim) {
+    Ooo_t *o = sim->ooo;
+    sim->cycle++;
+    uint32_t index = (o->fetch_pc - sim->arch.text_base) / 4;
+    if (!o->count && !o->fq_count && (o->fetch_stopped || index >= (uint32_t)sim->arch.instr_count)) {
+        return 0;
+    }
+    o->stats.rob_occupancy += o->count;
+    // Stages run oldest first, so each sees the state left by the previous
+    // cycle of the younger ones
+    commit(sim);
+    writeback(sim);
+    memory_access(sim);
+    issue(sim);
+    dispatch(sim);
+    fetch(sim);
+    return 1;
+}
+
+void ooo_report(const Sim_t *sim, FILE *out) {
+    const Ooo_t *o = sim->ooo;
+    const OooConfig_t *c = &o->cfg;
+    const OooStats_t *s = &o->stats;
+    fprintf(out, "Out-of-order simulation completed in %ld cycles (ROB %d, width %d, "
+            "%d ALU/%d memory/%d mul-div units, %d RS entries per class, LSQ %d).\n",
+            sim->cycle, c->rob_size, c->width, c->units[UNIT_ALU], c->units[UNIT_MEM],
+            c->units[UNIT_MULDIV], c->rs_size, c->lsq_size);
+    fprintf(out, "Total instructions executed (completed): %ld\n", sim->instructions);
+    fprintf(out, "IPC %.3f (CPI %.3f), average ROB occupancy %.1f\n",
+            sim->cycle ? (double)sim->instructions / (double)sim->cycle : 0.0,
+            sim->instructions ? (double)sim->cycle / (double)sim->instructions : 0.0,
+            sim->cycle ? (double)s->rob_occupancy / (double)sim->cycle : 0.0);
+    fprintf(out, "Dispatch stall cycles: ROB full %ld, ALU RS full %ld, memory RS full %ld, "
+            "mul-div RS full %ld, LSQ full %ld, front end empty %ld\n",
+            s->dispatch_stall[OSTALL_ROB], s->dispatch_stall[OSTALL_RS_ALU],
+            s->dispatch_stall[OSTALL_RS_MEM], s->dispatch_stall[OSTALL_RS_MULDIV],
+            s->dispatch_stall[OSTALL_LSQ], s->dispatch_stall[OSTALL_EMPTY]);
+    fprintf(out, "Loads forwarded from stores %ld, load cycles waiting on older stores %ld, "
+            "CDB conflicts %ld\n", s->loads_forwarded, s->load_waits, s->cdb_conflicts);
+    fprintf(out, "Misprediction recoveries %ld, %ld instructions squashed\n",
+            s->flushes, s->squashed);
+}
@@ -0,0 +1,70 @@
+/**
+ * ooo.h - Out-of-order core model: register renaming, reservation stations,
+ * a common data bus, a reorder buffer and a load/store queue (Tomasulo).
+ */
+#ifndef OOO_H
+#define OOO_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Functional unit classes, each with its own reservation stations
+enum OooUnit {
+    UNIT_ALU = 0,     /* ALU operations, branches and jumps (pipelined, 1 cycle) */
+    UNIT_MEM,         /* address generation of loads and stores, one cache port each */
+    UNIT_MULDIV,      /* multiply/divide (not pipelined) */
+    UNIT_COUNT
+};
+
+// Reasons dispatch stopped for a cycle
+enum OooStall {
+    OSTALL_ROB = 0,   /* reorder buffer full */
+    OSTALL_RS_ALU,    /* reservation stations of the unit class full */
+    OSTALL_RS_MEM,
+    OSTALL_RS_MULDIV,
+    OSTALL_LSQ,       /* load/store queue full */
+    OSTALL_EMPTY,     /* nothing fetched to dispatch */
+    OSTALL_COUNT
+};
+
+// Core geometry
+typedef struct {
+    int rob_size;
+    int width;              // instructions fetched, dispatched, completed and committed per cycle
+    int units[UNIT_COUNT];  // functional units per class
+    int rs_size;            // reservation station entries per unit class
+    int lsq_size;           // loads and stores between dispatch and commit
+} OooConfig_t;
+
+// Counters of one run
+typedef struct {
+    long dispatch_stall[OSTALL_COUNT];
+    long rob_occupancy;     // sum over cycles of the entries in use
+    long cdb_conflicts;     // results held back a cycle by a full data bus
+    long loads_forwarded;   // loads served from an older store in the queue
+    long load_waits;        // cycles loads waited for an older store's address or commit
+    long flushes;           // misprediction recoveries
+    long squashed;          // instructions discarded by them
+} OooStats_t;
+
+struct Sim;
+typedef struct Ooo Ooo_t;
+
+// Fill cfg with the default geometry.
+void ooo_config_default(OooConfig_t *cfg);
+
+// Parse "ALU:MEM:MULDIV" unit counts. Returns -1 if malformed.
+int ooo_parse_units(const char *text, int units[UNIT_COUNT]);
+
+// Allocate an empty core that starts fetching at pc. Returns NULL on failure.
+Ooo_t *ooo_create(const OooConfig_t *cfg, uint32_t pc);
+void ooo_free(Ooo_t *o);
+
+// Simulate one clock cycle of sim->ooo. Returns 0 once the core has drained
+// with no more instructions to fetch.
+int ooo_step(struct Sim *sim);
+
+// Print the out-of-order summary (cycles, IPC, structural stalls).
+void ooo_report(const struct Sim *sim, FILE *out);
+
+#endif // OOO_H
@@ -0,0 +1,288 @@
+/**
+ * options.c - Parsing of per-simulation command-line options.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "branch.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "dump.h"
+#include "ooo.h"
+#include "sample.h"
+#include "sim.h"
+#include "options.h"
+
+// Parse an address in decimal, hex (0x) or octal. Returns -1 if invalid.
+static int parse_address(const char *text, uint32_t *value) {
+    char *end;
+    unsigned long v = strtoul(text, &end, 0);
+    if (end == text || *end != '\0' || v > 0xFFFFFFFFul) {
+        return -1;
+    }
+    *value = (uint32_t)v;
+    return 0;
+}
+
+int options_parse_one(int argc, char *argv[], int *index, SimConfig_t *cfg) {
+    const char *arg = argv[*index];
+    if (strcmp(arg, "--functional") == 0) {
+        cfg->functional = 1;
+    } else if (strcmp(arg, "--no-jit") == 0) {
+        cfg->no_jit = 1;
+    } else if (strcmp(arg, "--forwarding") == 0) {
+        cfg->forwarding = 1;
+    } else if (strcmp(arg, "--extrapolate") == 0) {
+        cfg->extrapolate = 1;
+    } else if (strcmp(arg, "--dual-issue") == 0) {
+        cfg->dual_issue = 1;
+    } else if (strcmp(arg, "--bp") == 0) {
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        cfg->bp_policy = bp_parse_policy(argv[++*index]);
+        if (cfg->bp_policy < 0) {
+            fprintf(stderr, "Unknown branch predictor: %s\n", argv[*index]);
+            return -1;
+        }
+    } else if (strcmp(arg, "--icache") == 0 || strcmp(arg, "--dcache") == 0) {
+        CacheConfig_t *cache = (arg[2] == 'i') ? &cfg->icache : &cfg->dcache;
+        if (*index + 1 >= argc || cache_parse_geometry(argv[++*index], cache) < 0) {
+            fprintf(stderr, "Invalid or missing geometry for %s (expected SIZE:ASSOC:LINE)\n", arg);
+            return -1;
+        }
+    } else if (strcmp(arg, "--cache-repl") == 0 || strcmp(arg, "--cache-write") == 0 ||
+               strcmp(arg, "--miss-latency") == 0) {
+        // Policies apply to both caches
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        const char *value = argv[++*index];
+        if (strcmp(arg, "--cache-repl") == 0) {
+            int repl = strcmp(value, "lru") == 0 ? CACHE_LRU
+                     : strcmp(value, "random") == 0 ? CACHE_RANDOM : -1;
+            if (repl < 0) {
+                fprintf(stderr, "Unknown replacement policy: %s\n", value);
+                return -1;
+            }
+            cfg->icache.replacement = cfg->dcache.replacement = repl;
+        } else if (strcmp(arg, "--cache-write") == 0) {
+            int wb = strcmp(value, "back") == 0 ? 1 : strcmp(value, "through") == 0 ? 0 : -1;
+            if (wb < 0) {
+                fprintf(stderr, "Unknown write policy: %s\n", value);
+                return -1;
+            }
+            cfg->icache.write_back = cfg->dcache.write_back = wb;
+        } else {
+            int latency = atoi(value);
+            if (latency < 0) {
+                fprintf(stderr, "Invalid miss latency: %s\n", value);
+                return -1;
+            }
+            cfg->icache.miss_latency = cfg->dcache.miss_latency = latency;
+        }
+    } else if (strcmp(arg, "--mult-latency") == 0 || strcmp(arg, "--div-latency") == 0) {
+        int latency = (*index + 1 < argc) ? atoi(argv[++*index]) : 0;
+        if (latency < 1) {
+            fprintf(stderr, "Invalid or missing latency for %s (at least 1 cycle)\n", arg);
+            return -1;
+        }
+        if (arg[2] == 'm') {
+            cfg->mult_latency = latency;
+        } else {
+            cfg->div_latency = latency;
+        }
+    } else if (strcmp(arg, "--ooo") == 0) {
+        cfg->ooo = 1;
+    } else if (strcmp(arg, "--rob") == 0 || strcmp(arg, "--ooo-width") == 0 ||
+               strcmp(arg, "--rs-size") == 0 || strcmp(arg, "--lsq") == 0) {
+        int n = (*index + 1 < argc) ? atoi(argv[++*index]) : 0;
+        if (n < 1 || n > 1024) {
+            fprintf(stderr, "Invalid or missing size for %s (1 to 1024)\n", arg);
+            return -1;
+        }
+        if (strcmp(arg, "--rob") == 0) {
+            cfg->ooo_config.rob_size = n;
+        } else if (strcmp(arg, "--ooo-width") == 0) {
+            cfg->ooo_config.width = n;
+        } else if (strcmp(arg, "--rs-size") == 0) {
+            cfg->ooo_config.rs_size = n;
+        } else {
+            cfg->ooo_config.lsq_size = n;
+        }
+    } else if (strcmp(arg, "--units") == 0) {
+        if (*index + 1 >= argc || ooo_parse_units(argv[++*index], cfg->ooo_config.units) < 0) {
+            fprintf(stderr, "Invalid or missing value for %s (expected ALU:MEM:MULDIV counts)\n", arg);
+            return -1;
+        }
+    } else if (strcmp(arg, "--cores") == 0) {
+        int n = (*index + 1 < argc) ? atoi(argv[++*index]) : 0;
+        if (n < 1 || n > MAX_CORES) {
+            fprintf(stderr, "Invalid or missing core count for %s (1 to %d)\n", arg, MAX_CORES);
+            return -1;
+        }
+        cfg->cores = n;
+    } else if (strcmp(arg, "--quantum") == 0) {
+        long n = (*index + 1 < argc) ? atol(argv[++*index]) : 0;
+        if (n < 1) {
+            fprintf(stderr, "Invalid or missing cycle count for %s (at least 1)\n", arg);
+            return -1;
+        }
+        cfg->quantum = n;
+    } else if (strcmp(arg, "--record") == 0) {
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        cfg->record_file = argv[++*index];
+    } else if (strcmp(arg, "--trace") == 0) {
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        cfg->trace_file = argv[++*index];
+    } else if (strcmp(arg, "--stats") == 0) {
+        cfg->stats = 1;
+    } else if (strcmp(arg, "--stats-json") == 0 || strcmp(arg, "--stats-csv") == 0) {
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        if (arg[8] == 'j') {
+            cfg->stats_json = argv[++*index];
+        } else {
+            cfg->stats_csv = argv[++*index];
+        }
+    } else if (strcmp(arg, "--checkpoint") == 0 || strcmp(arg, "--restore") == 0) {
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        if (arg[2] == 'c') {
+            cfg->checkpoint_file = argv[++*index];
+        } else {
+            cfg->restore_file = argv[++*index];
+        }
+    } else if (strcmp(arg, "--checkpoint-at") == 0) {
+        if (*index + 1 >= argc ||
+            checkpoint_parse_trigger(argv[++*index], &cfg->checkpoint_trigger, &cfg->checkpoint_at) < 0) {
+            fprintf(stderr, "Invalid or missing trigger for %s (expected cycle:N, inst:N or pc:ADDR)\n", arg);
+            return -1;
+        }
+    } else if (strcmp(arg, "--sample") == 0) {
+        if (*index + 1 >= argc ||
+            sample_parse(argv[++*index], &cfg->sample_size, &cfg->sample_interval, &cfg->sample_warmup) < 0) {
+            fprintf(stderr, "Invalid or missing value for %s (expected N:M[:W] with M >= N + W)\n", arg);
+            return -1;
+        }
+    } else if (strcmp(arg, "--text-base") == 0) {
+        if (*index + 1 >= argc || parse_address(argv[++*index], &cfg->text_base) < 0) {
+            fprintf(stderr, "Invalid or missing address for %s\n", arg);
+            return -1;
+        }
+    } else if (strcmp(arg, "--data") == 0) {
+        // --data <file>[@address]
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        if (cfg->num_data == MAX_DATA_IMAGES) {
+            fprintf(stderr, "Too many data images (max %d)\n", MAX_DATA_IMAGES);
+            return -1;
+        }
+        char *spec = argv[++*index];
+        char *at = strrchr(spec, '@');
+        uint32_t address = 0;
+        if (at) {
+            *at = '\0';
+            if (parse_address(at + 1, &address) < 0) {
+                fprintf(stderr, "Invalid data image address: %s\n", at + 1);
+                return -1;
+            }
+        }
+        cfg->data[cfg->num_data].file = spec;
+        cfg->data[cfg->num_data].address = address;
+        cfg->num_data++;
+    } else if (strcmp(arg, "--dump-regs") == 0) {
+        cfg->dump_regs = 1;
+    } else if (strcmp(arg, "--dump-mem") == 0) {
+        if (cfg->num_dumps == MAX_DUMP_RANGES) {
+            fprintf(stderr, "Too many memory ranges (max %d)\n", MAX_DUMP_RANGES);
+            return -1;
+        }
+        if (*index + 1 >= argc || dump_parse_range(argv[++*index], &cfg->dumps[cfg->num_dumps].address,
+                                                   &cfg->dumps[cfg->num_dumps].length) < 0) {
+            fprintf(stderr, "Invalid or missing range for %s (expected ADDR:LENGTH in bytes)\n", arg);
+            return -1;
+        }
+        cfg->num_dumps++;
+    } else if (strcmp(arg, "--dump-format") == 0) {
+        int format = (*index + 1 < argc) ? dump_parse_format(argv[++*index]) : -1;
+        if (format < 0) {
+            fprintf(stderr, "Invalid or missing format for %s (hex, csv, bin or hash)\n", arg);
+            return -1;
+        }
+        cfg->dump_format = format;
+    } else if (strcmp(arg, "--dump-file") == 0 || strcmp(arg, "--verify") == 0) {
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return -1;
+        }
+        if (arg[2] == 'd') {
+            cfg->dump_file = argv[++*index];
+        } else {
+            cfg->verify_file = argv[++*index];
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void options_usage(FILE *out) {
+    fprintf(out, "  --functional   run the predecoded program without the pipeline model\n");
+    fprintf(out, "  --no-jit       functional runs: interpret instead of translating to host code\n");
+    fprintf(out, "  --forwarding   enable EX/MEM and MEM/WB forwarding (stall only on load-use)\n");
+    fprintf(out, "  --extrapolate  skip repeating loop iterations functionally, adding their measured cycles\n");
+    fprintf(out, "  --dual-issue   2-wide in-order pipeline (one load/store and one branch per pair)\n");
+    fprintf(out, "  --ooo          out-of-order core (Tomasulo, reorder buffer, load/store queue)\n");
+    fprintf(out, "  --rob <n>             --ooo: reorder buffer entries (default %d)\n", OOO_ROB_SIZE);
+    fprintf(out, "  --ooo-width <n>       --ooo: fetch, dispatch and commit width (default %d)\n", OOO_WIDTH);
+    fprintf(out, "  --units <A:M:D>       --ooo: ALU, memory and mul/div units (default %d:%d:%d)\n",
+            OOO_ALU_UNITS, OOO_MEM_UNITS, OOO_MULDIV_UNITS);
+    fprintf(out, "  --rs-size <n>         --ooo: reservation stations per unit class (default %d)\n",
+            OOO_RS_SIZE);
+    fprintf(out, "  --lsq <n>             --ooo: load/store queue entries (default %d)\n", OOO_LSQ_SIZE);
+    fprintf(out, "  --cores <n>           cores sharing memory with coherent L1s (needs --dcache; $k0 = core id)\n");
+    fprintf(out, "  --quantum <n>         --cores: cycles between core synchronizations (default %d)\n", MC_QUANTUM);
+    fprintf(out, "  --bp <policy>  branch predictor: not-taken (default), 1bit, 2bit, gshare\n");
+    fprintf(out, "  --icache <S:A:L>      instruction cache: size bytes (K suffix), ways, line bytes\n");
+    fprintf(out, "  --dcache <S:A:L>      data cache geometry (default: ideal memory)\n");
+    fprintf(out, "  --cache-repl <p>      cache replacement: lru (default), random\n");
+    fprintf(out, "  --cache-write <p>     back (write-back, write-allocate; default) or through\n");
+    fprintf(out, "  --miss-latency <n>    cycles added by a cache miss (default 10)\n");
+    fprintf(out, "  --mult-latency <n>    cycles until a MULT/MULTU result can be read (default %d)\n",
+            MULT_LATENCY);
+    fprintf(out, "  --div-latency <n>     cycles until a DIV/DIVU result can be read (default %d)\n",
+            DIV_LATENCY);
+    fprintf(out, "  --trace <file>        record a binary per-cycle pipeline trace (view with simtrace)\n");
+    fprintf(out, "  --record <file>       functional runs: record a committed-instruction trace for --replay\n");
+    fprintf(out, "  --stats               print CPI, stall breakdown, instruction mix and hotspots\n");
+    fprintf(out, "  --stats-json <file>   write all performance counters as JSON\n");
+    fprintf(out, "  --stats-csv <file>    write per-PC execution and stall counts as CSV\n");
+    fprintf(out, "  --checkpoint <file>   save a snapshot of the run when --checkpoint-at fires\n");
+    fprintf(out, "  --checkpoint-at <t>   cycle:N, inst:N (completed instructions) or pc:ADDR (completes)\n");
+    fprintf(out, "  --restore <file>      start from a snapshot instead of loading a program\n");
+    fprintf(out, "  --sample <N:M[:W]>    fast-forward functionally, measure N of every M instructions\n");
+    fprintf(out, "                        on the pipeline after W warmup instructions (default W = N)\n");
+    fprintf(out, "  --text-base <addr>    load address of a raw program image (default 0)\n");
+    fprintf(out, "  --data <file>[@addr]  load a raw data segment image (default address 0)\n");
+    fprintf(out, "  --dump-regs           after the run, dump $0-$31, HI and LO\n");
+    fprintf(out, "  --dump-mem <a:len>    after the run, dump len bytes of memory from address a (repeatable)\n");
+    fprintf(out, "  --dump-format <f>     hex (default), csv, bin (raw state image) or hash\n");
+    fprintf(out, "  --dump-file <file>    write the dump to a file instead of the report\n");
+    fprintf(out, "  --verify <golden>     compare the dumped state with a bin image or a 0x<hash>\n");
+    fprintf(out, "                        (--cores, --lanes: dumped per core or lane, verified as one image)\n");
+}
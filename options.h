@@ -0,0 +1,18 @@
+/**
+ * options.h - Command-line options shared by single runs and batch jobs.
+ */
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdio.h>
+#include "sim.h"
+
+// Try to parse the simulation option at argv[*index] into cfg, advancing
+// *index past any option argument. Returns 1 if the option was consumed,
+// 0 if argv[*index] is not a simulation option, -1 on an invalid value.
+int options_parse_one(int argc, char *argv[], int *index, SimConfig_t *cfg);
+
+// Print the list of simulation options.
+void options_usage(FILE *out);
+
+#endif // OPTIONS_H
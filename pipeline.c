@@ -0,0 +1,480 @@
+/**
+ * pipeline.c - Cycle-by-cycle 5-stage pipeline simulation (stall or forwarding hazard resolution).
+ */
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "hazard.h"
+#include "alu.h"
+#include "decode.h"
+#include "branch.h"
+#include "cache.h"
+#include "trace.h"
+#include "stats.h"
+#include "checkpoint.h"
+#include "syscall.h"
+#include "sim.h"
+#include "pipeline.h"
+#include "dual.h"
+#include "multicore.h"
+#include "steady.h"
+#include "hostprof.h"
+
+void pipeline_reset(Pipeline_t *p, uint32_t pc) {
+    memset(p, 0, sizeof(*p));
+    p->PC = pc;
+    p->fetch_enable = 1;
+}
+
+// Append the end-of-cycle pipeline register contents to the trace
+static void trace_state(struct Sim *sim, uint8_t events, uint8_t wb_reg, int32_t wb_val) {
+    const Pipeline_t *p = &sim->pipe;
+    uint32_t pc[4] = { p->IFID.pc, p->IDEX.pc, p->EXMEM.pc, p->MEMWB.pc };
+    uint8_t flags = events | (p->IFID.valid ? 1 : 0) | (p->IDEX.valid ? 2 : 0) |
+                    (p->EXMEM.valid ? 4 : 0) | (p->MEMWB.valid ? 8 : 0);
+    trace_cycle(sim->trace, pc, flags, wb_reg, wb_val);
+}
+
+// Cycles from now in which nothing but countdowns (multiply/divide unit, cache
+// miss waits) can change: a data cache freeze, an instruction stalled in ID on
+// the multiply/divide unit behind an empty pipeline, or fetch waiting for an
+// instruction cache miss with nothing in flight. 0 if the next cycle may do
+// anything else, or if each cycle has to be seen (trace, counters).
+static inline long idle_cycles(const struct Sim *sim, const int observed) {
+    const Pipeline_t *p = &sim->pipe;
+    long n = 0;
+    if (observed && (sim->trace || sim->stats.pc_exec)) {
+        return 0;
+    }
+    if (observed && p->mem_stall > 0) {
+        n = p->mem_stall;
+    } else if (!p->IDEX.valid && !p->EXMEM.valid && !p->MEMWB.valid) {
+        // Fetch must not start a new cache lookup or find the end of the program
+        if (p->fetch_enable && (!p->fetch_ready ||
+                                (p->PC - sim->arch.text_base) / 4 >= (uint32_t)sim->arch.instr_count)) {
+            return 0;
+        }
+        if (p->IFID.valid) {
+            // ID stalls while the unit is still busy after the cycle's countdown
+            const DecodedInst_t *d = &sim->decoded[(p->IFID.pc - sim->arch.text_base) / 4];
+            if ((d->muldiv || d->hilo) && p->md_busy > 1) {
+                n = p->md_busy - 1;
+            }
+        } else if (p->fetch_enable) {
+            n = p->fetch_wait;
+        }
+    }
+    // A cycle-triggered checkpoint must see the cycle it names
+    if (n > 0 && sim->config.checkpoint_file && !sim->checkpointed &&
+        sim->config.checkpoint_trigger == CKPT_CYCLE) {
+        long left = (long)sim->config.checkpoint_at - sim->cycle;
+        n = left < n ? left : n;
+    }
+    // Nor may a multicore core run past the end of its quantum
+    if (observed && n > 0 && sim->cycle_limit) {
+        long left = sim->cycle_limit - sim->cycle;
+        n = left < n ? left : n;
+    }
+    return n;
+}
+
+// Advance n idle cycles (see idle_cycles) at once
+static inline void skip_cycles(struct Sim *sim, long n) {
+    Pipeline_t *p = &sim->pipe;
+    sim->cycle += n;
+    p->md_busy = p->md_busy > n ? p->md_busy - (int)n : 0;
+    if (p->mem_stall > 0) {
+        p->mem_stall -= (int)n;
+        sim->dcache_stall_cycles += n;
+    } else if (p->fetch_enable) {
+        long wait = p->fetch_wait < n ? p->fetch_wait : n;
+        p->fetch_wait -= (int)wait;
+        sim->icache_stall_cycles += wait;
+    }
+}
+
+// One cycle of the single-issue pipeline. The flags are compile-time constants
+// in each variant, so a configuration only pays for the features it uses:
+//   forwarding - EX/MEM and MEM/WB forwarding instead of stall-only
+//   predict    - a dynamic branch predictor (otherwise static not-taken)
+//   observed   - caches, a multicore bus, trace, counters or the loop detector
+static ALWAYS_INLINE int pipeline_cycle(struct Sim *sim, const int forwarding, const int predict,
+                                        const int observed) {
+    Pipeline_t *p = &sim->pipe;
+    HP_CYCLE_BEGIN();
+    // Idle periods pass in a single step
+    long idle = idle_cycles(sim, observed);
+    if (idle > 0) {
+        skip_cycles(sim, idle);
+        HP_STAGE(HP_STAGE_IDLE);
+        return 1;
+    }
+    sim->cycle++;
+    // The multiply/divide unit keeps working through every kind of stall
+    if (p->md_busy > 0) {
+        p->md_busy--;
+    }
+    // A data cache miss freezes the whole pipeline until the line arrives
+    if (observed && p->mem_stall > 0) {
+        p->mem_stall--;
+        sim->dcache_stall_cycles++;
+        if (sim->trace) {
+            trace_state(sim, TRACE_EV_DFREEZE, 0, 0);
+        }
+        HP_STAGE(HP_STAGE_IDLE);
+        return 1;
+    }
+    // Write-Back stage (WB) - write result to register file
+    uint8_t wb_reg = 0;
+    if (p->MEMWB.valid && p->MEMWB.regWrite) {
+        reg_write(&sim->arch, p->MEMWB.destReg, p->MEMWB.write_val);
+        wb_reg = p->MEMWB.destReg;
+    }
+    HP_STAGE(HP_STAGE_WB);
+    // Check termination: if no new fetch and pipeline is empty, break
+    if (!p->fetch_enable && !p->IFID.valid && !p->IDEX.valid && !p->EXMEM.valid && !p->MEMWB.valid) {
+        if (observed && sim->trace) {
+            trace_state(sim, 0, 0, 0);
+        }
+        return 0;
+    }
+    // Memory stage (MEM) - access data memory for load or store
+    // Prepare new MEM/WB pipeline register
+    MEMWB_t MEMWB_new = {0};
+    MEMWB_new.instr = p->EXMEM.instr;
+    MEMWB_new.pc = p->EXMEM.pc;
+    MEMWB_new.valid = p->EXMEM.valid;
+    MEMWB_new.destReg = p->EXMEM.destReg;
+    MEMWB_new.regWrite = p->EXMEM.regWrite;
+    if (p->EXMEM.valid) {
+        uint32_t address = (uint32_t)p->EXMEM.alu_result;
+        int32_t value = p->EXMEM.store_val;
+        int accessed = 0;
+        if (observed && (p->EXMEM.memRead || p->EXMEM.memWrite)) {
+            if (sim->core) {
+                // Other cores' caches take part in the access of a multicore
+                // system, which moves the data too (except for an SC)
+                p->mem_stall = mc_access(sim->core, address, p->EXMEM.memWrite, p->EXMEM.llsc,
+                                         p->EXMEM.memSize, p->EXMEM.memSigned, &value);
+                accessed = (p->EXMEM.llsc != LLSC_SC);
+            } else {
+                p->mem_stall = cache_access(&sim->dcache, address, p->EXMEM.memWrite);
+            }
+        }
+        if (p->EXMEM.llsc == LLSC_SC) {
+            // Store-conditional: rt receives whether the store happened
+            MEMWB_new.write_val = mc_store_conditional(sim, address, p->EXMEM.store_val);
+        } else if (p->EXMEM.memRead) {
+            // Load from data memory
+            MEMWB_new.write_val = accessed ? value
+                                           : mem_read_sized(&sim->arch, address, p->EXMEM.memSize,
+                                                            p->EXMEM.memSigned);
+        } else {
+            MEMWB_new.write_val = p->EXMEM.alu_result;
+        }
+        if (p->EXMEM.memWrite && p->EXMEM.llsc != LLSC_SC && !accessed) {
+            // Store to data memory
+            mem_write_sized(&sim->arch, address, p->EXMEM.memSize, p->EXMEM.store_val);
+        }
+    }
+    HP_STAGE(HP_STAGE_MEM);
+    // Execute stage (EX) - perform ALU operations, branch decisions
+    // Prepare new EX/MEM pipeline register
+    EXMEM_t EXMEM_new = {0};
+    EXMEM_new.instr = p->IDEX.instr;
+    EXMEM_new.pc = p->IDEX.pc;
+    EXMEM_new.valid = p->IDEX.valid;
+    EXMEM_new.destReg = p->IDEX.destReg;
+    EXMEM_new.regWrite = p->IDEX.regWrite;
+    EXMEM_new.memRead = p->IDEX.memRead;
+    EXMEM_new.memWrite = p->IDEX.memWrite;
+    EXMEM_new.memSize = p->IDEX.memSize;
+    EXMEM_new.memSigned = p->IDEX.memSigned;
+    EXMEM_new.llsc = p->IDEX.llsc;
+    int branch_taken = 0;
+    uint32_t branch_target = 0;
+    int mispredict = 0;
+    int exited = 0;
+    uint32_t redirect_pc = 0;
+    if (p->IDEX.valid && forwarding) {
+        // Forwarding unit: replace operands read in ID with newer in-flight results
+        int fwdA = hazard_forward_select(p->IDEX.rs, p->EXMEM.valid && p->EXMEM.regWrite, p->EXMEM.destReg,
+                                         p->EXMEM.memRead, p->MEMWB.valid && p->MEMWB.regWrite,
+                                         p->MEMWB.destReg);
+        int fwdB = hazard_forward_select(p->IDEX.rt, p->EXMEM.valid && p->EXMEM.regWrite, p->EXMEM.destReg,
+                                         p->EXMEM.memRead, p->MEMWB.valid && p->MEMWB.regWrite,
+                                         p->MEMWB.destReg);
+        if (fwdA == FWD_EXMEM) {
+            p->IDEX.rs_val = p->EXMEM.alu_result;
+        } else if (fwdA == FWD_MEMWB) {
+            p->IDEX.rs_val = p->MEMWB.write_val;
+        }
+        if (fwdB == FWD_EXMEM) {
+            p->IDEX.rt_val = p->EXMEM.alu_result;
+        } else if (fwdB == FWD_MEMWB) {
+            p->IDEX.rt_val = p->MEMWB.write_val;
+        }
+    }
+    if (p->IDEX.valid) {
+        if (p->IDEX.jump) {
+            // Unconditional jump (J or JR)
+            branch_taken = 1;
+            if (p->IDEX.jump == 1) {
+                // J: target = (upper PC bits | imm<<2), computed at decode
+                branch_target = p->IDEX.target;
+            } else if (p->IDEX.jump == 2) {
+                // JR: target = value in rs (rs_val holds it)
+                branch_target = (uint32_t)p->IDEX.rs_val;
+            }
+            // JAL links the return address through the normal result path
+            if (p->IDEX.regWrite) {
+                EXMEM_new.alu_result = (int32_t)(p->IDEX.pc + 4);
+            }
+        } else if (p->IDEX.branch) {
+            // Branch instruction
+            // Branch target (PC of this instr + 4 + (imm << 2)) was computed at decode
+            branch_target = p->IDEX.target;
+            // Compare registers for branch condition
+            int equal = (p->IDEX.rs_val == p->IDEX.rt_val);
+            if ((p->IDEX.branch == 1 && equal) || (p->IDEX.branch == 2 && !equal)) {
+                branch_taken = 1;
+            }
+            // No register result to write for branch
+        }
+        // ALU operation (only if not a jump)
+        if (!p->IDEX.jump) {
+            // I-type (ADDI, LW, SW) and shifts use imm as second operand
+            // (shift amount for SLL/SRL, whose rs_val holds the rt value)
+            int32_t opA = p->IDEX.rs_val;
+            int32_t opB = p->IDEX.useImm ? p->IDEX.imm : p->IDEX.rt_val;
+            EXMEM_new.alu_result = alu_execute(p->IDEX.ALUop, opA, opB);
+        }
+        // Multiply/divide: HI/LO are written now and readers wait for the
+        // unit's latency (the instruction cannot be squashed past EX)
+        if (p->IDEX.muldiv) {
+            alu_muldiv(p->IDEX.muldiv, p->IDEX.rs_val, p->IDEX.rt_val, &sim->arch.hi, &sim->arch.lo);
+            int latency = (p->IDEX.muldiv <= MD_MULTU) ? sim->config.mult_latency : sim->config.div_latency;
+            p->md_busy = latency - 1;
+            p->md_pc = p->IDEX.pc;
+        }
+        // System calls run here, where the instruction can no longer be
+        // squashed; older stores have already reached memory
+        if (p->IDEX.syscall) {
+            exited = syscall_exec(sim, p->IDEX.pc, p->IDEX.rs_val, p->IDEX.rt_val, &EXMEM_new.alu_result);
+        }
+        // So do invalid instructions, which end the program with an error
+        if (p->IDEX.invalid) {
+            exited = sim_invalid(sim, p->IDEX.pc, p->IDEX.instr);
+        }
+        // For store, pass the value to write
+        if (p->IDEX.memWrite) {
+            EXMEM_new.store_val = p->IDEX.rt_val;
+        }
+        // Check the path fetched after this instruction against the resolved one
+        if (p->IDEX.jump || p->IDEX.branch) {
+            uint32_t actual_next = branch_taken ? branch_target : p->IDEX.pc + 4;
+            uint32_t predicted_next = p->IDEX.pred_taken ? p->IDEX.pred_target : p->IDEX.pc + 4;
+            mispredict = (actual_next != predicted_next);
+            redirect_pc = actual_next;
+            bp_update(&sim->bp, p->IDEX.pc, p->IDEX.jump != 0, branch_taken, branch_target, mispredict);
+        }
+    }
+    // On a misprediction, flush the wrong-path instructions in IFID and IDEX
+    if (mispredict) {
+        // Override PC to the resolved path; fetch resumes there this cycle
+        p->PC = redirect_pc;
+        p->fetch_enable = !p->draining;
+        // Abandon any instruction cache miss on the wrong path
+        p->fetch_wait = 0;
+        p->fetch_ready = 0;
+        p->IFID = (IFID_t){0};
+        p->IDEX = (IDEX_t){0};
+    }
+    // On exit, squash everything younger and stop fetching; the older
+    // instructions and the syscall itself drain normally
+    if (exited) {
+        p->PC = sim->arch.text_base + (uint32_t)sim->arch.instr_count * 4;
+        p->fetch_enable = 0;
+        p->fetch_wait = 0;
+        p->fetch_ready = 0;
+        p->IFID = (IFID_t){0};
+        p->IDEX = (IDEX_t){0};
+    }
+    HP_STAGE(HP_STAGE_EX);
+    // Instruction Decode stage (ID) - decode IF/ID and read registers
+    // Prepare new ID/EX pipeline register
+    IDEX_t IDEX_new = {0};
+    if (p->IFID.valid) {
+        // Control signals come from the table decoded once at load time
+        const DecodedInst_t *d = &sim->decoded[(p->IFID.pc - sim->arch.text_base) / 4];
+        IDEX_new.instr = p->IFID.instr;
+        IDEX_new.pc = p->IFID.pc;
+        IDEX_new.valid = 1;
+        IDEX_new.rs = d->srcA;
+        IDEX_new.rt = d->srcB;
+        IDEX_new.rd = RD(p->IFID.instr);
+        IDEX_new.imm = d->imm;
+        IDEX_new.target = d->target;
+        IDEX_new.useImm = d->useImm;
+        IDEX_new.destReg = d->destReg;
+        IDEX_new.regWrite = d->regWrite;
+        IDEX_new.memRead = d->memRead;
+        IDEX_new.memWrite = d->memWrite;
+        IDEX_new.ALUop = d->ALUop;
+        IDEX_new.branch = d->branch;
+        IDEX_new.jump = d->jump;
+        IDEX_new.memSize = d->memSize;
+        IDEX_new.memSigned = d->memSigned;
+        IDEX_new.llsc = d->llsc;
+        IDEX_new.muldiv = d->muldiv;
+        IDEX_new.syscall = d->syscall;
+        IDEX_new.invalid = d->invalid;
+        IDEX_new.pred_taken = p->IFID.pred_taken;
+        IDEX_new.pred_target = p->IFID.pred_target;
+        // Read register values
+        IDEX_new.rs_val = reg_read(&sim->arch, d->srcA);
+        IDEX_new.rt_val = reg_read(&sim->arch, d->srcB);
+        if (d->hilo) {
+            // MFHI/MFLO: HI/LO is ready (checked by hazard detection)
+            IDEX_new.rs_val = (d->hilo == 1) ? sim->arch.hi : sim->arch.lo;
+        }
+    }
+    HP_STAGE(HP_STAGE_ID);
+    // Instruction Fetch stage (IF) - fetch next instruction from instruction memory
+    // Prepare new IF/ID pipeline register
+    IFID_t IFID_new = {0};
+    IFID_new.valid = 0;
+    IFID_new.instr = 0;
+    IFID_new.pc = p->PC;
+    uint32_t next_pc = p->PC;
+    int fetch_waiting = 0;
+    if (p->fetch_enable) {
+        uint32_t index = (p->PC - sim->arch.text_base) / 4;
+        if (index < (uint32_t)sim->arch.instr_count) {
+            // Instruction cache lookup, once per fetch address; a miss delivers
+            // the instruction miss-latency cycles later
+            if (!p->fetch_ready) {
+                p->fetch_wait = observed ? cache_access(&sim->icache, p->PC, 0) : 0;
+                p->fetch_ready = 1;
+            }
+            if (p->fetch_wait > 0) {
+                p->fetch_wait--;
+                sim->icache_stall_cycles++;
+                fetch_waiting = 1;
+            } else {
+                IFID_new.instr = instr_read(&sim->arch, index);
+                IFID_new.pc = p->PC;
+                IFID_new.valid = 1;
+                p->fetch_ready = 0;
+                // Fetch down the predicted path
+                if (predict) {
+                    IFID_new.pred_taken = (uint8_t)bp_predict(&sim->bp, p->PC, &IFID_new.pred_target);
+                }
+                next_pc = IFID_new.pred_taken ? IFID_new.pred_target : p->PC + 4;
+            }
+        } else {
+            // No more instructions to fetch
+            p->fetch_enable = 0;
+        }
+    }
+    HP_STAGE(HP_STAGE_IF);
+    // Hazard detection for data hazards (all RAW without forwarding, load-use with it)
+    int stall = 0;
+    if (p->IFID.valid) {
+        const DecodedInst_t *d = &sim->decoded[(p->IFID.pc - sim->arch.text_base) / 4];
+        stall = hazard_detect_data(p->IDEX.regWrite, p->EXMEM.regWrite,
+                                   p->IDEX.destReg, p->EXMEM.destReg,
+                                   d->srcA, d->srcB,
+                                   p->IDEX.memRead, forwarding);
+        if (!stall) {
+            stall = hazard_detect_muldiv(d->muldiv || d->hilo, p->md_busy);
+        }
+        if (observed && stall && sim->stats.pc_exec) {
+            uint32_t producer = (stall == HAZARD_IDEX) ? p->IDEX.pc
+                              : (stall == HAZARD_EXMEM) ? p->EXMEM.pc : p->md_pc;
+            stats_stall(&sim->stats, stall, p->IFID.pc, producer);
+        }
+    }
+    HP_STAGE(HP_STAGE_HAZARD);
+    // Update pipeline registers with consideration for stall
+    // (a flush already emptied IFID/IDEX, so IDEX_new is a bubble then)
+    if (stall) {
+        // Stall: keep IFID the same (don't advance), insert bubble in IDEX
+        p->IDEX = (IDEX_t){0}; // bubble in EX stage
+        // Do not update IFID (remain the same instruction for next cycle)
+        // Cancel the fetched instruction (as if we didn't fetch this cycle);
+        // PC still points just past IFID and is not advanced below
+        if (IFID_new.valid) {
+            p->fetch_ready = 1; // the line is still there when fetch retries
+        }
+        IFID_new.valid = 0;
+    } else {
+        // Normal flow: transfer IFID_new to IFID, and IDEX_new to IDEX
+        p->IDEX = IDEX_new;
+        p->IFID = IFID_new;
+        // Advance PC along the predicted path
+        p->PC = next_pc;
+    }
+    // Update EXMEM and MEMWB to the new values (older pipeline stages progress)
+    int32_t wb_val = p->MEMWB.write_val;
+    p->EXMEM = EXMEM_new;
+    p->MEMWB = MEMWB_new;
+    // Count instruction in WB stage if it was a real instruction (exclude bubbles)
+    if (p->MEMWB.valid && p->MEMWB.instr != 0) {
+        sim->instructions++;
+    }
+    HP_STAGE(HP_STAGE_LATCH);
+    if (!observed) {
+        return 1;
+    }
+    // Steady-state loops continue on the functional path (--extrapolate)
+    if (sim->steady) {
+        steady_cycle(sim);
+    }
+    if (sim->stats.pc_exec) {
+        stats_cycle(&sim->stats, sim);
+    }
+    if (sim->trace) {
+        uint8_t events = (stall ? TRACE_EV_STALL : 0) | (mispredict ? TRACE_EV_FLUSH : 0) |
+                         (fetch_waiting ? TRACE_EV_IWAIT : 0);
+        trace_state(sim, events, wb_reg, wb_reg ? wb_val : 0);
+    }
+    HP_STAGE(HP_STAGE_OBSERVE);
+    return 1;
+}
+
+// The specialized engines, one per feature combination
+#define PIPELINE_VARIANT(name, forwarding, predict, observed) \
+    static int name(struct Sim *sim) { \
+        return pipeline_cycle(sim, forwarding, predict, observed); \
+    }
+
+PIPELINE_VARIANT(step_stall, 0, 0, 0)
+PIPELINE_VARIANT(step_stall_predict, 0, 1, 0)
+PIPELINE_VARIANT(step_stall_observed, 0, 0, 1)
+PIPELINE_VARIANT(step_stall_predict_observed, 0, 1, 1)
+PIPELINE_VARIANT(step_forward, 1, 0, 0)
+PIPELINE_VARIANT(step_forward_predict, 1, 1, 0)
+PIPELINE_VARIANT(step_forward_observed, 1, 0, 1)
+PIPELINE_VARIANT(step_forward_predict_observed, 1, 1, 1)
+
+// Indexed by [forwarding][predict][observed]
+static PipelineEngine_t *const variants[2][2][2] = {
+    { { step_stall, step_stall_observed }, { step_stall_predict, step_stall_predict_observed } },
+    { { step_forward, step_forward_observed }, { step_forward_predict, step_forward_predict_observed } }
+};
+
+PipelineEngine_t *pipeline_select(const struct Sim *sim) {
+    if (sim->config.dual_issue) {
+        return dual_step;
+    }
+    const SimConfig_t *c = &sim->config;
+    // (a restored pipeline may still be waiting for a cache miss)
+    int observed = sim->icache.lines || sim->dcache.lines || sim->core || sim->trace ||
+                   sim->stats.pc_exec || sim->steady || sim->pipe.mem_stall || sim->pipe.fetch_wait;
+    return variants[c->forwarding != 0][c->bp_policy != BP_NOT_TAKEN][observed != 0];
+}
+
+int pipeline_step(struct Sim *sim) {
+    return sim->engine(sim);
+}
@@ -0,0 +1,126 @@
+/**
+ * pipeline.h - 5-stage pipeline model (IF/ID/EX/MEM/WB) and its pipeline registers.
+ */
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+
+// Pipeline register structures
+typedef struct {
+    uint8_t valid;
+    uint32_t instr;
+    uint32_t pc;
+    uint8_t pred_taken;   // fetch continued at pred_target instead of pc + 4
+    uint32_t pred_target;
+} IFID_t;
+
+typedef struct {
+    uint8_t valid;
+    uint32_t instr;
+    uint32_t pc;
+    uint8_t rs, rt, rd;   // rs/rt are the registers feeding rs_val/rt_val
+    int32_t rs_val, rt_val;
+    int32_t imm;       // sign-extended immediate or shift amount
+    uint32_t target;   // precomputed branch/jump target
+    uint8_t useImm;    // second ALU operand is imm rather than rt_val
+    uint8_t destReg;
+    uint8_t regWrite;
+    uint8_t memRead;
+    uint8_t memWrite;
+    uint8_t ALUop;
+    uint8_t branch; // 1 for beq, 2 for bne
+    uint8_t jump;   // 1 for J/JAL, 2 for JR
+    uint8_t memSize;
+    uint8_t memSigned;
+    uint8_t llsc;   // LlscOp of LL/SC
+    uint8_t muldiv; // MulDivOps handed to the multiply/divide unit
+    uint8_t syscall;
+    uint8_t invalid;  // stops the run in EX (KIND_INVALID)
+    uint8_t pred_taken;
+    uint32_t pred_target;
+} IDEX_t;
+
+typedef struct {
+    uint8_t valid;
+    uint32_t instr;
+    uint32_t pc;
+    int32_t alu_result;
+    int32_t store_val;
+    uint8_t destReg;
+    uint8_t regWrite;
+    uint8_t memRead;
+    uint8_t memWrite;
+    uint8_t memSize;
+    uint8_t memSigned;
+    uint8_t llsc;
+} EXMEM_t;
+
+typedef struct {
+    uint8_t valid;
+    uint32_t instr;
+    uint32_t pc;
+    int32_t write_val;
+    uint8_t destReg;
+    uint8_t regWrite;
+} MEMWB_t;
+
+// Why ID issued a single instruction in dual-issue mode
+enum IssueSplit {
+    SPLIT_NONE = 0,
+    SPLIT_ALONE,        /* only one instruction was in IF/ID */
+    SPLIT_MEM,          /* both are loads/stores */
+    SPLIT_BRANCH,       /* both are branches/jumps */
+    SPLIT_RAW,          /* the younger one reads the older one's result */
+    SPLIT_MULDIV,       /* both use the multiply/divide unit */
+    SPLIT_SYSCALL,      /* SYSCALL always issues alone */
+    SPLIT_STALL,        /* the younger one waits for an older producer */
+    SPLIT_COUNT
+};
+
+// Issue counters of the dual-issue mode
+typedef struct {
+    long issue_cycles;      // cycles in which ID issued at least one instruction
+    long dual_issues;       // ... of which it issued two
+    long split[SPLIT_COUNT];    // single-issue cycles by IssueSplit reason
+} IssueStats_t;
+
+// Complete pipeline state: the four pipeline registers plus fetch state. In
+// dual-issue mode each register has a second, younger slot (IFID2...).
+typedef struct {
+    IFID_t IFID;
+    IDEX_t IDEX;
+    EXMEM_t EXMEM;
+    MEMWB_t MEMWB;
+    IFID_t IFID2;
+    IDEX_t IDEX2;
+    EXMEM_t EXMEM2;
+    MEMWB_t MEMWB2;
+    uint32_t PC;
+    uint8_t fetch_enable;
+    uint8_t fetch_ready;    // instruction cache already looked up for PC
+    int fetch_wait;         // cycles until a missed instruction fetch completes
+    int mem_stall;          // cycles the pipeline stays frozen on a data cache miss
+    uint8_t draining;       // fetch stopped to empty the pipeline; PC is where to resume
+    int md_busy;            // cycles until the multiply/divide unit has HI/LO ready
+    uint32_t md_pc;         // multiply/divide occupying the unit
+} Pipeline_t;
+
+struct Sim;
+
+// Empty the pipeline and start fetching at pc.
+void pipeline_reset(Pipeline_t *p, uint32_t pc);
+
+// Cycle function of a pipeline engine: simulate one clock cycle. Returns 0
+// once the pipeline has drained with no more instructions to fetch, 1 otherwise.
+typedef int PipelineEngine_t(struct Sim *sim);
+
+// Pick the engine for the simulation's configuration: the dual-issue pipeline
+// or the single-issue variant specialized for its forwarding, predictor and
+// instrumentation. Call again after any of them changes.
+PipelineEngine_t *pipeline_select(const struct Sim *sim);
+
+// Simulate one clock cycle with the selected engine.
+int pipeline_step(struct Sim *sim);
+
+#endif // PIPELINE_H
@@ -0,0 +1,600 @@
+/**
+ * replay.c - Committed-instruction trace writer and the timing-only pipeline
+ * model that replays a trace against many configurations in parallel.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "config.h"
+#include "util.h"
+#include "decode.h"
+#include "hazard.h"
+#include "branch.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "sim.h"
+#include "options.h"
+#include "replay.h"
+
+#define MAX_CONFIG_ARGS 64
+
+Recorder_t *recorder_open(const char *filename, const ArchState_t *st, long instructions) {
+    Recorder_t *rec = calloc(1, sizeof(Recorder_t));
+    if (rec) {
+        rec->buf = malloc(REPLAY_BUFFER_EVENTS * sizeof(uint32_t));
+    }
+    if (!rec || !rec->buf) {
+        fprintf(stderr, "Failed to allocate replay trace buffer\n");
+        recorder_close(rec, 0);
+        return NULL;
+    }
+    rec->filename = filename;
+    rec->first_instructions = instructions;
+    memcpy(rec->header.magic, REPLAY_MAGIC, sizeof(rec->header.magic));
+    rec->header.version = REPLAY_VERSION;
+    rec->header.text_base = st->text_base;
+    rec->header.entry = st->pc;
+    rec->header.instr_count = (uint32_t)st->instr_count;
+    rec->file = fopen(filename, "wb");
+    if (!rec->file) {
+        fprintf(stderr, "Failed to open replay trace: %s\n", filename);
+        recorder_close(rec, 0);
+        return NULL;
+    }
+    // The header is written again with the final counts on close
+    if (fwrite(&rec->header, sizeof(rec->header), 1, rec->file) != 1) {
+        rec->error = 1;
+    }
+    for (int i = 0; i < st->instr_count; ++i) {
+        uint32_t word = instr_read(st, i);
+        if (fwrite(&word, sizeof(word), 1, rec->file) != 1) {
+            rec->error = 1;
+        }
+    }
+    return rec;
+}
+
+void recorder_flush(Recorder_t *rec) {
+    if (rec->used && fwrite(rec->buf, sizeof(uint32_t), rec->used, rec->file) != rec->used) {
+        rec->error = 1;
+    }
+    rec->header.events += rec->used;
+    rec->used = 0;
+}
+
+int recorder_close(Recorder_t *rec, long instructions) {
+    if (!rec) {
+        return 0;
+    }
+    int status = 0;
+    if (rec->file) {
+        recorder_flush(rec);
+        rec->header.instructions = (uint64_t)(instructions - rec->first_instructions);
+        if (fseek(rec->file, 0, SEEK_SET) != 0 ||
+            fwrite(&rec->header, sizeof(rec->header), 1, rec->file) != 1) {
+            rec->error = 1;
+        }
+        if (fclose(rec->file) != 0 || rec->error) {
+            fprintf(stderr, "Failed to write replay trace: %s\n", rec->filename);
+            status = -1;
+        }
+    }
+    free(rec->buf);
+    free(rec);
+    return status;
+}
+
+// A loaded trace, shared read-only by all replays
+typedef struct {
+    ReplayHeader_t header;
+    DecodedInst_t *decoded;     // text decoded once, indexed by PC/4
+    uint32_t *events;
+    uint32_t end_pc;            // one past the last instruction
+} ReplayTrace_t;
+
+static void free_trace(ReplayTrace_t *t) {
+    free(t->decoded);
+    free(t->events);
+}
+
+static int load_trace(ReplayTrace_t *t, const char *filename) {
+    memset(t, 0, sizeof(*t));
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open replay trace: %s\n", filename);
+        return -1;
+    }
+    ReplayHeader_t *h = &t->header;
+    if (fread(h, sizeof(*h), 1, file) != 1 || memcmp(h->magic, REPLAY_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != REPLAY_VERSION) {
+        fprintf(stderr, "Not a replay trace (or unsupported version): %s\n", filename);
+        fclose(file);
+        return -1;
+    }
+    uint32_t *text = malloc((h->instr_count ? h->instr_count : 1) * sizeof(uint32_t));
+    t->decoded = malloc((h->instr_count ? h->instr_count : 1) * sizeof(DecodedInst_t));
+    t->events = malloc((h->events ? h->events : 1) * sizeof(uint32_t));
+    int status = 0;
+    if (!text || !t->decoded || !t->events) {
+        fprintf(stderr, "Failed to allocate replay trace\n");
+        status = -1;
+    } else if (fread(text, sizeof(uint32_t), h->instr_count, file) != h->instr_count ||
+               fread(t->events, sizeof(uint32_t), h->events, file) != h->events) {
+        fprintf(stderr, "Truncated replay trace: %s\n", filename);
+        status = -1;
+    } else {
+        for (uint32_t i = 0; i < h->instr_count; ++i) {
+            decode_instr(text[i], h->text_base + i * 4, &t->decoded[i]);
+        }
+        t->end_pc = h->text_base + h->instr_count * 4;
+    }
+    free(text);
+    fclose(file);
+    if (status < 0) {
+        free_trace(t);
+    }
+    return status;
+}
+
+// Pipeline register of the timing model: control signals and the recorded
+// outcome only, no operand or result values
+typedef struct {
+    uint8_t valid;
+    uint8_t regWrite;
+    uint8_t destReg;
+    uint8_t memRead;
+    uint8_t memWrite;
+    uint8_t pred_taken;
+    uint32_t pc;
+    uint32_t pred_target;
+    uint32_t event;             // recorded outcome (see replay.h)
+    const DecodedInst_t *d;
+} ReplaySlot_t;
+
+// Timing state of one replay. It follows pipeline_step cycle for cycle, so the
+// counts match a full simulation with the same configuration.
+typedef struct {
+    const ReplayTrace_t *trace;
+    const SimConfig_t *config;
+    ReplaySlot_t IFID, IDEX, EXMEM, MEMWB;
+    uint32_t PC;
+    uint8_t fetch_enable;
+    uint8_t fetch_ready;
+    int fetch_wait;
+    int mem_stall;
+    int md_busy;
+    uint8_t on_path;            // fetch is on the committed path
+    uint32_t path_pc;           // next committed PC to fetch
+    uint64_t cursor;            // event of the next committed instruction
+    int error;                  // trace ended before the program did
+    int invalid;                // the program stopped at an invalid instruction at invalid_pc
+    uint32_t invalid_pc;
+    BranchPredictor_t bp;
+    Cache_t icache;
+    Cache_t dcache;
+    long cycle;
+    long instructions;
+} ReplayEngine_t;
+
+// PC that follows a committed instruction, given its recorded outcome
+static uint32_t committed_next(const ReplayTrace_t *t, const DecodedInst_t *d, uint32_t pc,
+                               uint32_t event) {
+    if (d->jump) {
+        return (d->jump == 2) ? event : d->target;
+    }
+    if (d->branch) {
+        return event ? d->target : pc + 4;
+    }
+    if ((d->syscall && event) || d->invalid) {
+        return t->end_pc;
+    }
+    return pc + 4;
+}
+
+static int replay_step(ReplayEngine_t *e) {
+    const ReplayTrace_t *t = e->trace;
+    e->cycle++;
+    if (e->md_busy > 0) {
+        e->md_busy--;
+    }
+    if (e->mem_stall > 0) {
+        e->mem_stall--;
+        return 1;
+    }
+    if (!e->fetch_enable && !e->IFID.valid && !e->IDEX.valid && !e->EXMEM.valid && !e->MEMWB.valid) {
+        return 0;
+    }
+    // MEM: the recorded effective address goes to the data cache
+    ReplaySlot_t MEMWB_new = e->EXMEM;
+    if (e->EXMEM.valid && (e->EXMEM.memRead || e->EXMEM.memWrite)) {
+        e->mem_stall = cache_access(&e->dcache, e->EXMEM.event, e->EXMEM.memWrite);
+    }
+    // EX: resolve control flow from the recorded outcome. Wrong-path
+    // instructions never get this far, so every slot here has its event.
+    ReplaySlot_t EXMEM_new = e->IDEX;
+    int mispredict = 0;
+    int exited = 0;
+    uint32_t redirect_pc = 0;
+    if (e->IDEX.valid) {
+        const ReplaySlot_t *x = &e->IDEX;
+        const DecodedInst_t *d = x->d;
+        if (d->muldiv) {
+            int latency = (d->muldiv <= MD_MULTU) ? e->config->mult_latency : e->config->div_latency;
+            e->md_busy = latency - 1;
+        }
+        if (d->syscall) {
+            exited = (x->event != 0);
+        }
+        if (d->invalid) {
+            exited = 1;
+            e->invalid = 1;
+            e->invalid_pc = x->pc;
+        }
+        if (d->jump || d->branch) {
+            int taken = d->jump ? 1 : (x->event != 0);
+            uint32_t target = (d->jump == 2) ? x->event : d->target;
+            uint32_t actual_next = taken ? target : x->pc + 4;
+            uint32_t predicted_next = x->pred_taken ? x->pred_target : x->pc + 4;
+            mispredict = (actual_next != predicted_next);
+            redirect_pc = actual_next;
+            bp_update(&e->bp, x->pc, d->jump != 0, taken, target, mispredict);
+        }
+    }
+    if (mispredict) {
+        e->PC = redirect_pc;
+        e->fetch_enable = !e->error;
+        e->fetch_wait = 0;
+        e->fetch_ready = 0;
+        e->IFID = (ReplaySlot_t){0};
+        e->IDEX = (ReplaySlot_t){0};
+        e->on_path = 1;
+    }
+    if (exited) {
+        e->PC = t->end_pc;
+        e->fetch_enable = 0;
+        e->fetch_wait = 0;
+        e->fetch_ready = 0;
+        e->IFID = (ReplaySlot_t){0};
+        e->IDEX = (ReplaySlot_t){0};
+    }
+    // ID: control signals were taken from the decode table at fetch
+    ReplaySlot_t IDEX_new = e->IFID;
+    // IF
+    ReplaySlot_t IFID_new = {0};
+    uint32_t next_pc = e->PC;
+    int committed = 0;
+    uint32_t committed_pc = 0;
+    if (e->fetch_enable) {
+        uint32_t index = (e->PC - t->header.text_base) / 4;
+        if (index < t->header.instr_count) {
+            if (!e->fetch_ready) {
+                e->fetch_wait = cache_access(&e->icache, e->PC, 0);
+                e->fetch_ready = 1;
+            }
+            if (e->fetch_wait > 0) {
+                e->fetch_wait--;
+            } else {
+                const DecodedInst_t *d = &t->decoded[index];
+                IFID_new.valid = 1;
+                IFID_new.pc = e->PC;
+                IFID_new.d = d;
+                IFID_new.regWrite = d->regWrite;
+                IFID_new.destReg = d->destReg;
+                IFID_new.memRead = d->memRead;
+                IFID_new.memWrite = d->memWrite;
+                e->fetch_ready = 0;
+                IFID_new.pred_taken = (uint8_t)bp_predict(&e->bp, e->PC, &IFID_new.pred_target);
+                next_pc = IFID_new.pred_taken ? IFID_new.pred_target : e->PC + 4;
+                // Only the committed path consumes events
+                if (e->on_path && e->PC == e->path_pc) {
+                    committed = 1;
+                    if (replay_has_event(d)) {
+                        if (e->cursor < t->header.events) {
+                            IFID_new.event = t->events[e->cursor];
+                        } else {
+                            e->error = 1;
+                        }
+                    }
+                    committed_pc = committed_next(t, d, e->PC, IFID_new.event);
+                }
+            }
+        } else {
+            e->fetch_enable = 0;
+        }
+    }
+    int stall = 0;
+    if (e->IFID.valid) {
+        const DecodedInst_t *d = e->IFID.d;
+        stall = hazard_detect_data(e->IDEX.regWrite, e->EXMEM.regWrite, e->IDEX.destReg,
+                                   e->EXMEM.destReg, d->srcA, d->srcB, e->IDEX.memRead,
+                                   e->config->forwarding);
+        if (!stall) {
+            stall = hazard_detect_muldiv(d->muldiv || d->hilo, e->md_busy);
+        }
+    }
+    if (stall) {
+        e->IDEX = (ReplaySlot_t){0};
+        if (IFID_new.valid) {
+            e->fetch_ready = 1;
+        }
+    } else {
+        e->IDEX = IDEX_new;
+        e->IFID = IFID_new;
+        e->PC = next_pc;
+        if (committed) {
+            e->cursor += replay_has_event(IFID_new.d);
+            e->path_pc = committed_pc;
+        } else if (IFID_new.valid) {
+            e->on_path = 0;
+        }
+        if (e->error) {
+            // Nothing left to replay: let the pipeline drain
+            e->fetch_enable = 0;
+        }
+    }
+    e->EXMEM = EXMEM_new;
+    e->MEMWB = MEMWB_new;
+    if (e->MEMWB.valid && e->MEMWB.d->instr != 0) {
+        e->instructions++;
+    }
+    return 1;
+}
+
+// One line of the configuration file and its result
+typedef struct {
+    char *line;
+    SimConfig_t config;
+    long cycles;
+    long instructions;
+    long resolved;
+    long mispredicts;
+    double imiss;               // miss rates in percent, -1 for ideal memory
+    double dmiss;
+    int status;
+    int invalid;                // see ReplayEngine_t
+    uint32_t invalid_pc;
+} ReplayJob_t;
+
+typedef struct {
+    const ReplayTrace_t *trace;
+    ReplayJob_t *jobs;
+    int count;
+    int next;                   // next job to hand out, protected by lock
+    pthread_mutex_t lock;
+} ReplayQueue_t;
+
+static double miss_rate(const Cache_t *c) {
+    long accesses = c->hits + c->misses;
+    if (!c->lines) {
+        return -1.0;
+    }
+    return accesses ? 100.0 * (double)c->misses / (double)accesses : 0.0;
+}
+
+static void run_job(const ReplayTrace_t *t, ReplayJob_t *job) {
+    ReplayEngine_t *e = calloc(1, sizeof(ReplayEngine_t));
+    job->status = -1;
+    if (!e) {
+        return;
+    }
+    e->trace = t;
+    e->config = &job->config;
+    e->PC = t->header.entry;
+    e->fetch_enable = 1;
+    e->on_path = 1;
+    e->path_pc = t->header.entry;
+    bp_init(&e->bp, job->config.bp_policy);
+    if (cache_init(&e->icache, &job->config.icache) == 0 &&
+        cache_init(&e->dcache, &job->config.dcache) == 0) {
+        while (replay_step(e)) {
+        }
+        job->cycles = e->cycle;
+        job->instructions = e->instructions;
+        job->resolved = e->bp.branches + e->bp.jumps;
+        job->mispredicts = e->bp.mispredicts;
+        job->imiss = miss_rate(&e->icache);
+        job->dmiss = miss_rate(&e->dcache);
+        job->invalid = e->invalid;
+        job->invalid_pc = e->invalid_pc;
+        // The replayed path must cover the recorded run exactly
+        job->status = (!e->error && e->cursor == t->header.events &&
+                       (uint64_t)e->instructions == t->header.instructions) ? 0 : -1;
+    }
+    cache_free(&e->icache);
+    cache_free(&e->dcache);
+    free(e);
+}
+
+static void *worker(void *arg) {
+    ReplayQueue_t *q = arg;
+    while (1) {
+        pthread_mutex_lock(&q->lock);
+        int index = q->next < q->count ? q->next++ : -1;
+        pthread_mutex_unlock(&q->lock);
+        if (index < 0) {
+            break;
+        }
+        run_job(q->trace, &q->jobs[index]);
+    }
+    return NULL;
+}
+
+// Parse one configuration line; only options that change timing are accepted
+static int parse_config(ReplayJob_t *job, char *args) {
+    char *argv[MAX_CONFIG_ARGS];
+    int argc = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(args, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (argc == MAX_CONFIG_ARGS) {
+            fprintf(stderr, "Too many arguments in configuration: %s\n", job->line);
+            return -1;
+        }
+        argv[argc++] = tok;
+    }
+    SimConfig_t *cfg = &job->config;
+    sim_config_default(cfg);
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "default") == 0) {
+            continue;
+        }
+        int r = options_parse_one(argc, argv, &i, cfg);
+        if (r < 0) {
+            return -1;
+        }
+        if (r == 0) {
+            fprintf(stderr, "Invalid configuration argument '%s' in: %s\n", argv[i], job->line);
+            return -1;
+        }
+    }
+    if (cfg->functional || cfg->no_jit || cfg->trace_file || cfg->stats || cfg->stats_json ||
+        cfg->stats_csv || cfg->checkpoint_file || cfg->checkpoint_trigger != CKPT_NONE ||
+        cfg->restore_file || cfg->record_file || cfg->sample_size || cfg->num_data || cfg->text_base) {
+        fprintf(stderr, "Only pipeline timing options can be replayed: %s\n", job->line);
+        return -1;
+    }
+    if (cfg->dual_issue || cfg->ooo || cfg->cores > 1) {
+        fprintf(stderr, "The replay engine models the scalar single-core pipeline only: %s\n", job->line);
+        return -1;
+    }
+    return 0;
+}
+
+static void free_jobs(ReplayJob_t *jobs, int count) {
+    for (int i = 0; i < count; ++i) {
+        free(jobs[i].line);
+    }
+    free(jobs);
+}
+
+// Returns the number of configurations, -1 on error
+static int read_configs(const char *filename, ReplayJob_t **jobs_out) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open configuration file: %s\n", filename);
+        return -1;
+    }
+    ReplayJob_t *jobs = NULL;
+    int count = 0, capacity = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    int failed = 0;
+    while (getline(&line, &line_cap, file) != -1) {
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strspn(line, " \t") == strlen(line)) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            ReplayJob_t *grown = realloc(jobs, capacity * sizeof(ReplayJob_t));
+            if (!grown) {
+                failed = 1;
+                break;
+            }
+            jobs = grown;
+        }
+        ReplayJob_t *job = &jobs[count++];
+        memset(job, 0, sizeof(*job));
+        job->line = strdup(line);
+        char *args = strdup(line);
+        if (!job->line || !args || parse_config(job, args) < 0) {
+            failed = 1;
+        }
+        free(args);
+        if (failed) {
+            break;
+        }
+    }
+    free(line);
+    fclose(file);
+    if (failed) {
+        free_jobs(jobs, count);
+        return -1;
+    }
+    *jobs_out = jobs;
+    return count;
+}
+
+static void print_miss(double rate) {
+    if (rate < 0) {
+        printf(" %8s", "ideal");
+    } else {
+        printf(" %7.2f%%", rate);
+    }
+}
+
+int replay_run(const char *trace_file, const char *config_file, int threads) {
+    ReplayTrace_t trace;
+    if (load_trace(&trace, trace_file) < 0) {
+        return 1;
+    }
+    ReplayJob_t *jobs = NULL;
+    int count = read_configs(config_file, &jobs);
+    if (count < 0) {
+        free_trace(&trace);
+        return 1;
+    }
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+    }
+    if (threads > count) {
+        threads = count > 0 ? count : 1;
+    }
+    ReplayQueue_t q = { &trace, jobs, count, 0, PTHREAD_MUTEX_INITIALIZER };
+    pthread_t *pool = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    if (pool) {
+        for (; started < threads; ++started) {
+            if (pthread_create(&pool[started], NULL, worker, &q) != 0) {
+                break;
+            }
+        }
+    }
+    if (started == 0) {
+        worker(&q);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(pool[i], NULL);
+    }
+    free(pool);
+    printf("Replayed %llu instructions (%llu events) against %d configurations.\n",
+           (unsigned long long)trace.header.instructions, (unsigned long long)trace.header.events, count);
+    printf("%4s %12s %12s %7s %9s %8s %8s  %s\n", "cfg", "cycles", "instructions", "CPI",
+           "bp acc", "I$ miss", "D$ miss", "options");
+    int status = 0;
+    for (int i = 0; i < count; ++i) {
+        // Every configuration replays the same path, so report this once
+        if (jobs[i].invalid) {
+            uint32_t instr = trace.decoded[(jobs[i].invalid_pc - trace.header.text_base) / 4].instr;
+            fprintf(stderr, "Invalid instruction 0x%08x (%s) at 0x%08x\n", instr, decode_name(instr),
+                    jobs[i].invalid_pc);
+            status = 1;
+            break;
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        const ReplayJob_t *job = &jobs[i];
+        if (job->status != 0) {
+            printf("%4d %12s %12s %7s %9s %8s %8s  %s\n", i + 1, "failed", "-", "-", "-", "-", "-", job->line);
+            status = 1;
+            continue;
+        }
+        printf("%4d %12ld %12ld %7.3f %8.2f%%", i + 1, job->cycles, job->instructions,
+               job->instructions ? (double)job->cycles / (double)job->instructions : 0.0,
+               job->resolved ? 100.0 * (double)(job->resolved - job->mispredicts) / (double)job->resolved
+                             : 100.0);
+        print_miss(job->imiss);
+        print_miss(job->dmiss);
+        printf("  %s\n", job->line);
+    }
+    free_jobs(jobs, count);
+    free_trace(&trace);
+    return status;
+}
@@ -0,0 +1,74 @@
+/**
+ * replay.h - Committed-instruction traces: recording from the functional engine
+ * and timing-only replay of one trace against many pipeline configurations.
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "decode.h"
+
+#define REPLAY_MAGIC "MIPSRPL1"
+#define REPLAY_VERSION 1
+#define REPLAY_BUFFER_EVENTS 65536
+
+// File header (host byte order), followed by the instr_count text words and
+// then the event stream. The decoded form and register reads/writes of every
+// instruction come from the text, so the stream only holds what execution
+// decided: one 32-bit event per load/store (effective address), BEQ/BNE
+// (1 if taken), JR (target) and SYSCALL (1 if it ended the program).
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t text_base;
+    uint32_t entry;         // PC of the first recorded instruction
+    uint32_t instr_count;
+    uint32_t reserved;
+    uint64_t instructions;  // completed instructions (nops excluded)
+    uint64_t events;
+} ReplayHeader_t;
+
+// Trace writer fed by the functional engine
+typedef struct Recorder {
+    FILE *file;
+    const char *filename;
+    uint32_t *buf;          // REPLAY_BUFFER_EVENTS pending events
+    size_t used;
+    long first_instructions;    // completed-instruction count when recording started
+    ReplayHeader_t header;
+    int error;
+} Recorder_t;
+
+// Create a trace of the program in st, starting at st->pc after instructions
+// have completed. Returns NULL on failure.
+Recorder_t *recorder_open(const char *filename, const ArchState_t *st, long instructions);
+
+// Write the pending events and the final header and close the file; rec may
+// be NULL. Returns 0 on success, -1 if anything could not be written.
+int recorder_close(Recorder_t *rec, long instructions);
+
+// Write the buffered events to the file.
+void recorder_flush(Recorder_t *rec);
+
+// Whether instruction d produces an event
+static inline int replay_has_event(const DecodedInst_t *d) {
+    return d->memRead || d->memWrite || d->branch || d->jump == 2 || d->syscall;
+}
+
+static inline void recorder_event(Recorder_t *rec, uint32_t value) {
+    rec->buf[rec->used++] = value;
+    if (rec->used == REPLAY_BUFFER_EVENTS) {
+        recorder_flush(rec);
+    }
+}
+
+// Replay the trace once per configuration line of config_file (simulation
+// options as on the command line, '#' starts a comment, "default" stands for
+// the default pipeline) on a pool of worker threads (0 = one per online
+// CPU), and print one result row per configuration in file order.
+// Returns 0 if every configuration ran, 1 otherwise (also when the recorded
+// program stopped at an invalid instruction).
+int replay_run(const char *trace_file, const char *config_file, int threads);
+
+#endif // REPLAY_H
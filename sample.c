@@ -0,0 +1,112 @@
+/**
+ * sample.c - Periodic sampling: fast-forward functionally, warm up and measure on the pipeline.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "util.h"
+#include "functional.h"
+#include "pipeline.h"
+#include "sim.h"
+#include "sample.h"
+
+#define SAMPLE_Z95 1.96   /* normal quantile for a two-sided 95% interval */
+
+int sample_parse(const char *text, long *size, long *interval, long *warmup) {
+    char *end;
+    long n = strtol(text, &end, 10);
+    if (end == text || *end != ':') {
+        return -1;
+    }
+    const char *rest = end + 1;
+    long m = strtol(rest, &end, 10);
+    if (end == rest) {
+        return -1;
+    }
+    long w = n;
+    if (*end == ':') {
+        rest = end + 1;
+        w = strtol(rest, &end, 10);
+        if (end == rest) {
+            return -1;
+        }
+    }
+    if (*end != '\0' || n <= 0 || w < 0 || m < n + w) {
+        return -1;
+    }
+    *size = n;
+    *interval = m;
+    *warmup = w;
+    return 0;
+}
+
+// Run the pipeline from the architectural PC for warmup + size instructions,
+// then stop fetching and let it drain so the functional engine can take over.
+// Returns 0 if the program ended inside the window.
+static int detailed_window(Sim_t *sim, long warmup, long size) {
+    SampleStats_t *s = &sim->sample;
+    Pipeline_t *p = &sim->pipe;
+    pipeline_reset(p, sim->arch.pc);
+    long start = sim->instructions;
+    long mark_cycle = -1, mark_instructions = 0;
+    while (pipeline_step(sim)) {
+        long done = sim->instructions - start;
+        if (mark_cycle < 0 && done >= warmup) {
+            mark_cycle = sim->cycle;
+            mark_instructions = sim->instructions;
+        }
+        if (!p->draining && done >= warmup + size) {
+            long measured = sim->instructions - mark_instructions;
+            double cpi = (double)(sim->cycle - mark_cycle) / (double)measured;
+            s->samples++;
+            s->cpi_sum += cpi;
+            s->cpi_sum_sq += cpi * cpi;
+            p->draining = 1;
+            p->fetch_enable = 0;
+        }
+    }
+    s->detailed_instructions += sim->instructions - start;
+    // Fetch stopped either at the end of the program or at the resume point
+    sim->arch.pc = p->PC;
+    return p->draining;
+}
+
+int sample_run(Sim_t *sim) {
+    long size = sim->config.sample_size;
+    long warmup = sim->config.sample_warmup;
+    long skip = sim->config.sample_interval - size - warmup;
+    uint32_t count = (uint32_t)sim->arch.instr_count;
+    while (((sim->arch.pc - sim->arch.text_base) >> 2) < count) {
+        sim->sample.functional_instructions += functional_run(sim, skip);
+        if (((sim->arch.pc - sim->arch.text_base) >> 2) >= count || !detailed_window(sim, warmup, size)) {
+            break;
+        }
+    }
+    sim->finished = 1;
+    return 0;
+}
+
+void sample_report(const Sim_t *sim, FILE *out) {
+    const SampleStats_t *s = &sim->sample;
+    fprintf(out, "Sampled simulation: %ld windows of %ld instructions every %ld (warmup %ld).\n",
+            s->samples, sim->config.sample_size, sim->config.sample_interval, sim->config.sample_warmup);
+    fprintf(out, "Total instructions executed (completed): %ld (%.2f%% in detail)\n", sim->instructions,
+            sim->instructions ? 100.0 * (double)s->detailed_instructions / (double)sim->instructions : 0.0);
+    if (s->samples == 0) {
+        fprintf(out, "No complete measurement window: program shorter than one sample.\n");
+        return;
+    }
+    double n = (double)s->samples;
+    double mean = s->cpi_sum / n;
+    double half = 0.0;
+    if (s->samples > 1) {
+        double var = (s->cpi_sum_sq - n * mean * mean) / (n - 1.0);
+        half = SAMPLE_Z95 * sqrt(var > 0.0 ? var : 0.0) / sqrt(n);
+    }
+    double instr = (double)sim->instructions;
+    fprintf(out, "Estimated CPI %.4f +/- %.4f (95%% confidence, +/-%.2f%%)\n", mean, half,
+            mean > 0.0 ? 100.0 * half / mean : 0.0);
+    fprintf(out, "Estimated cycles: %.0f (%.0f to %.0f); %ld cycles simulated in detail\n",
+            mean * instr, (mean - half) * instr, (mean + half) * instr, sim->cycle);
+}
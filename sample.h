@@ -0,0 +1,30 @@
+/**
+ * sample.h - Sampled simulation: functional fast-forward with periodic detailed pipeline windows.
+ */
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdio.h>
+
+// Statistics of the measured windows
+typedef struct {
+    long samples;           // complete measurement windows
+    double cpi_sum;         // sum of per-window CPI
+    double cpi_sum_sq;      // sum of squared per-window CPI
+    long detailed_instructions;     // completed by the pipeline (warmup included)
+    long functional_instructions;   // fast-forwarded
+} SampleStats_t;
+
+struct Sim;
+
+// Parse "N:M[:W]" (measure N instructions every M, after W warmup
+// instructions; W defaults to N). Returns 0 on success, -1 if invalid.
+int sample_parse(const char *text, long *size, long *interval, long *warmup);
+
+// Run the loaded program to completion in sampling mode. Returns 0.
+int sample_run(struct Sim *sim);
+
+// Print the CPI/cycle estimate with its 95% confidence interval.
+void sample_report(const struct Sim *sim, FILE *out);
+
+#endif // SAMPLE_H
@@ -0,0 +1,394 @@
+/**
+ * sim.c - Simulator context management and engine dispatch.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "config.h"
+#include "util.h"
+#include "decode.h"
+#include "functional.h"
+#include "branch.h"
+#include "pipeline.h"
+#include "trace.h"
+#include "checkpoint.h"
+#include "sample.h"
+#include "jit.h"
+#include "replay.h"
+#include "dual.h"
+#include "ooo.h"
+#include "steady.h"
+#include "dump.h"
+#include "sim.h"
+
+void sim_config_default(SimConfig_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->bp_policy = BP_NOT_TAKEN;
+    cfg->mult_latency = MULT_LATENCY;
+    cfg->div_latency = DIV_LATENCY;
+    ooo_config_default(&cfg->ooo_config);
+    cfg->cores = 1;
+    cfg->quantum = MC_QUANTUM;
+    CacheConfig_t cache = { 0, 1, 32, CACHE_LRU, 1, 10 };
+    cfg->icache = cache;
+    cfg->dcache = cache;
+}
+
+Sim_t *sim_create(const SimConfig_t *cfg) {
+    Sim_t *sim = calloc(1, sizeof(Sim_t));
+    if (!sim) {
+        fprintf(stderr, "Failed to allocate simulator context\n");
+        return NULL;
+    }
+    if (cfg) {
+        sim->config = *cfg;
+    } else {
+        sim_config_default(&sim->config);
+    }
+    console_init(&sim->console, stdout);
+    return sim;
+}
+
+void sim_destroy(Sim_t *sim) {
+    if (!sim) {
+        return;
+    }
+    console_flush(&sim->console);
+    console_free(&sim->console);
+    trace_close(sim->trace);
+    recorder_close(sim->recorder, sim->instructions);
+    jit_free(sim->jit);
+    ooo_free(sim->ooo);
+    steady_free(sim->steady);
+    free(sim->decoded);
+    mem_free(&sim->arch);
+    cache_free(&sim->icache);
+    cache_free(&sim->dcache);
+    stats_free(&sim->stats);
+    free(sim);
+}
+
+// Build the derived state for freshly loaded or restored architectural state:
+// decode table, trace and counters, plus a cold predictor and caches unless
+// warm (restored from a checkpoint)
+static int sim_prepare(Sim_t *sim, int warm) {
+    // Instruction memory is fixed after loading, so decode it once up front
+    // (and translations of the previous program are stale)
+    jit_free(sim->jit);
+    sim->jit = NULL;
+    sim->decoded = decode_program(&sim->arch);
+    if (!sim->decoded) {
+        return -1;
+    }
+    if (!warm) {
+        bp_init(&sim->bp, sim->config.bp_policy);
+        cache_free(&sim->icache);
+        cache_free(&sim->dcache);
+        if (cache_init(&sim->icache, &sim->config.icache) < 0 ||
+            cache_init(&sim->dcache, &sim->config.dcache) < 0) {
+            return -1;
+        }
+        sim->icache_stall_cycles = 0;
+        sim->dcache_stall_cycles = 0;
+    }
+    trace_close(sim->trace);
+    sim->trace = NULL;
+    if (sim->config.trace_file) {
+        if (sim->config.functional || sim->config.dual_issue) {
+            fprintf(stderr, "Pipeline trace is not available in functional or dual-issue mode\n");
+            return -1;
+        }
+        sim->trace = trace_open(sim->config.trace_file, (uint64_t)sim->cycle + 1);
+        if (!sim->trace) {
+            return -1;
+        }
+    }
+    recorder_close(sim->recorder, sim->instructions);
+    sim->recorder = NULL;
+    if (sim->config.record_file) {
+        if (!sim->config.functional) {
+            fprintf(stderr, "--record needs --functional\n");
+            return -1;
+        }
+        sim->recorder = recorder_open(sim->config.record_file, &sim->arch, sim->instructions);
+        if (!sim->recorder) {
+            return -1;
+        }
+    }
+    stats_free(&sim->stats);
+    if (sim->config.stats || sim->config.stats_json || sim->config.stats_csv) {
+        if (sim->config.functional) {
+            fprintf(stderr, "Performance counters are not available in functional mode\n");
+            return -1;
+        }
+        if (stats_init(&sim->stats, sim->arch.text_base, sim->arch.instr_count) < 0) {
+            return -1;
+        }
+    }
+    if (sim->config.checkpoint_file && sim->config.checkpoint_trigger == CKPT_NONE) {
+        fprintf(stderr, "--checkpoint needs a --checkpoint-at trigger\n");
+        return -1;
+    }
+    if (sim->config.checkpoint_file && sim->config.dual_issue) {
+        fprintf(stderr, "--checkpoint is not available in dual-issue mode\n");
+        return -1;
+    }
+    if (sim->config.checkpoint_trigger == CKPT_CYCLE && sim->config.functional) {
+        fprintf(stderr, "Cycle checkpoint triggers need the pipeline model\n");
+        return -1;
+    }
+    if (sim->config.sample_size && (sim->config.functional || sim->config.checkpoint_file)) {
+        fprintf(stderr, "--sample cannot be combined with --functional or --checkpoint\n");
+        return -1;
+    }
+    if ((sim->config.dump_format != DUMP_HEX || sim->config.dump_file || sim->config.verify_file) &&
+        !sim->config.dump_regs && !sim->config.num_dumps) {
+        fprintf(stderr, "--dump-format, --dump-file and --verify need --dump-regs or --dump-mem\n");
+        return -1;
+    }
+    if (sim->config.cores > 1) {
+        // Multicore runs create one single-core context per core
+        fprintf(stderr, "--cores is only available for single runs of the simulator\n");
+        return -1;
+    }
+    ooo_free(sim->ooo);
+    sim->ooo = NULL;
+    if (sim->config.ooo) {
+        const SimConfig_t *c = &sim->config;
+        if (c->functional || c->dual_issue || c->trace_file || c->stats || c->stats_json ||
+            c->stats_csv || c->checkpoint_file || c->sample_size || warm) {
+            fprintf(stderr, "--ooo cannot be combined with --functional, --dual-issue, --trace, "
+                    "the --stats options, --checkpoint, --restore or --sample\n");
+            return -1;
+        }
+        sim->ooo = ooo_create(&c->ooo_config, sim->arch.pc);
+        if (!sim->ooo) {
+            return -1;
+        }
+    }
+    steady_free(sim->steady);
+    sim->steady = NULL;
+    if (sim->config.extrapolate) {
+        // Timing must depend on nothing but the pipeline's structure, the
+        // predictor and the path: no caches, and nothing that observes cycles
+        const SimConfig_t *c = &sim->config;
+        if (c->functional || c->dual_issue || c->ooo || c->icache.size || c->dcache.size ||
+            c->trace_file || c->stats || c->stats_json || c->stats_csv || c->checkpoint_file ||
+            c->sample_size) {
+            fprintf(stderr, "--extrapolate needs the single-issue pipeline with ideal memory and "
+                    "cannot be combined with --trace, the --stats options, --checkpoint or --sample\n");
+            return -1;
+        }
+        sim->steady = steady_create();
+        if (!sim->steady) {
+            return -1;
+        }
+    }
+    sim->engine = pipeline_select(sim);
+    memset(&sim->sample, 0, sizeof(sim->sample));
+    sim->checkpointed = 0;
+    sim->exited = 0;
+    sim->exit_code = 0;
+    sim->invalid = 0;
+    sim->loaded = 1;
+    sim->finished = 0;
+    return 0;
+}
+
+int sim_load(Sim_t *sim, const char *filename) {
+    // Initialize state
+    reg_init(&sim->arch);
+    mem_init(&sim->arch);
+    free(sim->decoded);
+    sim->decoded = NULL;
+    sim->loaded = 0;
+    // Load program
+    int inst_count = load_program(&sim->arch, filename, sim->config.text_base);
+    if (inst_count < 0) {
+        return -1;
+    }
+    for (int i = 0; i < sim->config.num_data; ++i) {
+        if (load_data_image(&sim->arch, sim->config.data[i].file, sim->config.data[i].address) < 0) {
+            return -1;
+        }
+    }
+    sim->arch.pc = sim->arch.entry;
+    pipeline_reset(&sim->pipe, sim->arch.entry);
+    memset(&sim->issue, 0, sizeof(sim->issue));
+    sim->cycle = 0;
+    sim->instructions = 0;
+    return sim_prepare(sim, 0) < 0 ? -1 : inst_count;
+}
+
+int sim_restore(Sim_t *sim, const char *filename) {
+    free(sim->decoded);
+    sim->decoded = NULL;
+    sim->loaded = 0;
+    int inst_count = checkpoint_restore(sim, filename);
+    if (inst_count < 0) {
+        return -1;
+    }
+    return sim_prepare(sim, 1) < 0 ? -1 : inst_count;
+}
+
+int sim_step(Sim_t *sim) {
+    if (!sim->loaded || sim->finished) {
+        return 0;
+    }
+    uint32_t prev_pc = sim->arch.pc;
+    int running = sim->config.functional ? functional_step(sim)
+                : sim->ooo ? ooo_step(sim) : pipeline_step(sim);
+    if (sim->config.checkpoint_file && !sim->checkpointed && checkpoint_due(sim, prev_pc)) {
+        sim->checkpointed = (checkpoint_save(sim, sim->config.checkpoint_file) == 0) ? 1 : -1;
+    }
+    if (!running) {
+        sim->finished = 1;
+        console_flush(&sim->console);
+        // Flush the trace as soon as the run ends
+        trace_close(sim->trace);
+        sim->trace = NULL;
+    }
+    return running;
+}
+
+int sim_invalid(Sim_t *sim, uint32_t pc, uint32_t instr) {
+    fprintf(stderr, "Invalid instruction 0x%08x (%s) at 0x%08x\n", instr, decode_name(instr), pc);
+    sim->invalid = 1;
+    console_flush(&sim->console);
+    return 1;
+}
+
+int sim_run(Sim_t *sim) {
+    if (!sim->loaded) {
+        return -1;
+    }
+    if (sim->config.sample_size) {
+        if (!sim->finished) {
+            sample_run(sim);
+        }
+    } else if (sim->config.functional) {
+        // Step only until a pending checkpoint is written, then use the tight
+        // loop rather than stepping one instruction at a time
+        while (sim->config.checkpoint_file && !sim->checkpointed && sim_step(sim)) {
+        }
+        if (!sim->finished) {
+            functional_run(sim, LONG_MAX);
+            sim->finished = 1;
+        }
+    } else {
+        while (sim_step(sim)) {
+        }
+    }
+    int status = sim->invalid ? -1 : 0;
+    if (sim->recorder) {
+        if (recorder_close(sim->recorder, sim->instructions) < 0) {
+            status = -1;
+        }
+        sim->recorder = NULL;
+    }
+    if (console_flush(&sim->console) < 0) {
+        fprintf(stderr, "Failed to write program output\n");
+        status = -1;
+    }
+    if (sim->config.checkpoint_file && sim->checkpointed <= 0) {
+        if (!sim->checkpointed) {
+            fprintf(stderr, "Program finished before the checkpoint trigger\n");
+        }
+        status = -1;
+    }
+    if (sim->config.stats_json && stats_write_json(sim, sim->config.stats_json) < 0) {
+        status = -1;
+    }
+    if (sim->config.stats_csv && stats_write_csv(sim, sim->config.stats_csv) < 0) {
+        status = -1;
+    }
+    return status;
+}
+
+static void report_cache(FILE *out, const char *name, const Cache_t *c) {
+    const CacheConfig_t *cfg = &c->config;
+    if (!c->lines) {
+        fprintf(out, "%s: ideal\n", name);
+        return;
+    }
+    long accesses = c->hits + c->misses;
+    fprintf(out, "%s %uB %u-way %uB lines (%s, %s): %ld accesses, %ld hits, %ld misses "
+            "(%.2f%% miss), %ld evictions, %ld writebacks, %ld write-throughs\n",
+            name, cfg->size, cfg->assoc, cfg->line_size,
+            cfg->replacement == CACHE_RANDOM ? "random" : "LRU",
+            cfg->write_back ? "write-back" : "write-through",
+            accesses, c->hits, c->misses,
+            accesses ? 100.0 * (double)c->misses / (double)accesses : 0.0,
+            c->evictions, c->writebacks, c->write_throughs);
+}
+
+// Pairing summary of the dual-issue mode
+static void report_issue(const Sim_t *sim, FILE *out) {
+    const IssueStats_t *is = &sim->issue;
+    fprintf(out, "Dual issue: %ld of %ld issue cycles paired (%.2f%%)\n",
+            is->dual_issues, is->issue_cycles,
+            is->issue_cycles ? 100.0 * (double)is->dual_issues / (double)is->issue_cycles : 0.0);
+    fprintf(out, "Single issue:");
+    for (int i = SPLIT_ALONE; i < SPLIT_COUNT; ++i) {
+        fprintf(out, "%s %s %ld", i == SPLIT_ALONE ? "" : ",", dual_split_name(i), is->split[i]);
+    }
+    fprintf(out, "\n");
+}
+
+// Note an explicit exit or an invalid instruction, which may leave code after
+// it unexecuted
+static void report_exit(const Sim_t *sim, FILE *out) {
+    if (sim->exited) {
+        fprintf(out, "Program exited via syscall with code %d.\n", sim->exit_code);
+    } else if (sim->invalid) {
+        fprintf(out, "Program stopped at an invalid instruction.\n");
+    }
+}
+
+void sim_report(const Sim_t *sim, FILE *out) {
+    if (sim->config.functional) {
+        fprintf(out, "Functional simulation completed.\n");
+        fprintf(out, "Total instructions executed (completed): %ld\n", sim->instructions);
+        report_exit(sim, out);
+        fprintf(out, "Data memory: %ld pages touched, %zu KB resident\n",
+                sim->arch.mem.resident_pages, mem_resident_bytes(&sim->arch) / 1024);
+        return;
+    }
+    const BranchPredictor_t *bp = &sim->bp;
+    if (sim->config.sample_size) {
+        sample_report(sim, out);
+    } else if (sim->ooo) {
+        ooo_report(sim, out);
+    } else {
+        fprintf(out, "Simulation completed in %ld cycles (%s%s).\n", sim->cycle,
+                sim->config.forwarding ? "forwarding" : "stall-only",
+                sim->config.dual_issue ? ", dual-issue" : "");
+        fprintf(out, "Total instructions executed (completed): %ld\n", sim->instructions);
+    }
+    report_exit(sim, out);
+    if (sim->config.dual_issue) {
+        report_issue(sim, out);
+    }
+    long resolved = bp->branches + bp->jumps;
+    fprintf(out, "Branch prediction (%s): %ld branches, %ld jumps, %ld mispredicted "
+            "(accuracy %.2f%%), %ld flush cycles\n",
+            bp_policy_name(bp->policy), bp->branches, bp->jumps, bp->mispredicts,
+            resolved ? 100.0 * (double)(resolved - bp->mispredicts) / (double)resolved : 100.0,
+            bp->flush_cycles);
+    fprintf(out, "Data memory: %ld pages touched, %zu KB resident\n",
+            sim->arch.mem.resident_pages, mem_resident_bytes(&sim->arch) / 1024);
+    if (sim->icache.lines || sim->dcache.lines) {
+        report_cache(out, "I-cache", &sim->icache);
+        report_cache(out, "D-cache", &sim->dcache);
+        fprintf(out, "Memory stalls: %ld I-cache cycles, %ld D-cache cycles (CPI %.3f)\n",
+                sim->icache_stall_cycles, sim->dcache_stall_cycles,
+                sim->instructions ? (double)sim->cycle / (double)sim->instructions : 0.0);
+    }
+    if (sim->steady) {
+        steady_report(sim, out);
+    }
+    if (sim->config.stats) {
+        stats_report(sim, out);
+    }
+}
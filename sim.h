@@ -0,0 +1,131 @@
+/**
+ * sim.h - Simulator context and library API.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "util.h"
+#include "decode.h"
+#include "branch.h"
+#include "pipeline.h"
+#include "cache.h"
+#include "stats.h"
+#include "sample.h"
+#include "syscall.h"
+#include "ooo.h"
+
+// Run-time configuration of one simulation
+typedef struct {
+    int functional;     // architectural-only execution, no pipeline model
+    int extrapolate;    // pipeline: skip steady-state loop iterations (see steady.h)
+    int no_jit;         // functional engine: interpret even where translation is available
+    int forwarding;     // EX/MEM and MEM/WB forwarding instead of stall-only
+    int dual_issue;     // 2-wide in-order fetch, issue and retire
+    int ooo;            // out-of-order core instead of the in-order pipeline
+    OooConfig_t ooo_config;
+    int cores;          // simulated cores sharing memory (see multicore.h)
+    long quantum;       // multicore: cycles each core runs between synchronizations
+    int bp_policy;      // BranchPolicy used by IF
+    int mult_latency;   // cycles from MULT/MULTU in EX until HI/LO can be read
+    int div_latency;    // same for DIV/DIVU
+    CacheConfig_t icache;   // size 0: ideal single-cycle instruction memory
+    CacheConfig_t dcache;   // size 0: ideal single-cycle data memory
+    uint32_t text_base; // load address of raw (non-ELF) program images
+    int num_data;       // raw data segment images loaded after the program
+    struct {
+        const char *file;
+        uint32_t address;
+    } data[MAX_DATA_IMAGES];
+    const char *trace_file; // binary pipeline trace output, NULL for none
+    int stats;              // print the performance counter summary
+    const char *stats_json; // performance counters as JSON, NULL for none
+    const char *stats_csv;  // per-PC counters as CSV, NULL for none
+    const char *checkpoint_file;    // snapshot written when the trigger fires, NULL for none
+    int checkpoint_trigger;         // CheckpointTrigger
+    uint64_t checkpoint_at;         // trigger cycle, instruction count or PC
+    const char *restore_file;       // start from this checkpoint instead of a program
+    const char *record_file;        // functional runs: committed-instruction trace for replay
+    long sample_size;       // sampling: instructions measured per window (0: off)
+    long sample_interval;   // sampling: instructions from one window to the next
+    long sample_warmup;     // sampling: detailed instructions before each measurement
+    int dump_regs;          // final state: include $0-$31, HI and LO (see dump.h)
+    int num_dumps;          // final state: memory ranges to include
+    struct {
+        uint32_t address;
+        uint32_t length;
+    } dumps[MAX_DUMP_RANGES];
+    int dump_format;        // DumpFormat
+    const char *dump_file;  // final-state dump output, NULL for the report stream
+    const char *verify_file;    // golden state image or "0x<hash>" to compare against, NULL for none
+} SimConfig_t;
+
+// Complete state of one simulation. Contexts share nothing, so independent
+// simulations can run concurrently on different threads.
+typedef struct Sim {
+    SimConfig_t config;
+    ArchState_t arch;
+    DecodedInst_t *decoded;     // instruction memory decoded once at load time
+    Pipeline_t pipe;
+    PipelineEngine_t *engine;   // pipeline variant for the configuration (see pipeline_select)
+    BranchPredictor_t bp;
+    Cache_t icache;
+    Cache_t dcache;
+    struct Jit *jit;            // translation cache of the functional engine, NULL until used
+    struct TraceWriter *trace;  // open while a pipeline trace is being recorded
+    struct Recorder *recorder;  // open while a replay trace is being recorded
+    struct Ooo *ooo;            // out-of-order core state (--ooo), NULL otherwise
+    struct McCore *core;        // multicore: coherent L1 and LL link of this core, NULL otherwise
+    struct Steady *steady;      // steady-state loop detector (--extrapolate), NULL otherwise
+    Stats_t stats;              // performance counters (pc_exec NULL when disabled)
+    SampleStats_t sample;       // sampled simulation estimate
+    Console_t console;          // program output (SYSCALL), stdout unless redirected
+    IssueStats_t issue;         // dual-issue pairing counters
+    long icache_stall_cycles;   // fetch bubbles waiting for instruction cache misses
+    long dcache_stall_cycles;   // cycles frozen on data cache misses
+    long cycle;
+    long cycle_limit;           // multicore: end of the current quantum (0: none)
+    long instructions;          // completed instructions (nops excluded)
+    int loaded;
+    int finished;
+    int checkpointed;           // 1 once the checkpoint is written, -1 if that failed
+    int exited;                 // program ended with an exit SYSCALL
+    int exit_code;
+    int invalid;                // program stopped at an instruction the simulator does not implement
+} Sim_t;
+
+// Fill cfg with the defaults (pipeline, stall-only, static not-taken, no caches).
+void sim_config_default(SimConfig_t *cfg);
+
+// Allocate a simulator context. Returns NULL on allocation failure.
+Sim_t *sim_create(const SimConfig_t *cfg);
+void sim_destroy(Sim_t *sim);
+
+// Reset the machine and load a program plus the configured data images.
+// Returns number of instructions loaded, -1 on error.
+int sim_load(Sim_t *sim, const char *filename);
+
+// Reset the machine to a checkpoint written by an earlier run (which also
+// holds the program). Returns number of instructions restored, -1 on error.
+int sim_restore(Sim_t *sim, const char *filename);
+
+// Advance one cycle (pipeline, out-of-order core) or one instruction (functional).
+// Returns 1 while the program is running, 0 once it has finished.
+int sim_step(Sim_t *sim);
+
+// Stop the program at the KIND_INVALID instruction instr at pc: report it on
+// stderr and mark the run as failed. Returns 1, so engines can end the
+// program the same way as after an exit SYSCALL.
+int sim_invalid(Sim_t *sim, uint32_t pc, uint32_t instr);
+
+// Run until the program finishes and write any requested counter files.
+// Returns 0 on success, -1 if nothing is loaded, the program stopped at an
+// invalid instruction, or an output file or the requested checkpoint could
+// not be written.
+int sim_run(Sim_t *sim);
+
+// Print the end-of-run summary (cycles, instructions, branch prediction, counters).
+void sim_report(const Sim_t *sim, FILE *out);
+
+#endif // SIM_H
@@ -0,0 +1,322 @@
+/**
+ * simbench.c - Host-throughput benchmark harness: runs each kernel on the
+ * pipeline model and the functional engine, reports simulated MIPS, host ns
+ * per simulated cycle and CPI, and compares the results with a saved baseline.
+ * With --lanes it also compares many copies of a kernel run one after another
+ * against the same copies run in lockstep.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "options.h"
+#include "lanes.h"
+
+#define MAX_BASELINE 256
+#define BENCH_MIN_SECONDS 0.05
+
+// Best-of-N result of one kernel on one engine
+typedef struct {
+    char kernel[64];
+    char engine[16];
+    long instructions;
+    long cycles;        // 0 for the functional engine
+    double seconds;     // host time of the fastest run
+} BenchResult_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double result_mips(const BenchResult_t *r) {
+    return r->seconds > 0 ? r->instructions / r->seconds * 1e-6 : 0.0;
+}
+
+// Kernel name: file name without directory and extension
+static void kernel_name(const char *path, char *name, size_t size) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    snprintf(name, size, "%s", base);
+    char *dot = strrchr(name, '.');
+    if (dot && dot != name) {
+        *dot = '\0';
+    }
+}
+
+// Run a kernel once. Loading is not timed.
+static int run_once(const SimConfig_t *cfg, const char *program, BenchResult_t *r, double *elapsed) {
+    Sim_t *sim = sim_create(cfg);
+    if (!sim) {
+        return -1;
+    }
+    if (sim_load(sim, program) < 0) {
+        sim_destroy(sim);
+        return -1;
+    }
+    double start = now_seconds();
+    int status = sim_run(sim);
+    *elapsed = now_seconds() - start;
+    r->instructions = sim->instructions;
+    r->cycles = cfg->functional ? 0 : sim->cycle;
+    sim_destroy(sim);
+    return status;
+}
+
+// Run copies of a kernel on the functional engine, separately or as the lanes
+// of one lockstep run. Loading is timed, as it is part of each instance.
+static int run_copies(const SimConfig_t *cfg, const char *program, int copies, int lockstep,
+                      BenchResult_t *r, double *elapsed) {
+    double start = now_seconds();
+    r->instructions = 0;
+    r->cycles = 0;
+    if (lockstep) {
+        r->instructions = lanes_run_copies(cfg, program, copies);
+        *elapsed = now_seconds() - start;
+        return r->instructions < 0 ? -1 : 0;
+    }
+    for (int i = 0; i < copies; ++i) {
+        Sim_t *sim = sim_create(cfg);
+        if (!sim || sim_load(sim, program) < 0 || sim_run(sim) < 0) {
+            sim_destroy(sim);
+            return -1;
+        }
+        r->instructions += sim->instructions;
+        sim_destroy(sim);
+    }
+    *elapsed = now_seconds() - start;
+    return 0;
+}
+
+// Time a kernel repeat times and keep the fastest. Each measurement reruns the
+// kernel until BENCH_MIN_SECONDS have passed, so fast engines are not lost in
+// timer noise.
+// copies > 0 measures run_copies instead of a single run.
+static int bench_kernel(const SimConfig_t *cfg, const char *program, int repeat, int copies, int lockstep,
+                        BenchResult_t *r) {
+    r->seconds = 0;
+    for (int i = 0; i < repeat; ++i) {
+        double total = 0, elapsed;
+        int runs = 0;
+        do {
+            int failed = copies ? run_copies(cfg, program, copies, lockstep, r, &elapsed) < 0
+                                : run_once(cfg, program, r, &elapsed) < 0;
+            if (failed) {
+                return -1;
+            }
+            total += elapsed;
+            ++runs;
+        } while (total < BENCH_MIN_SECONDS);
+        if (i == 0 || total / runs < r->seconds) {
+            r->seconds = total / runs;
+        }
+    }
+    return 0;
+}
+
+// Load the results of an earlier --out file. Returns number of rows, -1 on error.
+static int read_baseline(const char *filename, BenchResult_t *rows, int max_rows) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open baseline: %s\n", filename);
+        return -1;
+    }
+    char line[512];
+    int count = 0;
+    while (fgets(line, sizeof(line), file) && count < max_rows) {
+        BenchResult_t *r = &rows[count];
+        double cpi, mips, ns;
+        // kernel,engine,instructions,cycles,cpi,seconds,mips,ns_per_cycle (header skipped)
+        if (sscanf(line, "%63[^,],%15[^,],%ld,%ld,%lf,%lf,%lf,%lf", r->kernel, r->engine,
+                   &r->instructions, &r->cycles, &cpi, &r->seconds, &mips, &ns) == 8) {
+            ++count;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+static const BenchResult_t *find_result(const BenchResult_t *rows, int count, const BenchResult_t *r) {
+    for (int i = 0; i < count; ++i) {
+        if (strcmp(rows[i].kernel, r->kernel) == 0 && strcmp(rows[i].engine, r->engine) == 0) {
+            return &rows[i];
+        }
+    }
+    return NULL;
+}
+
+static int write_results(const char *filename, const BenchResult_t *results, int count) {
+    FILE *out = fopen(filename, "w");
+    if (!out) {
+        fprintf(stderr, "Failed to open benchmark output: %s\n", filename);
+        return -1;
+    }
+    fprintf(out, "kernel,engine,instructions,cycles,cpi,seconds,mips,ns_per_cycle\n");
+    for (int i = 0; i < count; ++i) {
+        const BenchResult_t *r = &results[i];
+        double cpi = r->instructions ? (double)r->cycles / r->instructions : 0.0;
+        double ns = r->cycles ? r->seconds * 1e9 / r->cycles : 0.0;
+        fprintf(out, "%s,%s,%ld,%ld,%.4f,%.6f,%.3f,%.3f\n", r->kernel, r->engine,
+                r->instructions, r->cycles, cpi, r->seconds, result_mips(r), ns);
+    }
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Failed to write benchmark output: %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options] <kernel.bin>...\n", prog);
+    printf("Runs every kernel on the pipeline model (with the given options) and the\n");
+    printf("functional engine, and reports host throughput.\n");
+    options_usage(stdout);
+    printf("  --repeat <n>        runs per kernel and engine, the fastest is kept (default 3)\n");
+    printf("  --out <file.csv>    write the results as CSV\n");
+    printf("  --baseline <file>   compare with the CSV of an earlier run\n");
+    printf("  --threshold <pct>   MIPS drop against the baseline reported as a regression (default 10)\n");
+    printf("  --lanes <n>         also time n copies of each kernel run separately and in lockstep\n");
+}
+
+int main(int argc, char *argv[]) {
+    SimConfig_t cfg;
+    sim_config_default(&cfg);
+    const char *out_file = NULL;
+    const char *baseline_file = NULL;
+    double threshold = 10.0;
+    int repeat = 3;
+    int copies = 0;
+    const char **kernels = malloc(argc * sizeof(*kernels));
+    int num_kernels = 0;
+    if (!kernels) {
+        return 1;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_file = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_file = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) {
+            copies = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+            continue;
+        }
+        int r = options_parse_one(argc, argv, &i, &cfg);
+        if (r < 0) {
+            free(kernels);
+            return 1;
+        }
+        if (r == 0) {
+            if (argv[i][0] == '-') {
+                usage(argv[0]);
+                free(kernels);
+                return 1;
+            }
+            kernels[num_kernels++] = argv[i];
+        }
+    }
+    if (num_kernels == 0 || repeat < 1 || copies < 0) {
+        usage(argv[0]);
+        free(kernels);
+        return 1;
+    }
+    // The functional engine runs with default settings apart from the loading
+    // options and the engine choice
+    SimConfig_t pipe_cfg = cfg;
+    pipe_cfg.functional = 0;
+    SimConfig_t func_cfg;
+    sim_config_default(&func_cfg);
+    func_cfg.functional = 1;
+    func_cfg.no_jit = cfg.no_jit;
+    func_cfg.text_base = cfg.text_base;
+    func_cfg.num_data = cfg.num_data;
+    memcpy(func_cfg.data, cfg.data, sizeof(cfg.data));
+
+    BenchResult_t *baseline = NULL;
+    int num_baseline = 0;
+    if (baseline_file) {
+        baseline = malloc(MAX_BASELINE * sizeof(*baseline));
+        if (!baseline || (num_baseline = read_baseline(baseline_file, baseline, MAX_BASELINE)) < 0) {
+            free(baseline);
+            free(kernels);
+            return 1;
+        }
+    }
+    // pipeline, functional and, with --lanes, separate and lockstep copies
+    static const char *engines[] = { "pipeline", "functional", "separate", "lanes" };
+    int num_engines = copies ? 4 : 2;
+    BenchResult_t *results = calloc((size_t)num_engines * num_kernels, sizeof(*results));
+    if (!results) {
+        free(baseline);
+        free(kernels);
+        return 1;
+    }
+    int count = 0, regressions = 0, status = 0;
+    printf("%-12s %-10s %12s %12s %7s %10s %9s %9s  %s\n", "kernel", "engine",
+           "instructions", "cycles", "CPI", "host ms", "MIPS", "ns/cycle", "vs baseline");
+    for (int k = 0; k < num_kernels && status == 0; ++k) {
+        for (int e = 0; e < num_engines; ++e) {
+            BenchResult_t *r = &results[count];
+            kernel_name(kernels[k], r->kernel, sizeof(r->kernel));
+            snprintf(r->engine, sizeof(r->engine), "%s", engines[e]);
+            if (bench_kernel(e ? &func_cfg : &pipe_cfg, kernels[k], repeat, e >= 2 ? copies : 0, e == 3, r) < 0) {
+                fprintf(stderr, "Benchmark failed: %s\n", kernels[k]);
+                status = -1;
+                break;
+            }
+            ++count;
+            printf("%-12s %-10s %12ld ", r->kernel, r->engine, r->instructions);
+            if (r->cycles) {
+                printf("%12ld %7.3f ", r->cycles, (double)r->cycles / r->instructions);
+            } else {
+                printf("%12s %7s ", "-", "-");
+            }
+            printf("%10.2f %9.2f ", r->seconds * 1e3, result_mips(r));
+            if (r->cycles) {
+                printf("%9.2f", r->seconds * 1e9 / r->cycles);
+            } else {
+                printf("%9s", "-");
+            }
+            const BenchResult_t *base = baseline ? find_result(baseline, num_baseline, r) : NULL;
+            if (base && result_mips(base) > 0) {
+                double change = (result_mips(r) / result_mips(base) - 1.0) * 100.0;
+                printf("  %+6.1f%%", change);
+                if (change < -threshold) {
+                    printf(" REGRESSION");
+                    ++regressions;
+                }
+                if (base->instructions != r->instructions || base->cycles != r->cycles) {
+                    printf(" (simulated counts changed)");
+                }
+            }
+            if (e == 3 && r->seconds > 0) {
+                printf("  %.2fx separate runs of %d", r[-1].seconds / r->seconds, copies);
+            }
+            printf("\n");
+        }
+    }
+    if (status == 0 && out_file && write_results(out_file, results, count) < 0) {
+        status = -1;
+    }
+    if (regressions) {
+        printf("%d result(s) more than %.1f%% slower than the baseline\n", regressions, threshold);
+    }
+    free(results);
+    free(baseline);
+    free(kernels);
+    return (status < 0 || regressions) ? 1 : 0;
+}
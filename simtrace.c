@@ -0,0 +1,85 @@
+/**
+ * simtrace.c - Decoder for binary pipeline traces: prints the pipeline register
+ * contents, events and register writes for a range of cycles.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "trace.h"
+
+static const char *stage_names[4] = { "IF/ID", "ID/EX", "EX/MEM", "MEM/WB" };
+
+// Format the event flags of one cycle as a comma-separated list
+static void format_events(uint8_t flags, char *text, size_t size) {
+    text[0] = '\0';
+    int n = 0;
+    if (flags & TRACE_EV_STALL) {
+        n += snprintf(text + n, size - n, "%sstall", n ? "," : "");
+    }
+    if (flags & TRACE_EV_FLUSH) {
+        n += snprintf(text + n, size - n, "%sflush", n ? "," : "");
+    }
+    if (flags & TRACE_EV_IWAIT) {
+        n += snprintf(text + n, size - n, "%si-miss", n ? "," : "");
+    }
+    if (flags & TRACE_EV_DFREEZE) {
+        n += snprintf(text + n, size - n, "%sd-miss", n ? "," : "");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 4) {
+        printf("Usage: %s <trace.bin> [first_cycle [last_cycle]]\n", argv[0]);
+        return 1;
+    }
+    uint64_t first = (argc > 2) ? strtoull(argv[2], NULL, 0) : 0;
+    uint64_t last = (argc > 3) ? strtoull(argv[3], NULL, 0) : UINT64_MAX;
+    TraceReader_t reader;
+    if (trace_reader_open(&reader, argv[1]) < 0) {
+        return 1;
+    }
+    printf("%10s", "cycle");
+    for (int s = 0; s < 4; ++s) {
+        printf("  %-10s", stage_names[s]);
+    }
+    printf("  %-16s  %s\n", "events", "writeback");
+    TraceCycle_t c;
+    long shown = 0, stalls = 0, flushes = 0, imiss = 0, dmiss = 0;
+    int r;
+    while ((r = trace_reader_next(&reader, &c)) > 0) {
+        if (c.cycle < first) {
+            continue;
+        }
+        if (c.cycle > last) {
+            break;
+        }
+        printf("%10llu", (unsigned long long)c.cycle);
+        for (int s = 0; s < 4; ++s) {
+            if (c.flags & (1u << s)) {
+                printf("  0x%08x", c.pc[s]);
+            } else {
+                printf("  %-10s", "--");
+            }
+        }
+        char events[40];
+        format_events(c.flags, events, sizeof(events));
+        if (c.reg) {
+            printf("  %-16s  $%u = %d\n", events, c.reg, c.value);
+        } else {
+            printf("  %s\n", events);
+        }
+        shown++;
+        stalls += (c.flags & TRACE_EV_STALL) != 0;
+        flushes += (c.flags & TRACE_EV_FLUSH) != 0;
+        imiss += (c.flags & TRACE_EV_IWAIT) != 0;
+        dmiss += (c.flags & TRACE_EV_DFREEZE) != 0;
+    }
+    trace_reader_close(&reader);
+    if (r < 0) {
+        fprintf(stderr, "%s: corrupt trace record\n", argv[1]);
+        return 1;
+    }
+    printf("%ld cycles shown: %ld stall, %ld flush, %ld I-cache wait, %ld D-cache freeze\n",
+           shown, stalls, flushes, imiss, dmiss);
+    return 0;
+}
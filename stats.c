@@ -0,0 +1,310 @@
+/**
+ * stats.c - Performance counter collection and reporting (text, JSON, CSV).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "hazard.h"
+#include "decode.h"
+#include "sim.h"
+#include "dual.h"
+#include "stats.h"
+
+#define STATS_PAIRS_INITIAL 256
+
+int stats_init(Stats_t *s, uint32_t text_base, int count) {
+    memset(s, 0, sizeof(*s));
+    s->text_base = text_base;
+    s->count = count;
+    s->pc_exec = calloc(count > 0 ? count : 1, sizeof(long));
+    s->pc_stall = calloc(count > 0 ? count : 1, sizeof(long));
+    s->pairs = calloc(STATS_PAIRS_INITIAL, sizeof(StallPair_t));
+    s->pair_cap = STATS_PAIRS_INITIAL;
+    if (!s->pc_exec || !s->pc_stall || !s->pairs) {
+        fprintf(stderr, "Failed to allocate performance counters\n");
+        stats_free(s);
+        return -1;
+    }
+    return 0;
+}
+
+void stats_free(Stats_t *s) {
+    free(s->pc_exec);
+    free(s->pc_stall);
+    free(s->pairs);
+    s->pc_exec = NULL;
+    s->pc_stall = NULL;
+    s->pairs = NULL;
+    s->pair_cap = s->pair_used = 0;
+}
+
+static size_t pair_hash(uint32_t consumer, uint32_t producer, size_t cap) {
+    uint64_t key = ((uint64_t)consumer << 32) | producer;
+    key *= 0x9E3779B97F4A7C15ull;
+    return (size_t)(key >> 32) & (cap - 1);
+}
+
+// Find or insert the (consumer, producer) slot; the table stays under 3/4 full
+static StallPair_t *pair_slot(Stats_t *s, uint32_t consumer, uint32_t producer) {
+    if ((s->pair_used + 1) * 4 > s->pair_cap * 3) {
+        StallPair_t *old = s->pairs;
+        size_t old_cap = s->pair_cap;
+        StallPair_t *grown = calloc(old_cap * 2, sizeof(StallPair_t));
+        if (grown) {
+            s->pairs = grown;
+            s->pair_cap = old_cap * 2;
+            for (size_t i = 0; i < old_cap; ++i) {
+                if (old[i].count) {
+                    size_t h = pair_hash(old[i].consumer, old[i].producer, s->pair_cap);
+                    while (s->pairs[h].count) {
+                        h = (h + 1) & (s->pair_cap - 1);
+                    }
+                    s->pairs[h] = old[i];
+                }
+            }
+            free(old);
+        } else if (s->pair_used + 1 == s->pair_cap) {
+            return NULL; // full and cannot grow: drop the sample
+        }
+    }
+    size_t h = pair_hash(consumer, producer, s->pair_cap);
+    while (s->pairs[h].count && (s->pairs[h].consumer != consumer || s->pairs[h].producer != producer)) {
+        h = (h + 1) & (s->pair_cap - 1);
+    }
+    if (!s->pairs[h].count) {
+        s->pairs[h].consumer = consumer;
+        s->pairs[h].producer = producer;
+        s->pair_used++;
+    }
+    return &s->pairs[h];
+}
+
+void stats_stall(Stats_t *s, int source, uint32_t consumer, uint32_t producer) {
+    if (source == HAZARD_IDEX) {
+        s->stall_idex++;
+    } else if (source == HAZARD_EXMEM) {
+        s->stall_exmem++;
+    } else {
+        s->stall_muldiv++;
+    }
+    uint32_t index = (consumer - s->text_base) / 4;
+    if (index < (uint32_t)s->count) {
+        s->pc_stall[index]++;
+    }
+    StallPair_t *pair = pair_slot(s, consumer, producer);
+    if (pair) {
+        pair->count++;
+    }
+}
+
+void stats_cycle(Stats_t *s, const Sim_t *sim) {
+    const Pipeline_t *p = &sim->pipe;
+    s->bubbles[0] += !p->IFID.valid;
+    s->bubbles[1] += !p->IDEX.valid;
+    s->bubbles[2] += !p->EXMEM.valid;
+    s->bubbles[3] += !p->MEMWB.valid;
+    // Both slots retire in dual-issue mode (the second is empty otherwise)
+    const MEMWB_t *wb[2] = { &p->MEMWB, &p->MEMWB2 };
+    for (int i = 0; i < 2; ++i) {
+        if (wb[i]->valid && wb[i]->instr != 0) {
+            uint32_t instr = wb[i]->instr;
+            s->mix[OPCODE(instr) == 0 ? 64 + FUNCT(instr) : OPCODE(instr)]++;
+            uint32_t index = (wb[i]->pc - s->text_base) / 4;
+            if (index < (uint32_t)s->count) {
+                s->pc_exec[index]++;
+            }
+        }
+    }
+}
+
+// Representative instruction word for a mix slot, used to name it
+static uint32_t mix_instr(int slot) {
+    return slot >= 64 ? (uint32_t)(slot - 64) | (1u << 11) : (uint32_t)slot << 26;
+}
+
+static uint32_t instr_at(const Sim_t *sim, uint32_t pc) {
+    return instr_read(&sim->arch, (pc - sim->arch.text_base) / 4);
+}
+
+// Counter value with the slot it came from, for sorting
+typedef struct {
+    long count;
+    int index;
+} Ranked_t;
+
+// qsort helpers: descending count order
+static int cmp_ranked_desc(const void *a, const void *b) {
+    long ka = ((const Ranked_t *)a)->count, kb = ((const Ranked_t *)b)->count;
+    return (ka < kb) - (ka > kb);
+}
+
+// Non-zero entries of counts sorted by count. Returns a malloc'd array (may be NULL).
+static Ranked_t *rank(const long *counts, int size, int *n) {
+    Ranked_t *out = malloc((size > 0 ? size : 1) * sizeof(Ranked_t));
+    *n = 0;
+    if (!out) {
+        return NULL;
+    }
+    for (int i = 0; i < size; ++i) {
+        if (counts[i]) {
+            out[*n].count = counts[i];
+            out[*n].index = i;
+            (*n)++;
+        }
+    }
+    qsort(out, *n, sizeof(Ranked_t), cmp_ranked_desc);
+    return out;
+}
+
+static int cmp_pair_desc(const void *a, const void *b) {
+    long ka = ((const StallPair_t *)a)->count, kb = ((const StallPair_t *)b)->count;
+    return (ka < kb) - (ka > kb);
+}
+
+// Non-empty pair slots sorted by count. Returns a malloc'd array (may be NULL).
+static StallPair_t *sorted_pairs(const Stats_t *s, size_t *n) {
+    StallPair_t *out = malloc((s->pair_used ? s->pair_used : 1) * sizeof(StallPair_t));
+    *n = 0;
+    if (!out) {
+        return NULL;
+    }
+    for (size_t i = 0; i < s->pair_cap; ++i) {
+        if (s->pairs[i].count) {
+            out[(*n)++] = s->pairs[i];
+        }
+    }
+    qsort(out, *n, sizeof(StallPair_t), cmp_pair_desc);
+    return out;
+}
+
+void stats_report(const Sim_t *sim, FILE *out) {
+    const Stats_t *s = &sim->stats;
+    long stalls = s->stall_idex + s->stall_exmem + s->stall_muldiv;
+    fprintf(out, "Performance counters:\n");
+    fprintf(out, "  CPI %.3f (%ld cycles, %ld instructions)\n",
+            sim->instructions ? (double)sim->cycle / (double)sim->instructions : 0.0,
+            sim->cycle, sim->instructions);
+    fprintf(out, "  Data hazard stalls: %ld cycles (producer in EX %ld, in MEM %ld, mul/div unit %ld)\n",
+            stalls, s->stall_idex, s->stall_exmem, s->stall_muldiv);
+    fprintf(out, "  Control flush cycles: %ld\n", sim->bp.flush_cycles);
+    fprintf(out, "  Memory stalls: %ld I-cache cycles, %ld D-cache cycles\n",
+            sim->icache_stall_cycles, sim->dcache_stall_cycles);
+    fprintf(out, "  Bubbles: IF/ID %ld, ID/EX %ld, EX/MEM %ld, MEM/WB %ld\n",
+            s->bubbles[0], s->bubbles[1], s->bubbles[2], s->bubbles[3]);
+    // Instruction mix, most frequent first
+    int n_mix;
+    Ranked_t *mix = rank(s->mix, STATS_MIX_SIZE, &n_mix);
+    fprintf(out, "  Instruction mix:");
+    for (int i = 0; mix && i < n_mix; ++i) {
+        fprintf(out, "%s %s %ld (%.1f%%)", i ? "," : "", decode_name(mix_instr(mix[i].index)),
+                mix[i].count, 100.0 * (double)mix[i].count / (double)sim->instructions);
+    }
+    fprintf(out, "\n");
+    free(mix);
+    // Hottest stall sites
+    int n_pcs;
+    Ranked_t *pcs = rank(s->pc_stall, s->count, &n_pcs);
+    if (pcs && n_pcs) {
+        fprintf(out, "  Top stall sites (pc, instruction, executed, stall cycles):\n");
+        for (int i = 0; i < n_pcs && i < STATS_TOP; ++i) {
+            uint32_t pc = s->text_base + (uint32_t)pcs[i].index * 4;
+            fprintf(out, "    0x%08x  %-8s %10ld %10ld\n", pc, decode_name(instr_at(sim, pc)),
+                    s->pc_exec[pcs[i].index], pcs[i].count);
+        }
+    }
+    free(pcs);
+    size_t n;
+    StallPair_t *pairs = sorted_pairs(s, &n);
+    if (pairs && n) {
+        fprintf(out, "  Top stall pairs (consumer <- producer: cycles):\n");
+        for (size_t i = 0; i < n && i < STATS_TOP; ++i) {
+            fprintf(out, "    0x%08x %-8s <- 0x%08x %-8s %10ld\n",
+                    pairs[i].consumer, decode_name(instr_at(sim, pairs[i].consumer)),
+                    pairs[i].producer, decode_name(instr_at(sim, pairs[i].producer)), pairs[i].count);
+        }
+    }
+    free(pairs);
+}
+
+int stats_write_json(const Sim_t *sim, const char *filename) {
+    const Stats_t *s = &sim->stats;
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, "Failed to create counter file: %s\n", filename);
+        return -1;
+    }
+    fprintf(f, "{\n  \"cycles\": %ld,\n  \"instructions\": %ld,\n", sim->cycle, sim->instructions);
+    fprintf(f, "  \"cpi\": %.6f,\n",
+            sim->instructions ? (double)sim->cycle / (double)sim->instructions : 0.0);
+    fprintf(f, "  \"stalls\": {\"data_idex\": %ld, \"data_exmem\": %ld, \"muldiv\": %ld, "
+            "\"flush\": %ld, \"icache\": %ld, \"dcache\": %ld},\n", s->stall_idex, s->stall_exmem,
+            s->stall_muldiv, sim->bp.flush_cycles, sim->icache_stall_cycles, sim->dcache_stall_cycles);
+    fprintf(f, "  \"bubbles\": {\"ifid\": %ld, \"idex\": %ld, \"exmem\": %ld, \"memwb\": %ld},\n",
+            s->bubbles[0], s->bubbles[1], s->bubbles[2], s->bubbles[3]);
+    fprintf(f, "  \"branches\": {\"branches\": %ld, \"jumps\": %ld, \"mispredicts\": %ld},\n",
+            sim->bp.branches, sim->bp.jumps, sim->bp.mispredicts);
+    if (sim->config.dual_issue) {
+        fprintf(f, "  \"issue\": {\"cycles\": %ld, \"dual\": %ld", sim->issue.issue_cycles,
+                sim->issue.dual_issues);
+        for (int i = SPLIT_ALONE; i < SPLIT_COUNT; ++i) {
+            fprintf(f, ", \"%s\": %ld", dual_split_name(i), sim->issue.split[i]);
+        }
+        fprintf(f, "},\n");
+    }
+    fprintf(f, "  \"mix\": {");
+    int first = 1;
+    for (int i = 0; i < STATS_MIX_SIZE; ++i) {
+        if (s->mix[i]) {
+            fprintf(f, "%s\"%s\": %ld", first ? "" : ", ", decode_name(mix_instr(i)), s->mix[i]);
+            first = 0;
+        }
+    }
+    fprintf(f, "},\n  \"pcs\": [");
+    first = 1;
+    for (int i = 0; i < s->count; ++i) {
+        if (s->pc_exec[i] || s->pc_stall[i]) {
+            uint32_t pc = s->text_base + (uint32_t)i * 4;
+            fprintf(f, "%s\n    {\"pc\": %u, \"instr\": \"%s\", \"executed\": %ld, \"stalls\": %ld}",
+                    first ? "" : ",", pc, decode_name(instr_read(&sim->arch, i)),
+                    s->pc_exec[i], s->pc_stall[i]);
+            first = 0;
+        }
+    }
+    fprintf(f, "\n  ],\n  \"stall_pairs\": [");
+    size_t n;
+    StallPair_t *pairs = sorted_pairs(s, &n);
+    for (size_t i = 0; pairs && i < n; ++i) {
+        fprintf(f, "%s\n    {\"consumer\": %u, \"producer\": %u, \"cycles\": %ld}",
+                i ? "," : "", pairs[i].consumer, pairs[i].producer, pairs[i].count);
+    }
+    free(pairs);
+    fprintf(f, "\n  ]\n}\n");
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Failed to write counter file: %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+int stats_write_csv(const Sim_t *sim, const char *filename) {
+    const Stats_t *s = &sim->stats;
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, "Failed to create counter file: %s\n", filename);
+        return -1;
+    }
+    fprintf(f, "pc,instr,mnemonic,executed,stall_cycles\n");
+    for (int i = 0; i < s->count; ++i) {
+        if (s->pc_exec[i] || s->pc_stall[i]) {
+            uint32_t instr = instr_read(&sim->arch, i);
+            fprintf(f, "0x%08x,0x%08x,%s,%ld,%ld\n", s->text_base + (uint32_t)i * 4, instr,
+                    decode_name(instr), s->pc_exec[i], s->pc_stall[i]);
+        }
+    }
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Failed to write counter file: %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
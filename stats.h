@@ -0,0 +1,56 @@
+/**
+ * stats.h - Pipeline performance counters: stall breakdown, bubbles, instruction mix, per-PC hotspots.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define STATS_MIX_SIZE 128  /* opcodes 0-63, then R-type functs at 64 + funct */
+#define STATS_TOP 10        /* rows in the human summary tables */
+
+// Stall cycles of the instruction at consumer waiting on the one at producer
+typedef struct {
+    uint32_t consumer;
+    uint32_t producer;
+    long count;
+} StallPair_t;
+
+typedef struct {
+    long stall_idex;            // data hazard stall cycles on a producer in EX
+    long stall_exmem;           // data hazard stall cycles on a producer in MEM
+    long stall_muldiv;          // stall cycles waiting for the multiply/divide unit
+    long bubbles[4];            // cycles IFID, IDEX, EXMEM, MEMWB held a bubble
+    long mix[STATS_MIX_SIZE];   // completed instructions by opcode/funct
+    uint32_t text_base;
+    int count;                  // instructions covered by the per-PC arrays
+    long *pc_exec;              // completions per instruction address
+    long *pc_stall;             // ID stall cycles per instruction address
+    StallPair_t *pairs;         // open-addressing table keyed by (consumer, producer)
+    size_t pair_cap;
+    size_t pair_used;
+} Stats_t;
+
+struct Sim;
+
+// Allocate per-PC counters for count instructions at text_base. Returns 0 or -1.
+int stats_init(Stats_t *s, uint32_t text_base, int count);
+void stats_free(Stats_t *s);
+
+// Account one data hazard stall cycle of the ID instruction at consumer whose
+// producer sits in the pipeline register given by source (a HazardSource).
+void stats_stall(Stats_t *s, int source, uint32_t consumer, uint32_t producer);
+
+// Account the end-of-cycle pipeline contents (bubbles, completed instruction).
+void stats_cycle(Stats_t *s, const struct Sim *sim);
+
+// Human readable summary.
+void stats_report(const struct Sim *sim, FILE *out);
+
+// Machine readable output. Return 0 on success, -1 if the file cannot be written.
+int stats_write_json(const struct Sim *sim, const char *filename);
+int stats_write_csv(const struct Sim *sim, const char *filename);
+
+#endif // STATS_H
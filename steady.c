@@ -0,0 +1,366 @@
+/**
+ * steady.c - Steady-state loop detection with cycle extrapolation.
+ *
+ * An iteration boundary is the retirement (entry into MEM/WB) of a loop head,
+ * the target of a backward branch or jump. The timing of the cycles after a
+ * boundary depends only on the pipeline's structure (which PCs occupy the
+ * stages, stall and fetch state), the predictor and the path the program
+ * takes, never on data values. So once two consecutive boundaries show the
+ * same structure and predictor, every later iteration that follows the same
+ * path takes the same cycles and ends in the same state again. Those
+ * iterations run on the functional path instead; the pipeline registers'
+ * data values are rebuilt from the architectural state afterwards.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "alu.h"
+#include "decode.h"
+#include "branch.h"
+#include "functional.h"
+#include "sim.h"
+#include "steady.h"
+
+#define STEADY_MAX_PATH 4096    /* longest iteration (instructions) considered */
+#define STEADY_LOOKAHEAD 4      /* instructions past an iteration that must follow the
+                                   path too: the pipeline has fetched them by its end */
+#define STEADY_MAX_BACKOFF 1024 /* most boundaries ignored after fast-forwards that skip nothing */
+#define SIG_WORDS 19
+
+// Detector phase at the last boundary
+enum SteadyPhase {
+    WATCH_NONE = 0,     /* no reference boundary */
+    WATCH_REPEAT,       /* reference structure recorded */
+    WATCH_CONFIRM       /* structure repeated; predictor and counters recorded */
+};
+
+// Old contents of a location written on the functional path
+typedef struct {
+    uint32_t address;
+    int size;
+    int32_t old;
+} StoreUndo_t;
+
+// Enough to take back one functionally executed iteration
+typedef struct {
+    int32_t regs[NUM_REGS];
+    int32_t hi, lo;
+    StoreUndo_t *stores;
+    int count;
+    int capacity;
+} Undo_t;
+
+struct Steady {
+    int phase;
+    int have_anchor;
+    uint32_t anchor;            // loop head whose retirement is a boundary
+    uint32_t candidate;         // other backward target seen since the last boundary
+    int have_candidate;
+    uint32_t last_pc;           // PC that last entered MEM/WB
+    uint32_t sig[SIG_WORDS];    // pipeline structure at the last boundary
+    long cycle;                 // counters at the last boundary
+    long instructions;
+    BranchPredictor_t bp;       // predictor at the last boundary (WATCH_CONFIRM)
+    uint32_t *path;             // PCs retired since the last boundary
+    int path_len;
+    int backoff;                // boundaries to ignore after the next fruitless fast-forward
+    int skip;                   // boundaries still ignored
+    Undo_t undo[2];
+    long loops;                 // fast-forwards that skipped iterations
+    long iterations;
+    long cycles;
+};
+
+Steady_t *steady_create(void) {
+    Steady_t *s = calloc(1, sizeof(*s));
+    if (s) {
+        s->path = malloc(STEADY_MAX_PATH * sizeof(*s->path));
+    }
+    if (!s || !s->path) {
+        fprintf(stderr, "Failed to allocate loop detector\n");
+        steady_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void steady_free(Steady_t *s) {
+    if (!s) {
+        return;
+    }
+    free(s->undo[0].stores);
+    free(s->undo[1].stores);
+    free(s->path);
+    free(s);
+}
+
+// Everything about the pipeline that is not a data value
+static void pipe_signature(const Pipeline_t *p, uint32_t sig[SIG_WORDS]) {
+    uint32_t w[SIG_WORDS] = {
+        p->IFID.valid, p->IFID.pc, p->IFID.pred_taken, p->IFID.pred_target,
+        p->IDEX.valid, p->IDEX.pc, p->IDEX.pred_taken, p->IDEX.pred_target,
+        p->EXMEM.valid, p->EXMEM.pc, p->MEMWB.valid, p->MEMWB.pc,
+        p->PC, p->fetch_enable, p->fetch_ready, (uint32_t)p->fetch_wait,
+        (uint32_t)p->mem_stall, p->draining, (uint32_t)p->md_busy
+    };
+    memcpy(sig, w, sizeof(w));
+}
+
+// Predictor tables and history equal (the counters are not state)
+static int bp_same(const BranchPredictor_t *a, const BranchPredictor_t *b) {
+    if (a->history != b->history || memcmp(a->pht, b->pht, sizeof(a->pht)) != 0) {
+        return 0;
+    }
+    for (int i = 0; i < BTB_SIZE; ++i) {
+        const BTBEntry_t *x = &a->btb[i];
+        const BTBEntry_t *y = &b->btb[i];
+        if (x->valid != y->valid ||
+            (x->valid && (x->is_jump != y->is_jump || x->pc != y->pc || x->target != y->target))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static const DecodedInst_t *decoded_at(const Sim_t *sim, uint32_t pc) {
+    return &sim->decoded[(pc - sim->arch.text_base) >> 2];
+}
+
+static int log_store(Undo_t *u, ArchState_t *st, uint32_t address, int size) {
+    if (u->count == u->capacity) {
+        int capacity = u->capacity ? 2 * u->capacity : 64;
+        StoreUndo_t *stores = realloc(u->stores, capacity * sizeof(*stores));
+        if (!stores) {
+            return -1;
+        }
+        u->stores = stores;
+        u->capacity = capacity;
+    }
+    StoreUndo_t *e = &u->stores[u->count++];
+    e->address = address;
+    e->size = size;
+    e->old = mem_read_sized(st, address, size, 0);
+    return 0;
+}
+
+// Take back one iteration: restore its stores newest first, then the registers
+static void undo_iteration(const Undo_t *u, ArchState_t *st, int32_t *regs) {
+    for (int i = u->count - 1; i >= 0; --i) {
+        mem_write_sized(st, u->stores[i].address, u->stores[i].size, u->stores[i].old);
+    }
+    memcpy(regs, u->regs, sizeof(u->regs));
+    st->hi = u->hi;
+    st->lo = u->lo;
+}
+
+// Run iterations of the recorded path functionally from the boundary, where
+// everything up to the instruction in MEM/WB has completed. An iteration
+// counts once it and the STEADY_LOOKAHEAD instructions after it followed the
+// path; the state is left at the boundary after the last counted one.
+// Returns the iterations counted.
+static long run_iterations(Sim_t *sim, Steady_t *s, int32_t *regs, int unroll) {
+    ArchState_t *st = &sim->arch;
+    const MEMWB_t *wb = &sim->pipe.MEMWB;
+    memcpy(regs, st->registers, NUM_REGS * sizeof(*regs));
+    if (wb->regWrite) {
+        regs[wb->destReg] = wb->write_val;
+    }
+    regs[0] = 0;
+    int n = s->path_len * unroll;
+    long counted = 0;
+    int pending = 0;    // the previous iteration still waits for its lookahead
+    int cur = 0;
+    uint32_t pc = s->path[0];
+    for (;;) {
+        Undo_t *u = &s->undo[cur];
+        memcpy(u->regs, regs, sizeof(u->regs));
+        u->hi = st->hi;
+        u->lo = st->lo;
+        u->count = 0;
+        int i = 0;
+        int j = 0;      // i modulo the path length
+        for (; i < n; ++i) {
+            if (pc != s->path[j]) {
+                break;
+            }
+            const DecodedInst_t *d = decoded_at(sim, pc);
+            if (d->memWrite && log_store(u, st, (uint32_t)(regs[d->srcA] + d->imm), d->memSize) < 0) {
+                break;
+            }
+            pc = functional_exec_inst(sim, regs, d, pc);
+            if (++j == s->path_len) {
+                j = 0;
+            }
+        }
+        if (i == n) {
+            counted += pending;
+            pending = 1;
+            cur ^= 1;
+            continue;
+        }
+        // Left the path: go back to the last boundary whose iteration counts
+        undo_iteration(u, st, regs);
+        if (pending) {
+            if (i >= STEADY_LOOKAHEAD) {
+                counted++;
+            } else {
+                undo_iteration(&s->undo[cur ^ 1], st, regs);
+            }
+        }
+        return counted;
+    }
+}
+
+// Rebuild the data values held by the pipeline registers at a boundary from
+// the architectural state, in which everything up to the instruction in
+// MEM/WB has completed. Values that the forwarding unit replaces before they
+// are used get their program-order values, which are equivalent.
+static void rebuild_latches(Sim_t *sim, const int32_t *regs) {
+    Pipeline_t *p = &sim->pipe;
+    ArchState_t *st = &sim->arch;
+    if (p->MEMWB.valid && p->MEMWB.regWrite && p->MEMWB.destReg) {
+        p->MEMWB.write_val = regs[p->MEMWB.destReg];
+    }
+    if (p->EXMEM.valid) {
+        const DecodedInst_t *d = decoded_at(sim, p->EXMEM.pc);
+        int32_t a = d->hilo ? (d->hilo == 1 ? st->hi : st->lo) : regs[d->srcA];
+        int32_t b = regs[d->srcB];
+        if (d->jump) {
+            p->EXMEM.alu_result = d->regWrite ? (int32_t)(p->EXMEM.pc + 4) : 0;
+        } else {
+            p->EXMEM.alu_result = alu_execute(d->ALUop, a, d->useImm ? d->imm : b);
+        }
+        p->EXMEM.store_val = d->memWrite ? b : 0;
+        // HI/LO are written in EX
+        if (d->muldiv) {
+            alu_muldiv(d->muldiv, a, b, &st->hi, &st->lo);
+        }
+    }
+    if (p->IDEX.valid) {
+        const DecodedInst_t *d = decoded_at(sim, p->IDEX.pc);
+        p->IDEX.rs_val = d->hilo ? (d->hilo == 1 ? st->hi : st->lo) : regs[d->srcA];
+        p->IDEX.rt_val = regs[d->srcB];
+    }
+}
+
+// The structure and predictor repeated over the recorded iteration: skip
+// iterations that follow the same path. Returns the iterations skipped.
+static long fast_forward(Sim_t *sim, Steady_t *s) {
+    long cycles = sim->cycle - s->cycle;
+    long instructions = sim->instructions - s->instructions;
+    BranchPredictor_t *bp = &sim->bp;
+    long branches = bp->branches - s->bp.branches;
+    long jumps = bp->jumps - s->bp.jumps;
+    long mispredicts = bp->mispredicts - s->bp.mispredicts;
+    long flush_cycles = bp->flush_cycles - s->bp.flush_cycles;
+    // Iterations shorter than the lookahead are taken several at a time
+    int unroll = (STEADY_LOOKAHEAD + s->path_len - 1) / s->path_len;
+    int32_t regs[NUM_REGS];
+    long n = run_iterations(sim, s, regs, unroll) * unroll;
+    if (n == 0) {
+        return 0;
+    }
+    memcpy(sim->arch.registers, regs, sizeof(regs));
+    sim->arch.registers[0] = 0;
+    rebuild_latches(sim, regs);
+    sim->cycle += n * cycles;
+    sim->instructions += n * instructions;
+    bp->branches += n * branches;
+    bp->jumps += n * jumps;
+    bp->mispredicts += n * mispredicts;
+    bp->flush_cycles += n * flush_cycles;
+    s->loops++;
+    s->iterations += n;
+    s->cycles += n * cycles;
+    return n;
+}
+
+static int path_has_syscall(const Sim_t *sim, const Steady_t *s) {
+    for (int i = 0; i < s->path_len; ++i) {
+        if (decoded_at(sim, s->path[i])->syscall) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void boundary(Sim_t *sim, Steady_t *s) {
+    uint32_t sig[SIG_WORDS];
+    pipe_signature(&sim->pipe, sig);
+    int same = s->phase != WATCH_NONE && s->path_len <= STEADY_MAX_PATH &&
+               memcmp(sig, s->sig, sizeof(sig)) == 0;
+    if (same && s->phase == WATCH_CONFIRM && bp_same(&sim->bp, &s->bp) &&
+        !path_has_syscall(sim, s)) {
+        // SYSCALLs have effects that cannot be taken back. Loops whose path
+        // keeps changing (data-dependent trip counts) get fewer attempts.
+        if (fast_forward(sim, s) > 0) {
+            s->backoff = 0;
+        } else {
+            s->skip = s->backoff;
+            s->backoff = s->backoff ? 2 * s->backoff : 1;
+            if (s->backoff > STEADY_MAX_BACKOFF) {
+                s->backoff = STEADY_MAX_BACKOFF;
+            }
+        }
+        s->phase = WATCH_NONE;
+    } else if (same) {
+        s->phase = WATCH_CONFIRM;
+        s->bp = sim->bp;
+    } else {
+        s->phase = WATCH_REPEAT;
+    }
+    memcpy(s->sig, sig, sizeof(sig));
+    s->cycle = sim->cycle;
+    s->instructions = sim->instructions;
+    s->path_len = 0;
+}
+
+void steady_cycle(Sim_t *sim) {
+    Steady_t *s = sim->steady;
+    const Pipeline_t *p = &sim->pipe;
+    if (!p->MEMWB.valid) {
+        return;
+    }
+    uint32_t pc = p->MEMWB.pc;
+    int backward = (pc <= s->last_pc);
+    s->last_pc = pc;
+    if (s->path_len < STEADY_MAX_PATH) {
+        s->path[s->path_len] = pc;
+    }
+    if (s->path_len <= STEADY_MAX_PATH) {
+        s->path_len++;
+    }
+    if (!backward) {
+        return;
+    }
+    if (s->have_anchor && pc == s->anchor) {
+        s->have_candidate = 0;
+        if (s->skip > 0) {
+            s->skip--;
+            s->path_len = 0;
+        } else {
+            boundary(sim, s);
+        }
+    } else if (!s->have_anchor || (s->have_candidate && pc == s->candidate)) {
+        // Another loop head came round twice without the current one: the
+        // program has moved on to that loop
+        s->anchor = pc;
+        s->have_anchor = 1;
+        s->have_candidate = 0;
+        s->phase = WATCH_NONE;
+        s->backoff = 0;
+        s->skip = 0;
+        boundary(sim, s);
+    } else {
+        // A call to an earlier function, or an outer loop
+        s->candidate = pc;
+        s->have_candidate = 1;
+    }
+}
+
+void steady_report(const Sim_t *sim, FILE *out) {
+    const Steady_t *s = sim->steady;
+    fprintf(out, "Steady-state loops: %ld fast-forwarded, %ld iterations (%ld cycles) extrapolated\n",
+            s->loops, s->iterations, s->cycles);
+}
@@ -0,0 +1,27 @@
+/**
+ * steady.h - Steady-state loop detection for the pipeline model: once a
+ * loop's pipeline state repeats from one iteration to the next, its remaining
+ * iterations run on the functional path and their cycles are added from the
+ * measured iteration, so the totals match a full detailed run.
+ */
+#ifndef STEADY_H
+#define STEADY_H
+
+#include <stdio.h>
+
+struct Sim;
+
+typedef struct Steady Steady_t;
+
+// Allocate the loop detector (--extrapolate). Returns NULL on allocation failure.
+Steady_t *steady_create(void);
+void steady_free(Steady_t *s);
+
+// Called at the end of every pipeline cycle; may advance the simulation by
+// whole loop iterations.
+void steady_cycle(struct Sim *sim);
+
+// Print what was extrapolated.
+void steady_report(const struct Sim *sim, FILE *out);
+
+#endif // STEADY_H
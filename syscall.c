@@ -0,0 +1,102 @@
+/**
+ * syscall.c - SYSCALL services shared by the pipeline and functional engines.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "sim.h"
+#include "syscall.h"
+
+void console_init(Console_t *c, FILE *out) {
+    memset(c, 0, sizeof(*c));
+    c->out = out;
+}
+
+void console_free(Console_t *c) {
+    free(c->buf);
+    c->buf = NULL;
+    c->len = 0;
+    c->cap = 0;
+}
+
+int console_flush(Console_t *c) {
+    if (c->len == 0) {
+        return 0;
+    }
+    size_t len = c->len;
+    c->len = 0;
+    size_t written = fwrite(c->buf, 1, len, c->out);
+    if (fflush(c->out) != 0 || written != len) {
+        return -1;
+    }
+    return 0;
+}
+
+// Append n bytes, growing the buffer; very large output is written out early
+static void console_write(Console_t *c, const char *text, size_t n) {
+    if (c->len + n > c->cap) {
+        size_t cap = c->cap ? c->cap : 4096;
+        while (cap < c->len + n) {
+            cap *= 2;
+        }
+        char *buf = realloc(c->buf, cap);
+        if (!buf) {
+            // Out of memory: write straight through
+            console_flush(c);
+            fwrite(text, 1, n, c->out);
+            return;
+        }
+        c->buf = buf;
+        c->cap = cap;
+    }
+    memcpy(c->buf + c->len, text, n);
+    c->len += n;
+    if (c->len >= CONSOLE_FLUSH_SIZE) {
+        console_flush(c);
+    }
+}
+
+int syscall_exec(struct Sim *sim, uint32_t pc, int32_t v0, int32_t a0, int32_t *v0_out) {
+    Console_t *con = &sim->console;
+    char text[16];
+    *v0_out = v0;
+    switch (v0) {
+        case SYS_PRINT_INT:
+            console_write(con, text, (size_t)snprintf(text, sizeof(text), "%d", a0));
+            break;
+        case SYS_PRINT_STRING:
+            for (uint32_t address = (uint32_t)a0;; ++address) {
+                char ch = (char)mem_read_byte(&sim->arch, address);
+                if (ch == '\0') {
+                    break;
+                }
+                console_write(con, &ch, 1);
+            }
+            break;
+        case SYS_PRINT_CHAR:
+            text[0] = (char)a0;
+            console_write(con, text, 1);
+            break;
+        case SYS_READ_INT: {
+            // Show any prompt before blocking on input
+            console_flush(con);
+            int value = 0;
+            if (scanf("%d", &value) != 1) {
+                value = 0;
+            }
+            *v0_out = value;
+            break;
+        }
+        case SYS_EXIT:
+        case SYS_EXIT2:
+            sim->exited = 1;
+            sim->exit_code = (v0 == SYS_EXIT2) ? a0 : 0;
+            console_flush(con);
+            return 1;
+        default:
+            fprintf(stderr, "Unsupported syscall %d at 0x%08x ignored\n", v0, pc);
+            break;
+    }
+    return 0;
+}
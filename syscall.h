@@ -0,0 +1,45 @@
+/**
+ * syscall.h - SYSCALL emulation (SPIM-style services) and the buffered console.
+ */
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONSOLE_FLUSH_SIZE (1u << 20)   /* buffered output written out early past this size */
+
+// Service number passed in $v0
+enum SyscallCode {
+    SYS_PRINT_INT = 1,      /* print $a0 as a signed decimal */
+    SYS_PRINT_STRING = 4,   /* print the NUL-terminated string at $a0 */
+    SYS_READ_INT = 5,       /* read a decimal integer from stdin into $v0 */
+    SYS_EXIT = 10,          /* stop the program */
+    SYS_PRINT_CHAR = 11,    /* print the low byte of $a0 */
+    SYS_EXIT2 = 17          /* stop the program with exit code $a0 */
+};
+
+// Program console output, collected in one host buffer and written to out
+// when the program exits, reads input, or the buffer grows past CONSOLE_FLUSH_SIZE
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    FILE *out;
+} Console_t;
+
+void console_init(Console_t *c, FILE *out);
+void console_free(Console_t *c);
+
+// Write buffered output to the console stream. Returns 0, or -1 on a write error.
+int console_flush(Console_t *c);
+
+struct Sim;
+
+// Execute the SYSCALL at pc with the given $v0/$a0 values. Stores the new $v0
+// in *v0_out (unchanged unless the service returns a value). Returns 1 if the
+// program asked to exit, 0 otherwise.
+int syscall_exec(struct Sim *sim, uint32_t pc, int32_t v0, int32_t a0, int32_t *v0_out);
+
+#endif // SYSCALL_H
@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Minimal MIPS32 assembler for simulator test programs.
+
+Outputs a raw big-endian text image and, optionally, a raw data image
+(little-endian words, matching the simulator's data memory layout).
+"""
+import argparse
+import re
+import struct
+import sys
+
+REGS = {
+    'zero': 0, 'at': 1, 'v0': 2, 'v1': 3, 'a0': 4, 'a1': 5, 'a2': 6, 'a3': 7,
+    't0': 8, 't1': 9, 't2': 10, 't3': 11, 't4': 12, 't5': 13, 't6': 14, 't7': 15,
+    's0': 16, 's1': 17, 's2': 18, 's3': 19, 's4': 20, 's5': 21, 's6': 22, 's7': 23,
+    't8': 24, 't9': 25, 'k0': 26, 'k1': 27, 'gp': 28, 'sp': 29, 'fp': 30, 'ra': 31,
+}
+
+R3 = {'add': 0x20, 'addu': 0x21, 'sub': 0x22, 'subu': 0x23, 'and': 0x24,
+      'or': 0x25, 'xor': 0x26, 'nor': 0x27, 'slt': 0x2A}
+SHIFT = {'sll': 0x00, 'srl': 0x02}
+MULDIV = {'mult': 0x18, 'multu': 0x19, 'div': 0x1A, 'divu': 0x1B}
+MF = {'mfhi': 0x10, 'mflo': 0x12}
+IMM = {'addi': 0x08, 'addiu': 0x09, 'slti': 0x0A,
+       'andi': 0x0C, 'ori': 0x0D, 'xori': 0x0E}
+MEM = {'lb': 0x20, 'lh': 0x21, 'lw': 0x23, 'lbu': 0x24, 'lhu': 0x25,
+       'sb': 0x28, 'sh': 0x29, 'sw': 0x2B, 'll': 0x30, 'sc': 0x38}
+BR = {'beq': 0x04, 'bne': 0x05}
+# MIPS32 instructions the simulator does not decode: rejected, since the
+# program would assemble and then compute wrong results
+UNSUPPORTED = {'sltu', 'sllv', 'srlv', 'srav', 'sra', 'sltiu',
+               'blez', 'bgtz', 'bltz', 'bgez', 'jalr', 'mul'}
+
+
+def reg(tok):
+    tok = tok.strip().lstrip('$')
+    if tok.isdigit():
+        return int(tok)
+    return REGS[tok]
+
+
+def num(tok, labels=None):
+    tok = tok.strip()
+    if labels is not None and tok in labels:
+        return labels[tok]
+    return int(tok, 0)
+
+
+def split_ops(s):
+    return [x.strip() for x in s.split(',')] if s.strip() else []
+
+
+def parse_mem(op):
+    m = re.match(r'(.*)\((.*)\)', op)
+    if not m:
+        raise ValueError('bad memory operand ' + op)
+    off = m.group(1).strip() or '0'
+    return off, reg(m.group(2))
+
+
+def expand(mn, ops):
+    """Return number of words a (pseudo) instruction expands to."""
+    if mn == 'li':
+        v = num(ops[1])
+        return 1 if -32768 <= v <= 65535 else 2
+    if mn == 'la':
+        return 2
+    if mn in ('blt', 'bgt', 'ble', 'bge'):
+        return 2
+    return 1
+
+
+def assemble(src, text_base, data_base):
+    lines = []
+    for raw in src.splitlines():
+        line = raw.split('#', 1)[0].strip()
+        if line:
+            lines.append(line)
+    labels = {}
+    seg = 'text'
+    pc = {'text': text_base, 'data': data_base}
+    items = []  # (seg, addr, kind, payload)
+    for line in lines:
+        while True:
+            m = re.match(r'^([A-Za-z_.][\w.]*)\s*:\s*(.*)$', line)
+            if not m:
+                break
+            labels[m.group(1)] = pc[seg]
+            line = m.group(2).strip()
+        if not line:
+            continue
+        parts = line.split(None, 1)
+        mn = parts[0].lower()
+        rest = parts[1] if len(parts) > 1 else ''
+        if mn == '.text':
+            seg = 'text'
+        elif mn == '.data':
+            seg = 'data'
+        elif mn in ('.globl', '.global', '.ent', '.end', '.set'):
+            pass
+        elif mn == '.align':
+            a = 1 << int(rest)
+            pc[seg] = (pc[seg] + a - 1) & ~(a - 1)
+        elif mn == '.space':
+            items.append((seg, pc[seg], 'bytes', bytes(int(rest, 0))))
+            pc[seg] += int(rest, 0)
+        elif mn == '.word':
+            vals = split_ops(rest)
+            items.append((seg, pc[seg], 'words', vals))
+            pc[seg] += 4 * len(vals)
+        elif mn in ('.asciiz', '.ascii'):
+            s = bytes(rest.strip()[1:-1], 'utf-8').decode('unicode_escape').encode('latin-1')
+            if mn == '.asciiz':
+                s += b'\0'
+            items.append((seg, pc[seg], 'bytes', s))
+            pc[seg] += len(s)
+        elif mn == '.byte':
+            s = bytes([num(v) & 0xFF for v in split_ops(rest)])
+            items.append((seg, pc[seg], 'bytes', s))
+            pc[seg] += len(s)
+        elif mn in UNSUPPORTED:
+            raise ValueError('%s is not supported by the simulator: %s' % (mn, line))
+        else:
+            ops = split_ops(rest)
+            n = expand(mn, ops) if mn not in ('la',) else 2
+            items.append((seg, pc[seg], 'insn', (mn, ops)))
+            pc[seg] += 4 * n
+    text = {}
+    data = {}
+
+    def emit(addr, word):
+        text[addr] = word & 0xFFFFFFFF
+
+    for seg, addr, kind, payload in items:
+        if kind == 'bytes':
+            for i, b in enumerate(payload):
+                (data if seg == 'data' else text)[addr + i] = b
+            continue
+        if kind == 'words':
+            for i, v in enumerate(payload):
+                w = num(v, labels) & 0xFFFFFFFF
+                for j in range(4):
+                    data[addr + 4 * i + j] = (w >> (8 * j)) & 0xFF
+            continue
+        mn, ops = payload
+        for i, w in enumerate(encode(mn, ops, addr, labels)):
+            emit(addr + 4 * i, w)
+    return text, data, labels
+
+
+def rtype(rs, rt, rd, sh, fn, op=0):
+    return (op << 26) | (rs << 21) | (rt << 16) | (rd << 11) | (sh << 6) | fn
+
+
+def itype(op, rs, rt, imm):
+    return (op << 26) | (rs << 21) | (rt << 16) | (imm & 0xFFFF)
+
+
+def encode(mn, ops, addr, labels):
+    def br_off(lbl, at):
+        t = num(lbl, labels)
+        return (t - (at + 4)) >> 2
+
+    if mn == 'nop':
+        return [0]
+    if mn == 'syscall':
+        return [0x0000000C]
+    if mn in R3:
+        return [rtype(reg(ops[1]), reg(ops[2]), reg(ops[0]), 0, R3[mn])]
+    if mn in SHIFT:
+        return [rtype(0, reg(ops[1]), reg(ops[0]), num(ops[2]) & 31, SHIFT[mn])]
+    if mn in MULDIV:
+        return [rtype(reg(ops[0]), reg(ops[1]), 0, 0, MULDIV[mn])]
+    if mn in MF:
+        return [rtype(0, 0, reg(ops[0]), 0, MF[mn])]
+    if mn == 'jr':
+        return [rtype(reg(ops[0]), 0, 0, 0, 0x08)]
+    if mn in IMM:
+        v = num(ops[2], labels)
+        lo, hi = (0, 0xFFFF) if mn in ('andi', 'ori', 'xori') else (-0x8000, 0x7FFF)
+        if not lo <= v <= hi:
+            raise ValueError('immediate out of range for %s: %d' % (mn, v))
+        return [itype(IMM[mn], reg(ops[1]), reg(ops[0]), v)]
+    if mn == 'lui':
+        return [itype(0x0F, 0, reg(ops[0]), num(ops[1], labels))]
+    if mn in MEM:
+        off, base = parse_mem(ops[1])
+        return [itype(MEM[mn], base, reg(ops[0]), num(off, labels))]
+    if mn in BR:
+        return [itype(BR[mn], reg(ops[0]), reg(ops[1]), br_off(ops[2], addr))]
+    if mn == 'b':
+        return [itype(0x04, 0, 0, br_off(ops[0], addr))]
+    if mn in ('j', 'jal'):
+        t = num(ops[0], labels)
+        return [((0x02 if mn == 'j' else 0x03) << 26) | ((t >> 2) & 0x03FFFFFF)]
+    if mn == 'move':
+        return [rtype(reg(ops[1]), 0, reg(ops[0]), 0, 0x21)]
+    if mn == 'li':
+        v = num(ops[1])
+        r = reg(ops[0])
+        if -32768 <= v <= 32767:
+            return [itype(0x09, 0, r, v)]
+        if 0 <= v <= 65535:
+            return [itype(0x0D, 0, r, v)]
+        return [itype(0x0F, 0, 1, (v >> 16) & 0xFFFF), itype(0x0D, 1, r, v & 0xFFFF)]
+    if mn == 'la':
+        v = num(ops[1], labels)
+        r = reg(ops[0])
+        return [itype(0x0F, 0, 1, (v >> 16) & 0xFFFF), itype(0x0D, 1, r, v & 0xFFFF)]
+    if mn in ('blt', 'bgt', 'ble', 'bge'):
+        a, b = reg(ops[0]), reg(ops[1])
+        if mn in ('bgt', 'ble'):
+            a, b = b, a
+        slt = rtype(a, b, 1, 0, 0x2A)
+        op = 0x05 if mn in ('blt', 'bgt') else 0x04
+        return [slt, itype(op, 1, 0, br_off(ops[2], addr + 4))]
+    raise ValueError('unknown mnemonic ' + mn)
+
+
+def image(mem, base):
+    if not mem:
+        return b''
+    end = max(mem) + 1
+    out = bytearray(end - base)
+    for a, b in mem.items():
+        out[a - base] = b
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('src')
+    ap.add_argument('-o', '--output', required=True)
+    ap.add_argument('--data-out')
+    ap.add_argument('--text-base', type=lambda s: int(s, 0), default=0)
+    ap.add_argument('--data-base', type=lambda s: int(s, 0), default=0x2000)
+    a = ap.parse_args()
+    text, data, _ = assemble(open(a.src).read(), a.text_base, a.data_base)
+    buf = bytearray()
+    if text:
+        end = max(text) + 4
+        for addr in range(a.text_base, end, 4):
+            buf += struct.pack('>I', text.get(addr, 0))
+    open(a.output, 'wb').write(bytes(buf))
+    if a.data_out:
+        open(a.data_out, 'wb').write(image(data, a.data_base))
+
+
+if __name__ == '__main__':
+    main()
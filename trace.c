@@ -0,0 +1,219 @@
+/**
+ * trace.c - Pipeline trace recording through a chunked ring drained by a writer thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "trace.h"
+
+#define TRACE_CHUNK_RECORDS 16384   /* records handed to the writer at once */
+#define TRACE_CHUNKS 16             /* chunks in the ring */
+
+// The producer fills chunk `current`; full chunks queue up behind head for the
+// writer thread. The producer only blocks when every chunk is queued.
+struct TraceWriter {
+    FILE *file;
+    TraceRecord_t *ring;
+    size_t fill[TRACE_CHUNKS];
+    int head;               // oldest queued chunk
+    int queued;
+    int current;
+    size_t used;            // records in the current chunk
+    int closing;
+    int error;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t thread;
+    uint32_t prev_pc[4];
+};
+
+static void *writer_main(void *arg) {
+    TraceWriter_t *t = arg;
+    pthread_mutex_lock(&t->lock);
+    while (1) {
+        while (t->queued == 0 && !t->closing) {
+            pthread_cond_wait(&t->not_empty, &t->lock);
+        }
+        if (t->queued == 0) {
+            break;
+        }
+        int chunk = t->head;
+        size_t count = t->fill[chunk];
+        pthread_mutex_unlock(&t->lock);
+        // Write without holding the lock so the simulator keeps running
+        if (fwrite(&t->ring[(size_t)chunk * TRACE_CHUNK_RECORDS], sizeof(TraceRecord_t),
+                   count, t->file) != count) {
+            t->error = 1;
+        }
+        pthread_mutex_lock(&t->lock);
+        t->head = (t->head + 1) % TRACE_CHUNKS;
+        t->queued--;
+        pthread_cond_signal(&t->not_full);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+TraceWriter_t *trace_open(const char *filename, uint64_t first_cycle) {
+    TraceWriter_t *t = calloc(1, sizeof(TraceWriter_t));
+    if (!t) {
+        return NULL;
+    }
+    t->ring = malloc(sizeof(TraceRecord_t) * TRACE_CHUNK_RECORDS * TRACE_CHUNKS);
+    t->file = fopen(filename, "wb");
+    if (!t->ring || !t->file) {
+        fprintf(stderr, "Failed to create trace file: %s\n", filename);
+        if (t->file) {
+            fclose(t->file);
+        }
+        free(t->ring);
+        free(t);
+        return NULL;
+    }
+    TraceHeader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord_t);
+    header.first_cycle = first_cycle;
+    if (fwrite(&header, sizeof(header), 1, t->file) != 1) {
+        t->error = 1;
+    }
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->not_empty, NULL);
+    pthread_cond_init(&t->not_full, NULL);
+    if (pthread_create(&t->thread, NULL, writer_main, t) != 0) {
+        fprintf(stderr, "Failed to start trace writer thread\n");
+        fclose(t->file);
+        free(t->ring);
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+// Hand the current chunk to the writer and move on to a free one
+static void submit_chunk(TraceWriter_t *t) {
+    pthread_mutex_lock(&t->lock);
+    t->fill[t->current] = t->used;
+    t->queued++;
+    pthread_cond_signal(&t->not_empty);
+    while (t->queued == TRACE_CHUNKS) {
+        pthread_cond_wait(&t->not_full, &t->lock);
+    }
+    t->current = (t->head + t->queued) % TRACE_CHUNKS;
+    pthread_mutex_unlock(&t->lock);
+    t->used = 0;
+}
+
+static TraceRecord_t *next_record(TraceWriter_t *t) {
+    if (t->used == TRACE_CHUNK_RECORDS) {
+        submit_chunk(t);
+    }
+    return &t->ring[(size_t)t->current * TRACE_CHUNK_RECORDS + t->used++];
+}
+
+void trace_cycle(TraceWriter_t *t, const uint32_t pc[4], uint8_t flags, uint8_t reg, int32_t value) {
+    int16_t dpc[4];
+    for (int s = 0; s < 4; ++s) {
+        int32_t delta = (int32_t)(pc[s] - t->prev_pc[s]) / 4;
+        if (delta < INT16_MIN || delta > INT16_MAX || (pc[s] - t->prev_pc[s]) % 4 != 0) {
+            TraceRecord_t *set = next_record(t);
+            memset(set, 0, sizeof(*set));
+            set->kind = TRACE_SETPC;
+            set->reg = (uint8_t)s;
+            set->value = (int32_t)pc[s];
+            delta = 0;
+        }
+        dpc[s] = (int16_t)delta;
+        t->prev_pc[s] = pc[s];
+    }
+    TraceRecord_t *r = next_record(t);
+    r->kind = TRACE_CYCLE;
+    r->flags = flags;
+    r->reg = reg;
+    r->reserved = 0;
+    memcpy(r->dpc, dpc, sizeof(dpc));
+    r->value = value;
+}
+
+int trace_close(TraceWriter_t *t) {
+    if (!t) {
+        return 0;
+    }
+    if (t->used > 0) {
+        submit_chunk(t);
+    }
+    pthread_mutex_lock(&t->lock);
+    t->closing = 1;
+    pthread_cond_signal(&t->not_empty);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    int status = (t->error || fclose(t->file) != 0) ? -1 : 0;
+    if (t->error) {
+        fclose(t->file);
+    }
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->not_empty);
+    pthread_cond_destroy(&t->not_full);
+    free(t->ring);
+    free(t);
+    if (status < 0) {
+        fprintf(stderr, "Failed to write trace file\n");
+    }
+    return status;
+}
+
+int trace_reader_open(TraceReader_t *r, const char *filename) {
+    memset(r, 0, sizeof(*r));
+    r->file = fopen(filename, "rb");
+    if (!r->file) {
+        fprintf(stderr, "Failed to open trace file: %s\n", filename);
+        return -1;
+    }
+    if (fread(&r->header, sizeof(r->header), 1, r->file) != 1 ||
+        memcmp(r->header.magic, TRACE_MAGIC, sizeof(r->header.magic)) != 0 ||
+        r->header.version != TRACE_VERSION || r->header.record_size != sizeof(TraceRecord_t)) {
+        fprintf(stderr, "%s: not a pipeline trace (or unsupported version)\n", filename);
+        fclose(r->file);
+        r->file = NULL;
+        return -1;
+    }
+    r->cycle = r->header.first_cycle;
+    return 0;
+}
+
+int trace_reader_next(TraceReader_t *r, TraceCycle_t *out) {
+    TraceRecord_t rec;
+    while (fread(&rec, sizeof(rec), 1, r->file) == 1) {
+        if (rec.kind == TRACE_SETPC) {
+            if (rec.reg >= 4) {
+                return -1;
+            }
+            r->pc[rec.reg] = (uint32_t)rec.value;
+            continue;
+        }
+        if (rec.kind != TRACE_CYCLE) {
+            return -1;
+        }
+        for (int s = 0; s < 4; ++s) {
+            r->pc[s] += (uint32_t)((int32_t)rec.dpc[s] * 4);
+            out->pc[s] = r->pc[s];
+        }
+        out->cycle = r->cycle++;
+        out->flags = rec.flags;
+        out->reg = rec.reg;
+        out->value = rec.value;
+        return 1;
+    }
+    return 0;
+}
+
+void trace_reader_close(TraceReader_t *r) {
+    if (r->file) {
+        fclose(r->file);
+        r->file = NULL;
+    }
+}
@@ -0,0 +1,83 @@
+/**
+ * trace.h - Compact binary pipeline trace: writer (ring buffer + background thread) and reader.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAGIC "MIPSTRC1"
+#define TRACE_VERSION 1
+
+// Record kinds
+enum TraceKind {
+    TRACE_CYCLE = 0,    /* one simulated cycle */
+    TRACE_SETPC         /* rebase one stage PC whose delta does not fit in 16 bits */
+};
+
+// Per-cycle event flags (high nibble of TraceRecord_t.flags; the low nibble
+// holds the valid bits of IFID, IDEX, EXMEM, MEMWB)
+#define TRACE_EV_STALL   0x10   /* data hazard stall in ID */
+#define TRACE_EV_FLUSH   0x20   /* misprediction flushed IFID/IDEX */
+#define TRACE_EV_IWAIT   0x40   /* fetch waiting on an instruction cache miss */
+#define TRACE_EV_DFREEZE 0x80   /* pipeline frozen on a data cache miss */
+
+// File header, followed by fixed-size records (host byte order)
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t first_cycle;   // cycle number of the first TRACE_CYCLE record
+} TraceHeader_t;
+
+// Fixed-size record. Stage PCs are stored as word deltas against the previous
+// cycle's PC of the same pipeline register; TRACE_SETPC records (stage index in
+// reg, absolute PC in value) precede a cycle whose delta would overflow.
+typedef struct {
+    uint8_t kind;
+    uint8_t flags;          // valid bits | TRACE_EV_* events
+    uint8_t reg;            // register written back this cycle (0: none)
+    uint8_t reserved;
+    int16_t dpc[4];         // IFID, IDEX, EXMEM, MEMWB PC deltas in words
+    int32_t value;          // value written back
+} TraceRecord_t;
+
+// Decoded cycle as returned by the reader
+typedef struct {
+    uint64_t cycle;
+    uint32_t pc[4];         // IFID, IDEX, EXMEM, MEMWB
+    uint8_t flags;
+    uint8_t reg;
+    int32_t value;
+} TraceCycle_t;
+
+typedef struct TraceWriter TraceWriter_t;
+
+// Create a trace file whose first recorded cycle is first_cycle and start the
+// writer thread. Returns NULL on failure.
+TraceWriter_t *trace_open(const char *filename, uint64_t first_cycle);
+
+// Append one cycle: end-of-cycle PCs of the four pipeline registers.
+void trace_cycle(TraceWriter_t *t, const uint32_t pc[4], uint8_t flags, uint8_t reg, int32_t value);
+
+// Flush buffered records, stop the writer thread and close the file.
+// Returns 0 on success, -1 if any write failed.
+int trace_close(TraceWriter_t *t);
+
+// Sequential reader
+typedef struct {
+    FILE *file;
+    TraceHeader_t header;
+    uint64_t cycle;
+    uint32_t pc[4];
+} TraceReader_t;
+
+// Returns 0 on success, -1 if the file is missing or not a trace.
+int trace_reader_open(TraceReader_t *r, const char *filename);
+
+// Read the next cycle. Returns 1 on success, 0 at end of trace, -1 on a corrupt record.
+int trace_reader_next(TraceReader_t *r, TraceCycle_t *out);
+void trace_reader_close(TraceReader_t *r);
+
+#endif // TRACE_H
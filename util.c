@@ -1,120 +1,354 @@
 /**
  * util.c - Implementation of registers, memory, and program loading utilities.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "config.h"
 #include "util.h"
-
-// Register file and memories
-static int32_t registers[NUM_REGS];
-static uint8_t data_mem[DATA_MEM_SIZE];
-static uint32_t instr_mem[INST_MEM_SIZE];
-static int instr_count = 0; // number of instructions loaded
+#include "hostprof.h"
 
 // Initialize registers and memory to zero
-void reg_init() {
+void reg_init(ArchState_t *st) {
     for (int i = 0; i < NUM_REGS; ++i) {
-        registers[i] = 0;
+        st->registers[i] = 0;
     }
+    st->hi = 0;
+    st->lo = 0;
+    st->pc = 0;
+}
+void mem_init(ArchState_t *st) {
+    // Releases any pages left from a previous run
+    memory_free(&st->mem);
 }
-void mem_init() {
-    memset(data_mem, 0, sizeof(data_mem));
+void mem_free(ArchState_t *st) {
+    memory_free(&st->mem);
+    free(st->instr_mem);
+    st->instr_mem = NULL;
+    st->instr_count = 0;
 }
 
 // Read register (returns 0 for register 0 regardless of value, as in MIPS)
-int32_t reg_read(int reg_index) {
+int32_t reg_read(const ArchState_t *st, int reg_index) {
+    HP_COUNT(HP_CALL_REG_READ);
     if (reg_index < 0 || reg_index >= NUM_REGS) {
         return 0;
     }
     if (reg_index == 0) {
         return 0; // $zero is always 0
     }
-    return registers[reg_index];
+    return st->registers[reg_index];
 }
 
 // Write register (ignores writes to register 0)
-void reg_write(int reg_index, int32_t value) {
+void reg_write(ArchState_t *st, int reg_index, int32_t value) {
     if (reg_index < 0 || reg_index >= NUM_REGS) {
         return;
     }
     if (reg_index == 0) {
         return; // cannot write to $zero
     }
-    registers[reg_index] = value;
+    st->registers[reg_index] = value;
 }
 
-// Read a 32-bit word from data memory (assume word-aligned address)
-int32_t mem_read_word(uint32_t address) {
-    if (address + 3 < DATA_MEM_SIZE) {
-        // combine bytes (assuming little-endian)
-        int32_t value = 0;
-        value |= data_mem[address];
-        value |= data_mem[address + 1] << 8;
-        value |= data_mem[address + 2] << 16;
-        value |= data_mem[address + 3] << 24;
-        return value;
-    } else {
-        fprintf(stderr, "Data memory read out of bounds at 0x%08x\n", address);
-        return 0;
+// Data memory accesses go straight to the paged memory
+int32_t mem_read_word(ArchState_t *st, uint32_t address) {
+    HP_COUNT(HP_CALL_MEM_READ_WORD);
+    return (int32_t)memory_read32(&st->mem, address);
+}
+void mem_write_word(ArchState_t *st, uint32_t address, int32_t value) {
+    memory_write32(&st->mem, address, (uint32_t)value);
+}
+int32_t mem_read_half(ArchState_t *st, uint32_t address) {
+    return memory_read16(&st->mem, address);
+}
+void mem_write_half(ArchState_t *st, uint32_t address, int32_t value) {
+    memory_write16(&st->mem, address, (uint16_t)value);
+}
+int32_t mem_read_byte(ArchState_t *st, uint32_t address) {
+    return memory_read8(&st->mem, address);
+}
+void mem_write_byte(ArchState_t *st, uint32_t address, int32_t value) {
+    memory_write8(&st->mem, address, (uint8_t)value);
+}
+int32_t mem_read_sized(ArchState_t *st, uint32_t address, int size, int is_signed) {
+    switch (size) {
+        case 1:
+            return is_signed ? (int8_t)memory_read8(&st->mem, address) : memory_read8(&st->mem, address);
+        case 2:
+            return is_signed ? (int16_t)memory_read16(&st->mem, address) : memory_read16(&st->mem, address);
+        default:
+            return (int32_t)memory_read32(&st->mem, address);
+    }
+}
+void mem_write_sized(ArchState_t *st, uint32_t address, int size, int32_t value) {
+    switch (size) {
+        case 1:
+            memory_write8(&st->mem, address, (uint8_t)value);
+            break;
+        case 2:
+            memory_write16(&st->mem, address, (uint16_t)value);
+            break;
+        default:
+            memory_write32(&st->mem, address, (uint32_t)value);
+            break;
     }
 }
 
-// Write a 32-bit word to data memory (assume word-aligned address)
-void mem_write_word(uint32_t address, int32_t value) {
-    if (address + 3 < DATA_MEM_SIZE) {
-        // break value into bytes (assuming little-endian)
-        data_mem[address]     = (uint8_t)(value & 0xFF);
-        data_mem[address + 1] = (uint8_t)((value >> 8) & 0xFF);
-        data_mem[address + 2] = (uint8_t)((value >> 16) & 0xFF);
-        data_mem[address + 3] = (uint8_t)((value >> 24) & 0xFF);
-    } else {
-        fprintf(stderr, "Data memory write out of bounds at 0x%08x\n", address);
+size_t mem_resident_bytes(const ArchState_t *st) {
+    return memory_resident_bytes(&st->mem);
+}
+
+// Copy a segment image into data memory. swap_words reverses the bytes of
+// each word, placing a big-endian image into the little-endian data memory.
+// Data memory is little-endian throughout (LB/LH/LW and the host fast paths
+// agree on it), so a swapped image keeps the values of its aligned words: LW
+// of a big-endian word reads what a big-endian MIPS would. Bytes and
+// halfwords within a word come out in little-endian order instead: LB of a
+// string or byte array sees each group of four bytes reversed.
+int mem_load(ArchState_t *st, uint32_t address, const uint8_t *bytes, size_t len, int swap_words) {
+    // A swapped image touches whole words even when its length is not a multiple of 4
+    uint64_t span = swap_words ? (len + 3) & ~(size_t)3 : len;
+    if (span > 0x100000000ull - address) {
+        fprintf(stderr, "Data segment at 0x%08x (%zu bytes) runs past the end of memory\n",
+                address, len);
+        return -1;
+    }
+    if (!swap_words) {
+        memory_write_block(&st->mem, address, bytes, len);
+        return 0;
     }
+    for (size_t i = 0; i < len; ++i) {
+        memory_write8(&st->mem, address + (uint32_t)(i ^ 3), bytes[i]);
+    }
+    return 0;
 }
 
-// Load a binary program file into instruction memory. Returns number of instructions loaded.
-int load_program(const char *filename) {
+// Whole-file image, memory-mapped where the platform allows it
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    int mapped;
+    void *buffer;   // heap copy when not mapped
+} FileImage_t;
+
+static int image_open(const char *filename, FileImage_t *img) {
+    memset(img, 0, sizeof(*img));
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+        void *p = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            close(fd);
+            img->data = p;
+            img->size = (size_t)sb.st_size;
+            img->mapped = 1;
+            return 0;
+        }
+    }
+    close(fd);
+#endif
+    // Fall back to one bulk read of the whole file
     FILE *file = fopen(filename, "rb");
     if (!file) {
-        fprintf(stderr, "Failed to open program file: %s\n", filename);
         return -1;
     }
-    // Read file content into instruction memory array
-    uint8_t byte;
-    uint32_t word = 0;
-    int byte_count = 0;
-    instr_count = 0;
-    while (fread(&byte, 1, 1, file) == 1) {
-        word = (word << 8) | byte; // assemble bytes into a 32-bit word (big-endian order)
-        byte_count++;
-        if (byte_count % 4 == 0) {
-            // one instruction (4 bytes) assembled
-            if (instr_count < INST_MEM_SIZE) {
-                instr_mem[instr_count++] = word;
-            } else {
-                fprintf(stderr, "Instruction memory overflow, too many instructions\n");
-                break;
+    size_t cap = 0;
+    uint8_t *buf = NULL;
+    size_t n;
+    do {
+        if (img->size == cap) {
+            cap = cap ? cap * 2 : 65536;
+            uint8_t *grown = realloc(buf, cap);
+            if (!grown) {
+                free(buf);
+                fclose(file);
+                return -1;
             }
-            word = 0;
+            buf = grown;
         }
-    }
+        n = fread(buf + img->size, 1, cap - img->size, file);
+        img->size += n;
+    } while (n > 0);
     fclose(file);
-    // If byte_count not multiple of 4, pad remaining bytes to complete a word
-    if (byte_count % 4 != 0 && instr_count < INST_MEM_SIZE) {
-        while (byte_count % 4 != 0) {
-            word <<= 8;
-            byte_count++;
+    img->buffer = buf;
+    img->data = buf;
+    return 0;
+}
+
+static void image_close(FileImage_t *img) {
+#ifndef _WIN32
+    if (img->mapped) {
+        munmap((void *)img->data, img->size);
+    }
+#endif
+    free(img->buffer);
+    memset(img, 0, sizeof(*img));
+}
+
+// Convert bytes into instruction words in a single pass. A trailing partial
+// word is padded with zero bytes, as if the file continued with zeros.
+static void words_from_bytes(uint32_t *dst, const uint8_t *src, size_t len, int big_endian) {
+    size_t whole = len / 4;
+    for (size_t i = 0; i < whole; ++i, src += 4) {
+        dst[i] = big_endian
+            ? ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | src[3]
+            : ((uint32_t)src[3] << 24) | ((uint32_t)src[2] << 16) | ((uint32_t)src[1] << 8) | src[0];
+    }
+    if (len % 4 != 0) {
+        uint8_t tail[4] = {0, 0, 0, 0};
+        memcpy(tail, src, len % 4);
+        words_from_bytes(&dst[whole], tail, 4, big_endian);
+    }
+}
+
+// Allocate instruction memory for a text segment and fill it from bytes
+static int set_text(ArchState_t *st, const uint8_t *bytes, size_t len, uint32_t base, int big_endian) {
+    size_t count = (len + 3) / 4;
+    if (count > (size_t)INT32_MAX / 4) {
+        fprintf(stderr, "Text segment too large (%zu bytes)\n", len);
+        return -1;
+    }
+    uint32_t *mem = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!mem) {
+        fprintf(stderr, "Failed to allocate instruction memory (%zu words)\n", count);
+        return -1;
+    }
+    words_from_bytes(mem, bytes, len, big_endian);
+    free(st->instr_mem);
+    st->instr_mem = mem;
+    st->instr_count = (int)count;
+    st->text_base = base;
+    return 0;
+}
+
+// ELF32 field readers honouring the file's byte order
+static uint32_t elf_u16(const uint8_t *p, int big_endian) {
+    return big_endian ? ((uint32_t)p[0] << 8) | p[1] : ((uint32_t)p[1] << 8) | p[0];
+}
+static uint32_t elf_u32(const uint8_t *p, int big_endian) {
+    uint32_t w;
+    words_from_bytes(&w, p, 4, big_endian);
+    return w;
+}
+
+#define ELF_HEADER_SIZE 52
+#define ELF_PHDR_SIZE 32
+#define ELF_PT_LOAD 1
+#define ELF_PF_X 1
+#define ELF_EM_MIPS 8
+
+// Load the PT_LOAD segments of a 32-bit MIPS ELF executable: every segment is
+// copied to data memory (with the word byte order of mem_load), and the
+// executable one also becomes instruction memory, so constants, literal pools
+// and jump tables the linker placed beside .text read back through loads.
+static int load_elf(ArchState_t *st, const FileImage_t *img, const char *filename) {
+    const uint8_t *h = img->data;
+    if (img->size < ELF_HEADER_SIZE || h[4] != 1) {
+        fprintf(stderr, "%s: only 32-bit ELF files are supported\n", filename);
+        return -1;
+    }
+    int be = (h[5] == 2);
+    if (elf_u16(h + 18, be) != ELF_EM_MIPS) {
+        fprintf(stderr, "%s: not a MIPS ELF file\n", filename);
+        return -1;
+    }
+    uint32_t entry = elf_u32(h + 24, be);
+    uint32_t phoff = elf_u32(h + 28, be);
+    uint32_t phentsize = elf_u16(h + 42, be);
+    uint32_t phnum = elf_u16(h + 44, be);
+    if (phentsize < ELF_PHDR_SIZE || phoff > img->size ||
+        (uint64_t)phnum * phentsize > img->size - phoff) {
+        fprintf(stderr, "%s: truncated ELF program header table\n", filename);
+        return -1;
+    }
+    int have_text = 0;
+    for (uint32_t i = 0; i < phnum; ++i) {
+        const uint8_t *ph = h + phoff + (size_t)i * phentsize;
+        if (elf_u32(ph, be) != ELF_PT_LOAD) {
+            continue;
         }
-        instr_mem[instr_count++] = word;
+        uint32_t offset = elf_u32(ph + 4, be);
+        uint32_t vaddr = elf_u32(ph + 8, be);
+        uint32_t filesz = elf_u32(ph + 16, be);
+        uint32_t flags = elf_u32(ph + 24, be);
+        if (offset > img->size || filesz > img->size - offset) {
+            fprintf(stderr, "%s: segment %u extends past end of file\n", filename, i);
+            return -1;
+        }
+        if (flags & ELF_PF_X) {
+            if (have_text) {
+                fprintf(stderr, "%s: multiple executable segments are not supported\n", filename);
+                return -1;
+            }
+            if (set_text(st, h + offset, filesz, vaddr, be) < 0) {
+                return -1;
+            }
+            have_text = 1;
+        }
+        if (mem_load(st, vaddr, h + offset, filesz, be) < 0) {
+            // Data memory is already zeroed, which covers the .bss part (memsz > filesz)
+            return -1;
+        }
+    }
+    if (!have_text) {
+        fprintf(stderr, "%s: no executable segment\n", filename);
+        return -1;
+    }
+    st->entry = entry;
+    return st->instr_count;
+}
+
+// Load a program into instruction memory: a 32-bit MIPS ELF executable, or a raw
+// big-endian text image placed at text_base. Returns number of instructions loaded.
+int load_program(ArchState_t *st, const char *filename, uint32_t text_base) {
+    FileImage_t img;
+    if (image_open(filename, &img) < 0) {
+        fprintf(stderr, "Failed to open program file: %s\n", filename);
+        return -1;
+    }
+    int result;
+    if (img.size >= 4 && memcmp(img.data, "\x7f" "ELF", 4) == 0) {
+        result = load_elf(st, &img, filename);
+    } else {
+        result = set_text(st, img.data, img.size, text_base, 1);
+        if (result == 0) {
+            st->entry = text_base;
+            result = st->instr_count;
+        }
+    }
+    image_close(&img);
+    return result;
+}
+
+// Load a raw data segment image into data memory at address
+int load_data_image(ArchState_t *st, const char *filename, uint32_t address) {
+    FileImage_t img;
+    if (image_open(filename, &img) < 0) {
+        fprintf(stderr, "Failed to open data image: %s\n", filename);
+        return -1;
     }
-    return instr_count;
+    int result = mem_load(st, address, img.data, img.size, 0);
+    image_close(&img);
+    return result;
 }
 
-// Get instruction from instruction memory at a given word address (PC/4)
-uint32_t instr_read(uint32_t index) {
-    if (index < INST_MEM_SIZE) {
-        return instr_mem[index];
+// Get instruction from instruction memory at a given word index ((PC - text_base)/4)
+uint32_t instr_read(const ArchState_t *st, uint32_t index) {
+    HP_COUNT(HP_CALL_INSTR_READ);
+    if (index < (uint32_t)st->instr_count) {
+        return st->instr_mem[index];
     } else {
         return 0;
     }
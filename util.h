@@ -4,24 +4,62 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include "config.h"
+#include "memory.h"
+
+// Architectural state of one simulated machine
+typedef struct {
+    int32_t registers[NUM_REGS];   // first member: translated code addresses it directly
+    int32_t hi, lo;             // multiply/divide results
+    Memory_t mem;               // sparse data memory
+    uint32_t *instr_mem;        // sized to the loaded text segment
+    int instr_count;            // number of instructions loaded
+    uint32_t text_base;         // address of instr_mem[0]
+    uint32_t entry;             // initial PC
+    uint32_t pc;                // architectural PC (functional engine)
+} ArchState_t;
 
 // Initialize registers and memories
-void reg_init();
-void mem_init();
+void reg_init(ArchState_t *st);
+void mem_init(ArchState_t *st);
+void mem_free(ArchState_t *st);
 
 // Register file access
-int32_t reg_read(int reg_index);
-void reg_write(int reg_index, int32_t value);
+int32_t reg_read(const ArchState_t *st, int reg_index);
+void reg_write(ArchState_t *st, int reg_index, int32_t value);
+
+// Data memory access (little-endian; any 32-bit address)
+int32_t mem_read_word(ArchState_t *st, uint32_t address);
+void mem_write_word(ArchState_t *st, uint32_t address, int32_t value);
+int32_t mem_read_half(ArchState_t *st, uint32_t address);   // zero-extended
+void mem_write_half(ArchState_t *st, uint32_t address, int32_t value);
+int32_t mem_read_byte(ArchState_t *st, uint32_t address);   // zero-extended
+void mem_write_byte(ArchState_t *st, uint32_t address, int32_t value);
+
+// Load/store of size 1, 2 or 4 bytes; sub-word loads are sign-extended if is_signed
+int32_t mem_read_sized(ArchState_t *st, uint32_t address, int size, int is_signed);
+void mem_write_sized(ArchState_t *st, uint32_t address, int size, int32_t value);
+
+// Bytes of host memory currently backing data memory.
+size_t mem_resident_bytes(const ArchState_t *st);
+
+// Copy a segment image into data memory (swap_words: image has big-endian words,
+// stored word-swapped in the little-endian data memory; see util.c).
+// Returns 0 on success, -1 if it runs past the end of the address space.
+int mem_load(ArchState_t *st, uint32_t address, const uint8_t *bytes, size_t len, int swap_words);
 
-// Data memory access (word-aligned)
-int32_t mem_read_word(uint32_t address);
-void mem_write_word(uint32_t address, int32_t value);
+// Load a program into instruction memory: a MIPS ELF32 executable (all of whose
+// segments, the executable one included, also go to data memory) or a raw
+// big-endian text image placed at text_base.
+// Sizes instruction memory to fit. Returns number of instructions loaded, -1 on error.
+int load_program(ArchState_t *st, const char *filename, uint32_t text_base);
 
-// Load program (binary) into instruction memory. Returns number of instructions loaded.
-int load_program(const char *filename);
+// Load a raw data segment image into data memory at address. Returns 0 on success.
+int load_data_image(ArchState_t *st, const char *filename, uint32_t address);
 
-// Fetch an instruction by index (PC >> 2)
-uint32_t instr_read(uint32_t index);
+// Fetch an instruction by index ((PC - text_base) >> 2)
+uint32_t instr_read(const ArchState_t *st, uint32_t index);
 
 #endif // UTIL_H